@@ -0,0 +1,186 @@
+/**
+ * loudbus-bench-client.c
+ *   A minimal D-Bus client that makes the same calls as
+ *   expt-overhead.rkt, using nothing but g_dbus_connection_call_sync,
+ *   so that we can tell how much of a call is D-Bus and how much is
+ *   louDBus.
+ *
+ *   Usage: loudbus-bench-client CALLS
+ *
+ * For each mix of calls, prints a line with the name of the mix and
+ * the average time per call, in microseconds.  Needs
+ * experiments/loudbus-test-server to be running.  Build with
+ * "make experiments/loudbus-bench-client".
+ *
+ * Copyright (c) 2012-15 Samuel A. Rebelsky.  All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the Lesser GNU General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+// +---------+--------------------------------------------------------
+// | Headers |
+// +---------+
+
+#include <stdlib.h>
+#include <time.h>
+
+#include <glib.h>
+#include <gio/gio.h>
+
+
+// +--------+---------------------------------------------------------
+// | Macros |
+// +--------+
+
+#define TEST_SERVICE "edu.grinnell.cs.glimmer.louDBus.Test"
+#define TEST_OBJECT "/edu/grinnell/cs/glimmer/louDBus/test"
+#define TEST_INTERFACE "edu.grinnell.cs.glimmer.louDBus.test"
+
+/**
+ * The data for the mixes.  expt-overhead.rkt sends the same data.
+ */
+#define BENCH_STRING "The quick brown fox jumps over the lazy dog"
+#define BENCH_BYTES (1024 * 1024)
+#define BENCH_INTS 10000
+
+
+// +-------+----------------------------------------------------------
+// | Types |
+// +-------+
+
+/**
+ * One mix of calls.
+ */
+struct BenchMix
+  {
+    const gchar *name;          // What we call it in the report
+    const gchar *method;        // The method it calls
+    const gchar *reply;         // The type of the reply
+  };
+typedef struct BenchMix BenchMix;
+
+
+// +---------+--------------------------------------------------------
+// | Globals |
+// +---------+
+
+static const BenchMix bench_mixes[] =
+  {
+    { "scalar", "echo_int", "(i)" },
+    { "string", "echo_string", "(s)" },
+    { "bytes", "echo_bytes", "(ay)" },
+    { "ints", "echo_ints", "(ai)" },
+    { NULL, NULL, NULL }
+  };
+
+static guchar bench_bytes[BENCH_BYTES];
+static gint32 bench_ints[BENCH_INTS];
+
+
+// +-----------------+------------------------------------------------
+// | Local Utilities |
+// +-----------------+
+
+/**
+ * The time, in nanoseconds.
+ */
+static gint64
+bench_now (void)
+{
+  struct timespec now;  // The time
+
+  clock_gettime (CLOCK_MONOTONIC, &now);
+  return (gint64) now.tv_sec * G_GINT64_CONSTANT (1000000000) + now.tv_nsec;
+} // bench_now
+
+/**
+ * Build the parameters for one call, as a client would.
+ */
+static GVariant *
+bench_parameters (const BenchMix *mix)
+{
+  if (g_str_equal (mix->name, "scalar"))
+    return g_variant_new ("(i)", 42);
+  else if (g_str_equal (mix->name, "string"))
+    return g_variant_new ("(s)", BENCH_STRING);
+  else if (g_str_equal (mix->name, "bytes"))
+    return g_variant_new ("(@ay)",
+                          g_variant_new_fixed_array (G_VARIANT_TYPE_BYTE,
+                                                     bench_bytes,
+                                                     BENCH_BYTES,
+                                                     sizeof (guchar)));
+  else
+    return g_variant_new ("(@ai)",
+                          g_variant_new_fixed_array (G_VARIANT_TYPE_INT32,
+                                                     bench_ints,
+                                                     BENCH_INTS,
+                                                     sizeof (gint32)));
+} // bench_parameters
+
+
+// +------+-----------------------------------------------------------
+// | Main |
+// +------+
+
+int
+main (int argc, char *argv[])
+{
+  GDBusConnection *connection;  // The connection to the bus
+  GVariant *result;             // The result of one call
+  GError *error = NULL;         // A place to hold errors
+  const BenchMix *mix;          // One mix of calls
+  gint64 start;                 // When the mix started
+  int calls;                    // How many calls to make in each mix
+  int i;                        // Counter variable
+
+  calls = (argc > 1) ? atoi (argv[1]) : 1000;
+  if (calls < 1)
+    g_error ("usage: %s CALLS", argv[0]);
+  for (i = 0; i < BENCH_BYTES; i++)
+    bench_bytes[i] = (i * 7) % 256;
+  for (i = 0; i < BENCH_INTS; i++)
+    bench_ints[i] = i;
+
+  connection = g_bus_get_sync (G_BUS_TYPE_SESSION, NULL, &error);
+  if (connection == NULL)
+    g_error ("could not connect to the bus: %s", error->message);
+
+  for (mix = bench_mixes; mix->name != NULL; mix++)
+    {
+      start = bench_now ();
+      for (i = 0; i < calls; i++)
+        {
+          result = g_dbus_connection_call_sync (connection,
+                                                TEST_SERVICE,
+                                                TEST_OBJECT,
+                                                TEST_INTERFACE,
+                                                mix->method,
+                                                bench_parameters (mix),
+                                                G_VARIANT_TYPE (mix->reply),
+                                                G_DBUS_CALL_FLAGS_NONE,
+                                                -1,
+                                                NULL,
+                                                &error);
+          if (result == NULL)
+            g_error ("%s failed: %s", mix->method, error->message);
+          g_variant_unref (result);
+        } // for each call
+      g_print ("%s %.3f\n", mix->name,
+               (bench_now () - start) / 1000.0 / calls);
+    } // for each mix
+
+  g_object_unref (connection);
+  return 0;
+} // main
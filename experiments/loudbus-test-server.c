@@ -0,0 +1,407 @@
+/**
+ * loudbus-test-server.c
+ *   A small D-Bus service to try louDBus against, so that we don't
+ *   need a running GIMP.  It also shows how a service uses the
+ *   reference decoder in loudbus-frame.c and the shared-memory rings
+ *   in loudbus-ring.c.
+ *
+ *   Service:   edu.grinnell.cs.glimmer.louDBus.Test
+ *   Object:    /edu/grinnell/cs/glimmer/louDBus/test
+ *   Interface: edu.grinnell.cs.glimmer.louDBus.test
+ *
+ * "make check" runs it for experiments/loudbus-test.rkt.  To use it
+ * by hand, build it with "make experiments/loudbus-test-server" and
+ * run it in the background.
+ *
+ * Copyright (c) 2012-15 Samuel A. Rebelsky.  All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the Lesser GNU General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+// +---------+--------------------------------------------------------
+// | Headers |
+// +---------+
+
+#include <string.h>
+
+#include <glib.h>
+#include <gio/gio.h>
+#include <gio/gunixfdlist.h>
+
+#include "loudbus-core.h"
+
+
+// +--------+---------------------------------------------------------
+// | Macros |
+// +--------+
+
+#define TEST_SERVICE "edu.grinnell.cs.glimmer.louDBus.Test"
+#define TEST_OBJECT "/edu/grinnell/cs/glimmer/louDBus/test"
+#define TEST_INTERFACE "edu.grinnell.cs.glimmer.louDBus.test"
+
+
+// +---------+--------------------------------------------------------
+// | Globals |
+// +---------+
+
+/**
+ * The interfaces we provide.  The methods whose names end in _z
+ * exchange byte arrays in compressed frames, and the ones whose names
+ * end in _r exchange large byte arrays through a shared-memory ring,
+ * if the client opens one; the others are the same methods without
+ * frames, for comparison.
+ */
+static const gchar *test_xml =
+  "<node>"
+  "  <interface name='" TEST_INTERFACE "'>"
+  "    <method name='echo_bytes'>"
+  "      <arg type='ay' name='data' direction='in'/>"
+  "      <arg type='ay' name='result' direction='out'/>"
+  "    </method>"
+  "    <method name='echo_bytes_z'>"
+  "      <annotation name='" LOUDBUS_COMPRESS_ANNOTATION "'"
+  "                  value='" LOUDBUS_COMPRESS_CODEC "'/>"
+  "      <arg type='ay' name='data' direction='in'/>"
+  "      <arg type='ay' name='result' direction='out'/>"
+  "    </method>"
+  "    <method name='count_bytes'>"
+  "      <arg type='ay' name='data' direction='in'/>"
+  "      <arg type='i' name='byte' direction='in'/>"
+  "      <arg type='i' name='result' direction='out'/>"
+  "    </method>"
+  "    <method name='count_bytes_z'>"
+  "      <annotation name='" LOUDBUS_COMPRESS_ANNOTATION "'"
+  "                  value='" LOUDBUS_COMPRESS_CODEC "'/>"
+  "      <arg type='ay' name='data' direction='in'/>"
+  "      <arg type='i' name='byte' direction='in'/>"
+  "      <arg type='i' name='result' direction='out'/>"
+  "    </method>"
+  "    <method name='echo_bytes_r'>"
+  "      <annotation name='" LOUDBUS_RING_ANNOTATION "'"
+  "                  value='" LOUDBUS_RING_TRANSPORT "'/>"
+  "      <arg type='ay' name='data' direction='in'/>"
+  "      <arg type='ay' name='result' direction='out'/>"
+  "    </method>"
+  "    <method name='count_bytes_r'>"
+  "      <annotation name='" LOUDBUS_RING_ANNOTATION "'"
+  "                  value='" LOUDBUS_RING_TRANSPORT "'/>"
+  "      <arg type='ay' name='data' direction='in'/>"
+  "      <arg type='i' name='byte' direction='in'/>"
+  "      <arg type='i' name='result' direction='out'/>"
+  "    </method>"
+  "    <method name='make_strings'>"
+  "      <arg type='i' name='n' direction='in'/>"
+  "      <arg type='as' name='result' direction='out'/>"
+  "    </method>"
+  "    <method name='make_rows'>"
+  "      <arg type='i' name='n' direction='in'/>"
+  "      <arg type='a(ids)' name='result' direction='out'/>"
+  "    </method>"
+  "    <method name='echo_int'>"
+  "      <arg type='i' name='i' direction='in'/>"
+  "      <arg type='i' name='result' direction='out'/>"
+  "    </method>"
+  "    <method name='echo_string'>"
+  "      <arg type='s' name='str' direction='in'/>"
+  "      <arg type='s' name='result' direction='out'/>"
+  "    </method>"
+  "    <method name='echo_ints'>"
+  "      <arg type='ai' name='ints' direction='in'/>"
+  "      <arg type='ai' name='result' direction='out'/>"
+  "    </method>"
+  "    <method name='echo_doubles'>"
+  "      <arg type='ad' name='doubles' direction='in'/>"
+  "      <arg type='ad' name='result' direction='out'/>"
+  "    </method>"
+  "    <method name='echo_strings'>"
+  "      <arg type='as' name='strs' direction='in'/>"
+  "      <arg type='as' name='result' direction='out'/>"
+  "    </method>"
+  "    <method name='describe'>"
+  "      <arg type='a{sv}' name='settings' direction='in'/>"
+  "      <arg type='s' name='result' direction='out'/>"
+  "    </method>"
+  "  </interface>"
+  "  <interface name='" LOUDBUS_RING_INTERFACE "'>"
+  "    <method name='Attach'>"
+  "      <arg type='h' name='ring' direction='in'/>"
+  "      <arg type='u' name='id' direction='out'/>"
+  "    </method>"
+  "    <method name='Detach'>"
+  "      <arg type='u' name='id' direction='in'/>"
+  "    </method>"
+  "  </interface>"
+  "</node>";
+
+/**
+ * The rings that clients have attached, by number.  (A real service
+ * would also drop a client's rings when the client leaves the bus.)
+ */
+static GHashTable *test_rings;
+static guint32 test_next_ring = 1;
+
+
+// +------------------+-----------------------------------------------
+// | Method Callbacks |
+// +------------------+
+
+/**
+ * Build a large array for make_strings or make_rows, to give the
+ * client lots to decode.
+ */
+static GVariant *
+test_make_array (const gchar *method, gint32 n)
+{
+  GVariantBuilder builder;      // Builds the array
+  gchar str[32];                // One string
+  gint32 i;                     // Counter variable
+  gboolean rows;                // Are we making rows?
+
+  rows = (strcmp (method, "make_rows") == 0);
+  g_variant_builder_init (&builder, rows ? G_VARIANT_TYPE ("a(ids)")
+                                         : G_VARIANT_TYPE ("as"));
+  for (i = 0; i < n; i++)
+    {
+      g_snprintf (str, sizeof (str), "item-%d-\xc3\xa9", i);
+      if (rows)
+        g_variant_builder_add (&builder, "(ids)", i, i / 2.0, str);
+      else
+        g_variant_builder_add (&builder, "s", str);
+    } // for each element
+  return g_variant_ref_sink (g_variant_new ("(@*)", 
+                                            g_variant_builder_end (&builder)));
+} // test_make_array
+
+/**
+ * Handle a call to one of our methods.
+ */
+static void
+test_method_call (GDBusConnection *connection,
+                  const gchar *sender,
+                  const gchar *object,
+                  const gchar *interface,
+                  const gchar *method,
+                  GVariant *parameters,
+                  GDBusMethodInvocation *invocation,
+                  gpointer data)
+{
+  GVariant *actuals;            // The parameters, decoded
+  GVariant *result;             // The result
+  GVariant *framed;             // The result, encoded
+  GVariant *bytes;              // A byte array
+  const guchar *contents;       // Its contents
+  gsize n;                      // Its length
+  gsize i;                      // Counter variable
+  gint32 byte;                  // The byte to count
+  gint32 count;                 // How many times it appears
+  gint32 size;                  // The size of the array to make
+  gboolean compressed;          // Does the method use compression?
+  gboolean ringed;              // Does the method use rings?
+  LouDBusRing *ring = NULL;     // The ring the parameters are in
+  guint32 id;                   // Its number
+  gchar *text;                  // A printed value
+  GError *error = NULL;         // A place to hold errors
+
+  if (g_str_has_prefix (method, "make_"))
+    {
+      g_variant_get (parameters, "(i)", &size);
+      result = test_make_array (method, size);
+      g_dbus_method_invocation_return_value (invocation, result);
+      g_variant_unref (result);
+      return;
+    } // make_strings and make_rows
+
+  // Print the settings with their types, so that clients can check
+  // the types they send.
+  if (strcmp (method, "describe") == 0)
+    {
+      text = g_variant_print (parameters, TRUE);
+      g_dbus_method_invocation_return_value (invocation,
+                                             g_variant_new ("(s)", text));
+      g_free (text);
+      return;
+    } // describe
+
+  compressed = g_str_has_suffix (method, "_z");
+  ringed = g_str_has_suffix (method, "_r");
+  if (ringed && loudbus_ring_tuple_id (parameters, &id))
+    ring = g_hash_table_lookup (test_rings, GUINT_TO_POINTER (id));
+  if (! (compressed || ringed))
+    actuals = g_variant_ref (parameters);
+  else
+    {
+      // loudbus_ring_tuple handles compressed frames, too, but
+      // loudbus_frame_tuple is all that services without rings need.
+      actuals = compressed
+                ? loudbus_frame_tuple (parameters, FALSE, &error)
+                : loudbus_ring_tuple (ring, parameters, FALSE, 0, &error);
+      if (actuals == NULL)
+        {
+          g_dbus_method_invocation_return_gerror (invocation, error);
+          g_error_free (error);
+          return;
+        } // if the frame is invalid
+    } // if the method uses frames
+
+  if (g_str_has_prefix (method, "echo_"))
+    {
+      result = g_variant_ref (actuals);
+    } // echo_bytes, echo_int, and such
+  else
+    {
+      g_variant_get_child (actuals, 1, "i", &byte);
+      bytes = g_variant_get_child_value (actuals, 0);
+      contents = g_variant_get_fixed_array (bytes, &n, sizeof (guchar));
+      count = 0;
+      for (i = 0; i < n; i++)
+        if (contents[i] == byte)
+          count++;
+      g_variant_unref (bytes);
+      result = g_variant_ref_sink (g_variant_new ("(i)", count));
+    } // count_bytes
+
+  if (compressed || ringed)
+    {
+      framed = compressed
+               ? loudbus_frame_tuple (result, TRUE, NULL)
+               : loudbus_ring_tuple (ring, result, TRUE, G_MAXSIZE, NULL);
+      g_variant_unref (result);
+      result = framed;
+    } // if the method uses frames
+
+  g_dbus_method_invocation_return_value (invocation, result);
+  g_variant_unref (result);
+  g_variant_unref (actuals);
+} // test_method_call
+
+static const GDBusInterfaceVTable test_vtable =
+  {
+    test_method_call,
+    NULL,
+    NULL
+  };
+
+/**
+ * Handle a call to attach or detach a ring.
+ */
+static void
+test_ring_call (GDBusConnection *connection,
+                const gchar *sender,
+                const gchar *object,
+                const gchar *interface,
+                const gchar *method,
+                GVariant *parameters,
+                GDBusMethodInvocation *invocation,
+                gpointer data)
+{
+  GUnixFDList *fds;             // The descriptors that came with the call
+  LouDBusRing *ring;            // The ring
+  gint32 handle;                // Which descriptor is the ring's
+  guint32 id;                   // The ring's number
+  int fd;                       // The descriptor
+  GError *error = NULL;         // A place to hold errors
+
+  if (strcmp (method, "Detach") == 0)
+    {
+      g_variant_get (parameters, "(u)", &id);
+      g_hash_table_remove (test_rings, GUINT_TO_POINTER (id));
+      g_dbus_method_invocation_return_value (invocation, NULL);
+      return;
+    } // Detach
+
+  g_variant_get (parameters, "(h)", &handle);
+  fds = g_dbus_message_get_unix_fd_list
+          (g_dbus_method_invocation_get_message (invocation));
+  fd = (fds == NULL) ? -1 : g_unix_fd_list_get (fds, handle, &error);
+  if (fd < 0)
+    {
+      if (error == NULL)
+        error = g_error_new_literal (G_IO_ERROR, G_IO_ERROR_INVALID_ARGUMENT,
+                                     "no descriptor for the ring");
+      g_dbus_method_invocation_return_gerror (invocation, error);
+      g_error_free (error);
+      return;
+    } // if there's no descriptor
+
+  id = test_next_ring++;
+  ring = loudbus_ring_attach (fd, id, &error);
+  if (ring == NULL)
+    {
+      g_dbus_method_invocation_return_gerror (invocation, error);
+      g_error_free (error);
+      return;
+    } // if it's not a ring
+  g_hash_table_insert (test_rings, GUINT_TO_POINTER (id), ring);
+  g_dbus_method_invocation_return_value (invocation,
+                                         g_variant_new ("(u)", id));
+} // test_ring_call
+
+static const GDBusInterfaceVTable test_ring_vtable =
+  {
+    test_ring_call,
+    NULL,
+    NULL
+  };
+
+
+// +------+-----------------------------------------------------------
+// | Main |
+// +------+
+
+/**
+ * Export our object once we have the bus.
+ */
+static void
+test_bus_acquired (GDBusConnection *connection, const gchar *name,
+                   gpointer data)
+{
+  GDBusNodeInfo *info = data;   // Our interface
+  GError *error = NULL;         // A place to hold errors
+
+  if (g_dbus_connection_register_object (connection, TEST_OBJECT,
+                                         info->interfaces[0], &test_vtable,
+                                         NULL, NULL, &error) == 0)
+    g_error ("could not register object: %s", error->message);
+  if (g_dbus_connection_register_object (connection, TEST_OBJECT,
+                                         info->interfaces[1],
+                                         &test_ring_vtable,
+                                         NULL, NULL, &error) == 0)
+    g_error ("could not register rings: %s", error->message);
+} // test_bus_acquired
+
+static void
+test_name_lost (GDBusConnection *connection, const gchar *name,
+                gpointer data)
+{
+  g_error ("could not get the name %s", name);
+} // test_name_lost
+
+int
+main (int argc, char *argv[])
+{
+  GDBusNodeInfo *info;          // Our interface
+  GMainLoop *loop;              // The main loop
+
+  info = g_dbus_node_info_new_for_xml (test_xml, NULL);
+  test_rings = g_hash_table_new_full (g_direct_hash, g_direct_equal, NULL,
+                                      (GDestroyNotify) loudbus_ring_unref);
+  g_bus_own_name (G_BUS_TYPE_SESSION, TEST_SERVICE,
+                  G_BUS_NAME_OWNER_FLAGS_NONE,
+                  test_bus_acquired, NULL, test_name_lost,
+                  info, NULL);
+  loop = g_main_loop_new (NULL, FALSE);
+  g_main_loop_run (loop);
+  return 0;
+} // main
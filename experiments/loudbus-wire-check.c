@@ -0,0 +1,499 @@
+/**
+ * loudbus-wire-check.c
+ *   A differential test of the direct encoder in loudbus-wire.c.  It
+ *   writes random tuples of every kind of member the encoder supports
+ *   with loudbus_wire_*, builds the same tuples with GVariant builders
+ *   (as louDBus does when the encoder is off), and checks that the
+ *   serialized forms are the same, byte for byte.  It also checks that
+ *   the encoder refuses values that don't match their types.
+ *
+ * Build and run with "make check".  Give a seed as the argument to
+ * repeat a failing run.  Exits with a nonzero status if anything
+ * differs.
+ *
+ * Copyright (c) 2012-15 Samuel A. Rebelsky.  All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the Lesser GNU General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+// +---------+--------------------------------------------------------
+// | Headers |
+// +---------+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <glib.h>
+
+#include "loudbus-core.h"
+
+
+// +--------+---------------------------------------------------------
+// | Macros |
+// +--------+
+
+/**
+ * How many random tuples to check, and the most members in one.
+ */
+#define CHECK_ROUNDS 2000
+#define CHECK_MEMBERS 6
+
+/**
+ * The seed, unless the caller gives one.
+ */
+#define CHECK_SEED 20150601
+
+/**
+ * How often a round may use the largest arrays, which are slow to
+ * build with GVariant builders.
+ */
+#define CHECK_LARGE_EVERY 10
+
+
+// +-------+----------------------------------------------------------
+// | Types |
+// +-------+
+
+/**
+ * One fixed-size value, as loudbus_wire_add_fixed expects it.
+ */
+typedef union
+  {
+    gboolean b;
+    guint8 y;
+    gint16 n;
+    guint16 q;
+    gint32 i;
+    guint32 u;
+    gint64 x;
+    guint64 t;
+    double d;
+  } CheckFixed;
+
+
+// +---------+--------------------------------------------------------
+// | Globals |
+// +---------+
+
+/**
+ * The types of the members we try.  The last few go through
+ * loudbus_wire_add_value.
+ */
+static const gchar *check_types[] =
+  {
+    "b", "y", "n", "q", "i", "u", "x", "t", "d", "s",
+    "ab", "ay", "an", "ai", "au", "ax", "ad", "as",
+    "v", "a{sv}", "(is)", "aas"
+  };
+
+/**
+ * The sizes of arrays we try.  Together with the other members, they
+ * need offsets of 1, 2, and 4 bytes.
+ */
+static const gsize check_sizes[] = { 0, 1, 3, 40, 300, 5000, 70000 };
+
+/**
+ * Pieces of strings, some of them more than one byte of UTF-8.
+ */
+static const gchar *check_pieces[] =
+  {
+    "a", "b", "z", "0", " ", "-", "\xc3\xa9", "\xce\xbb", "\xe2\x82\xac"
+  };
+
+
+// +-----------------+------------------------------------------------
+// | Local Utilities |
+// +-----------------+
+
+/**
+ * A random 64-bit value.
+ */
+static guint64
+check_random64 (void)
+{
+  return (((guint64) g_random_int ()) << 32) | g_random_int ();
+} // check_random64
+
+/**
+ * Fill value with a random value of the fixed-size type, and return
+ * the same value as a GVariant.
+ */
+static GVariant *
+check_fixed (gchar type, CheckFixed *value)
+{
+  memset (value, 0, sizeof (CheckFixed));
+  switch (type)
+    {
+      case 'b':
+        value->b = g_random_boolean ();
+        return g_variant_new_boolean (value->b);
+      case 'y':
+        value->y = (guint8) g_random_int ();
+        return g_variant_new_byte (value->y);
+      case 'n':
+        value->n = (gint16) g_random_int ();
+        return g_variant_new_int16 (value->n);
+      case 'q':
+        value->q = (guint16) g_random_int ();
+        return g_variant_new_uint16 (value->q);
+      case 'i':
+        value->i = (gint32) g_random_int ();
+        return g_variant_new_int32 (value->i);
+      case 'u':
+        value->u = g_random_int ();
+        return g_variant_new_uint32 (value->u);
+      case 'x':
+        value->x = (gint64) check_random64 ();
+        return g_variant_new_int64 (value->x);
+      case 't':
+        value->t = check_random64 ();
+        return g_variant_new_uint64 (value->t);
+      default:
+        value->d = g_random_double_range (-1e9, 1e9);
+        return g_variant_new_double (value->d);
+    } // switch
+} // check_fixed
+
+/**
+ * The size of the fixed-size type.
+ */
+static gsize
+check_fixed_size (gchar type)
+{
+  switch (type)
+    {
+      case 'b':
+      case 'y':
+        return 1;
+      case 'n':
+      case 'q':
+        return 2;
+      case 'i':
+      case 'u':
+        return 4;
+      default:
+        return 8;
+    } // switch
+} // check_fixed_size
+
+/**
+ * A random UTF-8 string, which the caller frees.
+ */
+static gchar *
+check_string (void)
+{
+  GString *str;         // The string we're building
+  int len;              // How many pieces it has
+  int i;                // Counter variable
+
+  str = g_string_new ("");
+  len = g_random_int_range (0, 24);
+  for (i = 0; i < len; i++)
+    g_string_append (str, check_pieces[g_random_int_range (0,
+                                       G_N_ELEMENTS (check_pieces))]);
+  return g_string_free (str, FALSE);
+} // check_string
+
+/**
+ * A random value of one of the types that the encoder copies in with
+ * loudbus_wire_add_value.
+ */
+static GVariant *
+check_complex (const gchar *type, gsize size)
+{
+  GVariantBuilder builder;      // Builds arrays
+  GVariant *result;             // The value we build
+  gchar *str;                   // A random string
+  gchar key[32];                // A key in a dictionary
+  gsize i;                      // Counter variable
+
+  if (strcmp (type, "v") == 0)
+    {
+      str = check_string ();
+      result = g_variant_new_variant (g_random_boolean ()
+                                      ? g_variant_new_int32 (g_random_int ())
+                                      : g_variant_new_string (str));
+      g_free (str);
+    } // if it's a variant
+  else if (strcmp (type, "a{sv}") == 0)
+    {
+      g_variant_builder_init (&builder, G_VARIANT_TYPE (type));
+      for (i = 0; i < size; i++)
+        {
+          g_snprintf (key, sizeof (key), "k%lu", (unsigned long) i);
+          g_variant_builder_add (&builder, "{sv}", key,
+                                 g_variant_new_double (g_random_double ()));
+        } // for
+      result = g_variant_builder_end (&builder);
+    } // if it's a dictionary
+  else if (strcmp (type, "(is)") == 0)
+    {
+      str = check_string ();
+      result = g_variant_new ("(is)", (gint32) g_random_int (), str);
+      g_free (str);
+    } // if it's a tuple
+  else
+    {
+      g_variant_builder_init (&builder, G_VARIANT_TYPE (type));
+      for (i = 0; i < size; i++)
+        {
+          // Each element holds the string or is empty.
+          str = check_string ();
+          g_variant_builder_add_value (&builder,
+              g_variant_new_strv ((const gchar **) &str,
+                                  g_random_int_range (0, 2)));
+          g_free (str);
+        } // for
+      result = g_variant_builder_end (&builder);
+    } // if it's an array of arrays
+  return g_variant_ref_sink (result);
+} // check_complex
+
+/**
+ * Write a random member of the given type with the encoder, and
+ * return the same member as a GVariant (not floating).  Arrays have
+ * size elements.
+ */
+static GVariant *
+check_member (LouDBusWire *wire, const gchar *type, gsize size)
+{
+  GVariantBuilder builder;      // Builds arrays
+  GVariant *result;             // The member, as a GVariant
+  CheckFixed value;             // One fixed-size value
+  guint8 *data;                 // The elements of a fixed-size array
+  gsize esize;                  // The size of one of them
+  gboolean flat;                // Write the array all at once?
+  gchar *str;                   // A random string
+  gsize i;                      // Counter variable
+
+  if ((type[0] != 'a') && (type[0] != 's') && (type[0] != 'v')
+      && (type[0] != '('))
+    {
+      result = check_fixed (type[0], &value);
+      loudbus_wire_add_fixed (wire, &value);
+    } // if it's a fixed-size value
+
+  else if (type[0] == 's')
+    {
+      str = check_string ();
+      loudbus_wire_add_string (wire, str);
+      result = g_variant_new_string (str);
+      g_free (str);
+    } // if it's a string
+
+  else if ((strcmp (type, "as") == 0))
+    {
+      g_variant_builder_init (&builder, G_VARIANT_TYPE (type));
+      loudbus_wire_open_array (wire);
+      for (i = 0; i < size; i++)
+        {
+          str = check_string ();
+          loudbus_wire_add_string (wire, str);
+          g_variant_builder_add (&builder, "s", str);
+          g_free (str);
+        } // for
+      loudbus_wire_close_array (wire);
+      result = g_variant_builder_end (&builder);
+    } // if it's an array of strings
+
+  else if ((type[0] == 'a') && (strchr ("bynqiuxtd", type[1]) != NULL))
+    {
+      // Booleans only go an element at a time; the rest go either way.
+      flat = (type[1] != 'b') && g_random_boolean ();
+      esize = check_fixed_size (type[1]);
+      data = g_malloc (size * esize + 1);
+      g_variant_builder_init (&builder, G_VARIANT_TYPE (type));
+      if (! flat)
+        loudbus_wire_open_array (wire);
+      for (i = 0; i < size; i++)
+        {
+          g_variant_builder_add_value (&builder,
+                                       check_fixed (type[1], &value));
+          if (flat)
+            memcpy (data + i * esize, &value, esize);
+          else
+            loudbus_wire_add_fixed (wire, &value);
+        } // for
+      if (flat)
+        loudbus_wire_add_fixed_array (wire, data, size);
+      else
+        loudbus_wire_close_array (wire);
+      g_free (data);
+      result = g_variant_builder_end (&builder);
+    } // if it's an array of fixed-size values
+
+  else
+    {
+      result = check_complex (type, size);
+      loudbus_wire_add_value (wire, result);
+      return result;
+    } // if it's anything else
+
+  return g_variant_ref_sink (result);
+} // check_member
+
+/**
+ * Check one random tuple.  Returns 1 if the two ways of writing it
+ * differ, and 0 if they agree.
+ */
+static int
+check_round (LouDBusWire *wire, int round, guint32 seed)
+{
+  gchar *types[CHECK_MEMBERS];  // The types of the members
+  GVariant *members[CHECK_MEMBERS];     // The members, as GVariants
+  GVariant *expected;           // The tuple, from GVariant
+  GVariant *actual;             // The tuple, from the encoder
+  gchar *signature;             // The type of the tuple
+  int nsizes;                   // How many of the sizes we may use
+  int n;                        // How many members there are
+  int i;                        // Counter variable
+  int result;                   // Did it fail?
+
+  nsizes = (round % CHECK_LARGE_EVERY == 0)
+           ? G_N_ELEMENTS (check_sizes) : G_N_ELEMENTS (check_sizes) - 2;
+  n = g_random_int_range (0, CHECK_MEMBERS + 1);
+  for (i = 0; i < n; i++)
+    types[i] = (gchar *) check_types[g_random_int_range (0,
+                                       G_N_ELEMENTS (check_types))];
+
+  loudbus_wire_begin (wire, types, n);
+  for (i = 0; i < n; i++)
+    members[i] = check_member (wire, types[i],
+                               check_sizes[g_random_int_range (0, nsizes)]);
+  actual = loudbus_wire_end (wire);
+  expected = g_variant_ref_sink (g_variant_new_tuple (members, n));
+  for (i = 0; i < n; i++)
+    g_variant_unref (members[i]);
+
+  result = 0;
+  if (actual == NULL)
+    {
+      fprintf (stderr, "round %d (seed %u): the encoder refused %s\n",
+               round, seed, g_variant_get_type_string (expected));
+      result = 1;
+    } // if the encoder failed
+  else
+    {
+      g_variant_ref_sink (actual);
+      if ((strcmp (g_variant_get_type_string (actual),
+                   g_variant_get_type_string (expected)) != 0)
+          || (g_variant_get_size (actual) != g_variant_get_size (expected))
+          || (memcmp (g_variant_get_data (actual),
+                      g_variant_get_data (expected),
+                      g_variant_get_size (expected)) != 0))
+        {
+          signature = g_strdup (g_variant_get_type_string (expected));
+          fprintf (stderr, "round %d (seed %u): %s differs "
+                   "(%lu bytes from the encoder, %lu from GVariant)\n",
+                   round, seed, signature,
+                   (unsigned long) g_variant_get_size (actual),
+                   (unsigned long) g_variant_get_size (expected));
+          g_free (signature);
+          result = 1;
+        } // if they differ
+      g_variant_unref (actual);
+    } // if the encoder wrote something
+  g_variant_unref (expected);
+  return result;
+} // check_round
+
+/**
+ * Check that the encoder refuses values that don't fit their types.
+ * Returns the number of values it accepted.
+ */
+static int
+check_refusals (LouDBusWire *wire)
+{
+  gchar *ints[] = { "i" };              // A single integer
+  gchar *strs[] = { "s", "i" };         // A string and an integer
+  gchar *bools[] = { "ab" };            // An array of booleans
+  gchar *arrays[] = { "as", "as" };     // Two arrays of strings
+  gint32 ivals[] = { 1, 2 };            // Some integers
+  GVariant *value;                      // A value of the wrong type
+  int failures;                         // How many it accepted
+
+  failures = 0;
+
+  loudbus_wire_begin (wire, ints, 1);
+  loudbus_wire_add_string (wire, "no");
+  failures += (loudbus_wire_end (wire) != NULL);
+
+  loudbus_wire_begin (wire, strs, 2);
+  loudbus_wire_add_string (wire, "\xff");
+  loudbus_wire_add_fixed (wire, &ivals[0]);
+  failures += (loudbus_wire_end (wire) != NULL);
+
+  loudbus_wire_begin (wire, strs, 2);
+  loudbus_wire_add_string (wire, "short");
+  failures += (loudbus_wire_end (wire) != NULL);
+
+  loudbus_wire_begin (wire, bools, 1);
+  loudbus_wire_add_fixed_array (wire, ivals, 2);
+  failures += (loudbus_wire_end (wire) != NULL);
+
+  loudbus_wire_begin (wire, arrays, 2);
+  loudbus_wire_open_array (wire);
+  loudbus_wire_open_array (wire);
+  failures += (loudbus_wire_end (wire) != NULL);
+
+  loudbus_wire_begin (wire, arrays, 2);
+  loudbus_wire_open_array (wire);
+  loudbus_wire_close_array (wire);
+  failures += (loudbus_wire_end (wire) != NULL);
+
+  value = g_variant_ref_sink (g_variant_new_uint32 (7));
+  loudbus_wire_begin (wire, ints, 1);
+  loudbus_wire_add_value (wire, value);
+  failures += (loudbus_wire_end (wire) != NULL);
+  g_variant_unref (value);
+
+  if (failures > 0)
+    fprintf (stderr, "the encoder accepted %d mismatched values\n",
+             failures);
+  return failures;
+} // check_refusals
+
+
+// +------+-----------------------------------------------------------
+// | Main |
+// +------+
+
+int
+main (int argc, char *argv[])
+{
+  LouDBusWire *wire;    // The encoder
+  guint32 seed;         // The seed for the random values
+  int failures;         // How many checks failed
+  int round;            // Counter variable
+
+  seed = (argc > 1) ? (guint32) strtoul (argv[1], NULL, 10) : CHECK_SEED;
+  g_random_set_seed (seed);
+
+  wire = loudbus_wire_new ();
+  failures = 0;
+  for (round = 0; round < CHECK_ROUNDS; round++)
+    failures += check_round (wire, round, seed);
+  failures += check_refusals (wire);
+  loudbus_wire_free (wire);
+
+  if (failures > 0)
+    {
+      fprintf (stderr, "loudbus-wire-check: %d failures\n", failures);
+      return 1;
+    } // if anything failed
+  printf ("loudbus-wire-check: %d tuples match\n", CHECK_ROUNDS);
+  return 0;
+} // main
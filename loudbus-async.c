@@ -0,0 +1,715 @@
+/**
+ * loudbus-async.c
+ *   Asynchronous calls for A D-Bus Client for Racket.  Calls are
+ *   queued by priority class and deadline and sent from a worker
+ *   thread, which keeps a limited number of them in flight.
+ *
+ * Copyright (c) 2012-15 Zarni Htet, Alexandra Greenberg, Mark Lewis,
+ * Evan Manuella, Samuel A. Rebelsky, Hart Russell, Mani Tiwaree,
+ * and Christine Tran.  All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the Lesser GNU General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+// +-------+----------------------------------------------------------
+// | Notes |
+// +-------+
+
+/*
+
+* Racket (BC, at least) runs on one OS thread, and we don't want GLib
+  to call back into it.  So the worker thread does all of the sending
+  and receiving, and the Racket side only queues calls and checks
+  tickets.  When a call finishes, the worker writes a byte to a pipe,
+  which lets Racket sleep until something happens.
+
+* Calls wait in a queue ordered by priority class, then by deadline
+  (earliest first, with no deadline last), then by the order in which
+  they arrived.  We only look at the queue when there's room in the
+  window of calls in flight, so the order only matters when the
+  window is full.
+
+* By default, every class shares the connection of the proxy.  A class
+  can be given a private connection of its own, so that (for example)
+  bulk calls can't fill the socket in front of interactive ones.
+
+ */
+
+
+// +---------+--------------------------------------------------------
+// | Headers |
+// +---------+
+
+#include <fcntl.h>      // For making the pipe non-blocking
+#include <unistd.h>     // For pipe, read, and write
+
+#include <glib.h>       // For various glib stuff.
+#include <gio/gio.h>    // For the GDBus functions.
+
+#include "loudbus-core.h"
+
+
+// +--------+---------------------------------------------------------
+// | Macros |
+// +--------+
+
+/**
+ * The number of calls we keep in flight unless told otherwise.
+ */
+#define LOUDBUS_DEFAULT_WINDOW 32
+
+/**
+ * Identifies a LouDBusTicket.
+ */
+#define LOUDBUS_TICKET_SIGNATURE 0x71c4e7
+
+
+// +-------+----------------------------------------------------------
+// | Types |
+// +-------+
+
+/**
+ * The stages in the life of a call.
+ */
+enum
+  {
+    LOUDBUS_TICKET_QUEUED,      // Waiting for room in the window
+    LOUDBUS_TICKET_SENT,        // In flight
+    LOUDBUS_TICKET_DONE         // Finished, successfully or not
+  };
+
+/**
+ * One asynchronous call.  Tickets are shared between the caller and
+ * the scheduler, each of which holds a reference.
+ */
+struct LouDBusTicket
+  {
+    int signature;              // Identifies this as a ticket
+    gint refcount;              // The number of references
+    gint state;                 // Where the call is
+    int priority;               // Its priority class
+    gint64 deadline;            // When it must finish (monotonic time,
+                                // in microseconds), or 0 for never
+    guint64 seq;                // The order in which calls arrived
+    GDBusProxy *proxy;          // The proxy to call through
+    gchar *method;              // The method to call
+    gchar *interface;           // Its interface
+    const gchar *member;        // Its name within the interface
+                                // (which points into method)
+    GVariant *actuals;          // The parameters
+    gboolean framed;            // Are byte arrays in frames?
+    LouDBusRing *ring;          // The ring some of them are in (or NULL)
+    GVariant *result;           // The result, once the call is done
+    GError *error;              // The error, if the call failed
+    GSequenceIter *iter;        // Our place in the queue, while queued
+    gint64 queued;              // When we queued it and when we sent it,
+    gint64 sent;                // in nanoseconds, if we're tracing
+    const gchar *track;         // The connection we sent it on (interned),
+                                // if we're tracing
+  };
+
+/**
+ * The state of the scheduler.  Everything but the worker's context,
+ * thread, and the pipe is protected by lock.
+ */
+struct LouDBusScheduler
+  {
+    GMutex lock;                // Protects the scheduler
+    GMainContext *context;      // The worker's context
+    GThread *thread;            // The worker
+    GSequence *queue;           // The calls that are waiting
+    int inflight;               // The number of calls in flight
+    int window;                 // The most calls we keep in flight
+    guint64 seq;                // The number of calls so far
+    GDBusConnection *lanes[LOUDBUS_PRIORITIES];
+                                // Private connections for each class,
+                                // or NULL to use the proxy's
+    int wake[2];                // The pipe that wakes Racket
+  };
+typedef struct LouDBusScheduler LouDBusScheduler;
+
+
+// +---------+--------------------------------------------------------
+// | Globals |
+// +---------+
+
+/**
+ * The scheduler, which we start when we need it.
+ */
+static LouDBusScheduler loudbus_scheduler;
+
+/**
+ * Makes sure that we only start the scheduler once.
+ */
+static gsize loudbus_scheduler_started = 0;
+
+
+// +--------------------------+---------------------------------------
+// | Selected Predeclarations |
+// +--------------------------+
+
+static gboolean loudbus_scheduler_pump (gpointer data);
+
+
+// +---------+--------------------------------------------------------
+// | Tickets |
+// +---------+
+
+/**
+ * Add a reference to a ticket.
+ */
+static LouDBusTicket *
+loudbus_ticket_ref (LouDBusTicket *ticket)
+{
+  g_atomic_int_inc (&ticket->refcount);
+  return ticket;
+} // loudbus_ticket_ref
+
+/**
+ * Drop a reference to a ticket, freeing it when no one uses it.
+ */
+void
+loudbus_ticket_unref (LouDBusTicket *ticket)
+{
+  if (! g_atomic_int_dec_and_test (&ticket->refcount))
+    return;
+
+  ticket->signature = 0;
+  g_object_unref (ticket->proxy);
+  g_free (ticket->method);
+  g_free (ticket->interface);
+  if (ticket->ring != NULL)
+    loudbus_ring_unref (ticket->ring);
+  if (ticket->actuals != NULL)
+    g_variant_unref (ticket->actuals);
+  if (ticket->result != NULL)
+    g_variant_unref (ticket->result);
+  if (ticket->error != NULL)
+    g_error_free (ticket->error);
+  g_free (ticket);
+} // loudbus_ticket_unref
+
+/**
+ * Determine whether something is really a ticket.
+ */
+int
+loudbus_ticket_validate (LouDBusTicket *ticket)
+{
+  return (ticket != NULL) && (ticket->signature == LOUDBUS_TICKET_SIGNATURE);
+} // loudbus_ticket_validate
+
+/**
+ * Has the call finished?
+ */
+int
+loudbus_ticket_done (LouDBusTicket *ticket)
+{
+  return g_atomic_int_get (&ticket->state) == LOUDBUS_TICKET_DONE;
+} // loudbus_ticket_done
+
+/**
+ * Get the result of a finished call.  Returns a new reference to the
+ * result, or NULL (setting errorp) if the call failed.
+ */
+GVariant *
+loudbus_ticket_result (LouDBusTicket *ticket, GError **errorp)
+{
+  if (ticket->result != NULL)
+    return g_variant_ref (ticket->result);
+  g_propagate_error (errorp, g_error_copy (ticket->error));
+  return NULL;
+} // loudbus_ticket_result
+
+/**
+ * Finish a call.  Called by the worker with the lock held.  Takes
+ * over result and error.
+ */
+static void
+loudbus_ticket_finish (LouDBusTicket *ticket, GVariant *result,
+                       GError *error)
+{
+  char byte = 0;        // What we write to the pipe
+  gint64 now;           // When the call finished, if we're tracing
+  const gchar *track;   // The track of the trace it goes on
+  const gchar *wire;    // The name of its time on the wire
+
+  // Record the time in the queue and on the wire.
+  if ((ticket->queued != 0) && loudbus_trace_enabled ())
+    {
+      now = loudbus_trace_now ();
+      track = (ticket->sent != 0) ? ticket->track : "queue";
+      loudbus_trace_async (track, "async", ticket->method, ticket->seq,
+                           'b', ticket->queued);
+      loudbus_trace_async (track, "async", "queued", ticket->seq,
+                           'b', ticket->queued);
+      loudbus_trace_async (track, "async", "queued", ticket->seq,
+                           'e', (ticket->sent != 0) ? ticket->sent : now);
+      if (ticket->sent != 0)
+        {
+          wire = (result != NULL) ? "wire" : "wire (failed)";
+          loudbus_trace_async (track, "async", wire, ticket->seq,
+                               'b', ticket->sent);
+          loudbus_trace_async (track, "async", wire, ticket->seq, 'e', now);
+        } // if the call went out
+      loudbus_trace_async (track, "async", ticket->method, ticket->seq,
+                           'e', now);
+    } // if we're tracing the call
+
+  ticket->result = result;
+  ticket->error = error;
+  if (g_atomic_int_get (&ticket->state) != LOUDBUS_TICKET_SENT)
+    loudbus_ring_tuple_release (ticket->ring, ticket->actuals);
+  if (ticket->actuals != NULL)
+    {
+      g_variant_unref (ticket->actuals);
+      ticket->actuals = NULL;
+    } // if (ticket->actuals != NULL)
+  g_atomic_int_set (&ticket->state, LOUDBUS_TICKET_DONE);
+
+  // Wake up Racket.  If the pipe is full, Racket is already going to
+  // wake up, so we don't care whether this works.
+  if (write (loudbus_scheduler.wake[1], &byte, 1) < 0)
+    LOG ("loudbus_ticket_finish: could not write to pipe");
+} // loudbus_ticket_finish
+
+
+// +---------------+--------------------------------------------------
+// | The Scheduler |
+// +---------------+
+
+/**
+ * Compare two queued tickets: by priority class, then by deadline,
+ * then by arrival.
+ */
+static gint
+loudbus_ticket_compare (gconstpointer a, gconstpointer b, gpointer data)
+{
+  const LouDBusTicket *ta = a;
+  const LouDBusTicket *tb = b;
+
+  if (ta->priority != tb->priority)
+    return (ta->priority < tb->priority) ? -1 : 1;
+  if (ta->deadline != tb->deadline)
+    {
+      if (ta->deadline == 0)
+        return 1;
+      if (tb->deadline == 0)
+        return -1;
+      return (ta->deadline < tb->deadline) ? -1 : 1;
+    } // if the deadlines differ
+  return (ta->seq < tb->seq) ? -1 : 1;
+} // loudbus_ticket_compare
+
+/**
+ * Name the track of a trace that the calls on a connection go on.
+ */
+static const gchar *
+loudbus_scheduler_track (GDBusConnection *connection)
+{
+  gchar *name;          // The name of the track
+  const gchar *track;   // The same, interned
+
+  name = g_strdup_printf ("connection %s",
+                          g_dbus_connection_get_unique_name (connection));
+  track = g_intern_string (name);
+  g_free (name);
+  return track;
+} // loudbus_scheduler_track
+
+/**
+ * The body of the worker thread.
+ */
+static gpointer
+loudbus_scheduler_run (gpointer data)
+{
+  GMainLoop *loop;      // The loop that runs the worker's context
+
+  g_main_context_push_thread_default (loudbus_scheduler.context);
+  loop = g_main_loop_new (loudbus_scheduler.context, FALSE);
+  g_main_loop_run (loop);
+  return NULL;
+} // loudbus_scheduler_run
+
+/**
+ * Start the scheduler, if it isn't already running.
+ */
+static void
+loudbus_scheduler_start (void)
+{
+  int i;                // Counter variable for the ends of the pipe
+
+  if (! g_once_init_enter (&loudbus_scheduler_started))
+    return;
+
+  g_mutex_init (&loudbus_scheduler.lock);
+  loudbus_scheduler.queue = g_sequence_new (NULL);
+  if (loudbus_scheduler.window <= 0)
+    loudbus_scheduler.window = LOUDBUS_DEFAULT_WINDOW;
+  if (pipe (loudbus_scheduler.wake) != 0)
+    g_error ("loudbus: could not create a pipe");
+  for (i = 0; i < 2; i++)
+    fcntl (loudbus_scheduler.wake[i], F_SETFL,
+           fcntl (loudbus_scheduler.wake[i], F_GETFL) | O_NONBLOCK);
+  loudbus_scheduler.context = g_main_context_new ();
+  loudbus_scheduler.thread =
+    g_thread_new ("loudbus", loudbus_scheduler_run, NULL);
+
+  g_once_init_leave (&loudbus_scheduler_started, 1);
+} // loudbus_scheduler_start
+
+/**
+ * Handle the reply to a call.  Runs on the worker.
+ */
+static void
+loudbus_scheduler_reply (GObject *source, GAsyncResult *res, gpointer data)
+{
+  LouDBusTicket *ticket = data; // The call that finished
+  GVariant *result;             // Its result
+  GVariant *framed;             // Its result, before we decode it
+  GError *error = NULL;         // Its error
+
+  result = g_dbus_connection_call_finish (G_DBUS_CONNECTION (source),
+                                          res, &error);
+  if (result == NULL)
+    loudbus_missing_record_call (ticket->proxy, ticket->method, error);
+  else
+    result = loudbus_spill_check_reply (result, ticket->ring, &error);
+  if ((result != NULL) && ticket->framed)
+    {
+      framed = result;
+      result = loudbus_ring_tuple (ticket->ring, framed, FALSE, 0, &error);
+      g_variant_unref (framed);
+    } // if the result needs decoding
+  g_mutex_lock (&loudbus_scheduler.lock);
+  loudbus_ticket_finish (ticket, result, error);
+  loudbus_scheduler.inflight--;
+  g_mutex_unlock (&loudbus_scheduler.lock);
+  loudbus_ticket_unref (ticket);
+
+  // There's room for another call.
+  loudbus_scheduler_pump (NULL);
+} // loudbus_scheduler_reply
+
+/**
+ * Send as many queued calls as the window allows.  Runs on the worker.
+ */
+static gboolean
+loudbus_scheduler_pump (gpointer data)
+{
+  LouDBusTicket *ticket;        // The next call
+  GSequenceIter *first;         // Its place in the queue
+  GDBusConnection *connection;  // The connection to send it on
+  gint timeout;                 // How long it may take, in milliseconds
+  gint64 now;                   // The current time
+  GError *error = NULL;         // Why we can't send a call
+
+  g_mutex_lock (&loudbus_scheduler.lock);
+  while ((loudbus_scheduler.inflight < loudbus_scheduler.window)
+         && (! g_sequence_is_empty (loudbus_scheduler.queue)))
+    {
+      first = g_sequence_get_begin_iter (loudbus_scheduler.queue);
+      ticket = g_sequence_get (first);
+      g_sequence_remove (first);
+      ticket->iter = NULL;
+
+      // Don't bother sending calls that are already too late.
+      timeout = -1;
+      if (ticket->deadline != 0)
+        {
+          now = g_get_monotonic_time ();
+          if (now >= ticket->deadline)
+            {
+              loudbus_ticket_finish (ticket, NULL,
+                                     g_error_new_literal
+                                       (G_IO_ERROR, G_IO_ERROR_TIMED_OUT,
+                                        "deadline passed while queued"));
+              loudbus_ticket_unref (ticket);
+              continue;
+            } // if the deadline has passed
+          timeout = MAX (1, (ticket->deadline - now) / 1000);
+        } // if the call has a deadline
+
+      connection = loudbus_scheduler.lanes[ticket->priority];
+      if (connection == NULL)
+        connection = g_dbus_proxy_get_connection (ticket->proxy);
+
+      // Don't send calls that are bigger than the connection allows.
+      if (! loudbus_connection_check_size (connection, ticket->actuals,
+                                           &error))
+        {
+          loudbus_ticket_finish (ticket, NULL, error);
+          error = NULL;
+          loudbus_ticket_unref (ticket);
+          continue;
+        } // if the call is too big
+
+      if (ticket->queued != 0)
+        {
+          ticket->sent = loudbus_trace_now ();
+          ticket->track = loudbus_scheduler_track (connection);
+        } // if we're tracing the call
+      g_atomic_int_set (&ticket->state, LOUDBUS_TICKET_SENT);
+      loudbus_scheduler.inflight++;
+      g_dbus_connection_call (connection,
+                              g_dbus_proxy_get_name (ticket->proxy),
+                              g_dbus_proxy_get_object_path (ticket->proxy),
+                              ticket->interface,
+                              ticket->member,
+                              ticket->actuals,
+                              NULL,
+                              G_DBUS_CALL_FLAGS_NONE,
+                              timeout,
+                              NULL,
+                              loudbus_scheduler_reply,
+                              ticket);
+    } // while there's room and there are calls
+  g_mutex_unlock (&loudbus_scheduler.lock);
+
+  return G_SOURCE_REMOVE;
+} // loudbus_scheduler_pump
+
+/**
+ * Fail a call whose deadline passed while it was still queued.  Runs
+ * on the worker, so that calls don't sit in a full queue long after
+ * their callers have given up.
+ */
+static gboolean
+loudbus_scheduler_expire (gpointer data)
+{
+  LouDBusTicket *ticket = data; // The call that may be late
+
+  g_mutex_lock (&loudbus_scheduler.lock);
+  if (ticket->iter != NULL)
+    {
+      g_sequence_remove (ticket->iter);
+      ticket->iter = NULL;
+      loudbus_ticket_finish (ticket, NULL,
+                             g_error_new_literal
+                               (G_IO_ERROR, G_IO_ERROR_TIMED_OUT,
+                                "deadline passed while queued"));
+      loudbus_ticket_unref (ticket);
+    } // if the call is still queued
+  g_mutex_unlock (&loudbus_scheduler.lock);
+
+  return G_SOURCE_REMOVE;
+} // loudbus_scheduler_expire
+
+
+// +--------------------+---------------------------------------------
+// | Asynchronous Calls |
+// +--------------------+
+
+/**
+ * Queue a call.  Takes over actuals if it is floating.  If timeout is
+ * non-negative, the call must finish within that many milliseconds.
+ * Returns a ticket, which the caller releases with loudbus_ticket_unref.
+ */
+LouDBusTicket *
+loudbus_call_async (LouDBusProxy *proxy, const gchar *method,
+                    GVariant *actuals, int priority, int timeout)
+{
+  LouDBusTicket *ticket;        // The ticket we return
+  GSource *expire;              // Fails the call if it's queued too long
+  GError *error = NULL;         // Why we won't send the call
+  int flags;                    // The LOUDBUS_METHOD_* flags of the method
+
+  loudbus_scheduler_start ();
+
+  if ((priority < 0) || (priority >= LOUDBUS_PRIORITIES))
+    priority = proxy->priority;
+
+  ticket = g_new0 (LouDBusTicket, 1);
+  ticket->signature = LOUDBUS_TICKET_SIGNATURE;
+  ticket->refcount = 2;         // One for the caller, one for us
+  ticket->state = LOUDBUS_TICKET_QUEUED;
+  ticket->priority = priority;
+  if (timeout >= 0)
+    ticket->deadline = g_get_monotonic_time () + (gint64) timeout * 1000;
+  ticket->proxy = g_object_ref (proxy->proxy);
+  ticket->method = g_strdup (method);
+  ticket->member = loudbus_method_split (ticket->proxy, ticket->method,
+                                         &ticket->interface);
+  ticket->actuals = (actuals == NULL) ? NULL : g_variant_ref_sink (actuals);
+  flags = loudbus_proxy_method_flags (proxy, method);
+  if ((actuals != NULL) && (flags & LOUDBUS_METHOD_FRAMED))
+    {
+      ticket->framed = TRUE;
+      if ((flags & LOUDBUS_METHOD_RING) && (proxy->ring != NULL))
+        ticket->ring = loudbus_ring_ref (proxy->ring);
+      ticket->actuals =
+        loudbus_ring_tuple (ticket->ring, actuals, TRUE,
+                            (flags & LOUDBUS_METHOD_COMPRESS)
+                              ? LOUDBUS_FRAME_THRESHOLD : G_MAXSIZE,
+                            NULL);
+      g_variant_unref (actuals);
+    } // if the byte arrays travel in frames
+
+  // Calls to things we know are missing fail right away.
+  if (loudbus_missing_check_call (ticket->proxy, method, &error))
+    {
+      g_mutex_lock (&loudbus_scheduler.lock);
+      loudbus_ticket_finish (ticket, NULL, error);
+      g_mutex_unlock (&loudbus_scheduler.lock);
+      loudbus_ticket_unref (ticket);
+      return ticket;
+    } // if we know something is missing
+
+  g_mutex_lock (&loudbus_scheduler.lock);
+  ticket->seq = loudbus_scheduler.seq++;
+  if (loudbus_trace_enabled ())
+    ticket->queued = loudbus_trace_now ();
+  ticket->iter = g_sequence_insert_sorted (loudbus_scheduler.queue, ticket,
+                                           loudbus_ticket_compare, NULL);
+  g_mutex_unlock (&loudbus_scheduler.lock);
+
+  if (timeout >= 0)
+    {
+      expire = g_timeout_source_new (timeout);
+      g_source_set_callback (expire, loudbus_scheduler_expire,
+                             loudbus_ticket_ref (ticket),
+                             (GDestroyNotify) loudbus_ticket_unref);
+      g_source_attach (expire, loudbus_scheduler.context);
+      g_source_unref (expire);
+    } // if (timeout >= 0)
+
+  g_main_context_invoke (loudbus_scheduler.context,
+                         loudbus_scheduler_pump, NULL);
+  return ticket;
+} // loudbus_call_async
+
+/**
+ * Set the number of calls we keep in flight.
+ */
+void
+loudbus_scheduler_set_window (int window)
+{
+  loudbus_scheduler_start ();
+  g_mutex_lock (&loudbus_scheduler.lock);
+  loudbus_scheduler.window = MAX (1, window);
+  g_mutex_unlock (&loudbus_scheduler.lock);
+  g_main_context_invoke (loudbus_scheduler.context,
+                         loudbus_scheduler_pump, NULL);
+} // loudbus_scheduler_set_window
+
+/**
+ * Give a priority class a private connection to the session bus (or,
+ * if separate is false, go back to sharing the proxy's connection).
+ * Returns FALSE (setting errorp) if we can't connect.
+ */
+gboolean
+loudbus_scheduler_separate_lane (int priority, gboolean separate,
+                                 GError **errorp)
+{
+  GDBusConnection *connection = NULL;   // The new connection
+  GDBusConnection *old;                 // The one it replaces
+  gchar *address;                       // The address of the bus
+
+  if ((priority < 0) || (priority >= LOUDBUS_PRIORITIES))
+    return FALSE;
+  loudbus_scheduler_start ();
+
+  // Keep the connection we have, along with its settings.
+  connection = loudbus_scheduler_lane (priority);
+  if (separate && (connection != NULL))
+    {
+      g_object_unref (connection);
+      return TRUE;
+    } // if the class already has a connection
+  if (connection != NULL)
+    g_object_unref (connection);
+  connection = NULL;
+
+  if (separate)
+    {
+      address = g_dbus_address_get_for_bus_sync (G_BUS_TYPE_SESSION,
+                                                 NULL, errorp);
+      if (address == NULL)
+        return FALSE;
+      connection = g_dbus_connection_new_for_address_sync
+        (address,
+         G_DBUS_CONNECTION_FLAGS_AUTHENTICATION_CLIENT
+         | G_DBUS_CONNECTION_FLAGS_MESSAGE_BUS_CONNECTION,
+         NULL, NULL, errorp);
+      g_free (address);
+      if (connection == NULL)
+        return FALSE;
+      loudbus_spill_watch (connection);
+    } // if (separate)
+
+  // Calls in flight on the old connection keep their own references.
+  g_mutex_lock (&loudbus_scheduler.lock);
+  old = loudbus_scheduler.lanes[priority];
+  loudbus_scheduler.lanes[priority] = connection;
+  g_mutex_unlock (&loudbus_scheduler.lock);
+  if (old != NULL)
+    g_object_unref (old);
+
+  return TRUE;
+} // loudbus_scheduler_separate_lane
+
+/**
+ * Get the private connection of a priority class, or NULL if the
+ * class shares the connections of its proxies.  The caller owns the
+ * returned reference.
+ */
+GDBusConnection *
+loudbus_scheduler_lane (int priority)
+{
+  GDBusConnection *connection;  // The connection
+
+  if ((priority < 0) || (priority >= LOUDBUS_PRIORITIES))
+    return NULL;
+  loudbus_scheduler_start ();
+  g_mutex_lock (&loudbus_scheduler.lock);
+  connection = loudbus_scheduler.lanes[priority];
+  if (connection != NULL)
+    g_object_ref (connection);
+  g_mutex_unlock (&loudbus_scheduler.lock);
+  return connection;
+} // loudbus_scheduler_lane
+
+/**
+ * Get the file descriptor that becomes readable when a call finishes.
+ */
+int
+loudbus_wake_fd (void)
+{
+  loudbus_scheduler_start ();
+  return loudbus_scheduler.wake[0];
+} // loudbus_wake_fd
+
+/**
+ * Empty the pipe behind loudbus_wake_fd.  Callers should check their
+ * tickets after draining, not before.
+ */
+void
+loudbus_wake_drain (void)
+{
+  char buf[64];         // Whatever was in the pipe
+
+  while (read (loudbus_scheduler.wake[0], buf, sizeof (buf)) > 0)
+    ;
+} // loudbus_wake_drain
+
+/**
+ * Get the worker's context, so that other parts of louDBus can run
+ * things on the worker.
+ */
+GMainContext *
+loudbus_worker_context (void)
+{
+  loudbus_scheduler_start ();
+  return loudbus_scheduler.context;
+} // loudbus_worker_context
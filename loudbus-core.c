@@ -0,0 +1,3039 @@
+/**
+ * loudbus-core.c
+ *   The core of A D-Bus Client for Racket.  See loudbus-core.h.
+ *
+ * Copyright (c) 2012-15 Zarni Htet, Alexandra Greenberg, Mark Lewis, 
+ * Evan Manuella, Samuel A. Rebelsky, Hart Russell, Mani Tiwaree,
+ * and Christine Tran.  All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the Lesser GNU General Public License as published 
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+// +---------+--------------------------------------------------------
+// | Headers |
+// +---------+
+
+#include <stdlib.h>     // For random and such
+#include <string.h>     // For memcpy
+#include <time.h>       // For seeing our random number generator
+#include <sys/socket.h> // For SOL_SOCKET and friends
+
+#include <glib.h>       // For various glib stuff.
+#include <gio/gio.h>    // For the GDBus functions.
+#include <gio/gunixfdlist.h>    // For passing descriptors
+
+#include "loudbus-core.h"
+
+
+// +--------+---------------------------------------------------------
+// | Macros |
+// +--------+
+
+/**
+ * The flags we use when building GDBus proxies.  We only use proxies
+ * to make calls, so we don't need GDBus to fetch properties or to
+ * watch for signals.
+ */
+#define LOUDBUS_PROXY_FLAGS \
+  (G_DBUS_PROXY_FLAGS_DO_NOT_LOAD_PROPERTIES \
+   | G_DBUS_PROXY_FLAGS_DO_NOT_CONNECT_SIGNALS)
+
+/**
+ * The interface of the GDBus proxy behind a node proxy, and the name
+ * of the interface information that node proxies share.  Node proxies
+ * name each method in full (interface.method), so this interface only
+ * matters for introspecting, and every object that describes itself
+ * has it.
+ */
+#define LOUDBUS_NODE_INTERFACE "org.freedesktop.DBus.Introspectable"
+
+/**
+ * Pack the three characters at s into the key of a trigram.
+ */
+#define LOUDBUS_TRIGRAM(s) \
+  (((guint) (guchar) (s)[0] << 16) | ((guint) (guchar) (s)[1] << 8) \
+   | (guint) (guchar) (s)[2])
+
+/**
+ * The error domain we use to stop scanning XML once we've found what
+ * we want.
+ */
+#define LOUDBUS_XML_SCAN_DONE \
+  g_quark_from_static_string ("loudbus-xml-scan-done")
+
+/**
+ * How long (in milliseconds) we remember that something is missing,
+ * unless told otherwise.
+ */
+#define LOUDBUS_MISSING_TTL 5000
+
+/**
+ * The key under which we keep the largest message a connection may
+ * send.
+ */
+#define LOUDBUS_MAX_MESSAGE_KEY "loudbus-max-message"
+
+/**
+ * Where a timeout goes in the key of what's missing from a service,
+ * in place of the object.
+ */
+#define LOUDBUS_MISSING_TIMEOUT "*timeout"
+
+/**
+ * The size of the first block in the scratch arena.
+ */
+#define LOUDBUS_ARENA_INITIAL_SIZE 4096
+
+/**
+ * The largest block that the scratch arena keeps from call to call.
+ * Calls that need more than this still work, but their extra space
+ * is returned when the call finishes.
+ */
+#define LOUDBUS_ARENA_MAX_RETAINED (1024 * 1024)
+
+
+// +-------+----------------------------------------------------------
+// | Types |
+// +-------+
+
+/**
+ * Something we found to be missing: the error we got when we looked
+ * for it, and when we should stop believing it.
+ */
+struct LouDBusMissing
+  {
+    GError *error;              // What went wrong
+    gint64 expires;             // When to forget (monotonic time)
+  };
+typedef struct LouDBusMissing LouDBusMissing;
+
+/**
+ * What we know about the methods of an interface beyond what calls
+ * need: an index of the trigrams in their names, for searching, and
+ * their details (argument names and annotations), for method info.
+ * Each part is built the first time someone needs it, and lasts as
+ * long as the interface.
+ */
+struct LouDBusCatalogue
+  {
+    GHashTable *trigrams;       // Maps each trigram of the names to a
+                                // GArray of the positions (in the
+                                // sorted index) of the names that
+                                // contain it
+    GVariant **details;         // The details of each method, as
+                                // "(a(ss)a(ss)as)", or NULL
+  };
+typedef struct LouDBusCatalogue LouDBusCatalogue;
+
+/**
+ * The state of a scan through introspection XML for one interface (or,
+ * for node proxies, all of them).
+ */
+struct LouDBusXMLScan
+  {
+    const gchar *interface;     // The name of the interface we want
+                                // (NULL for all of them)
+    gchar *current;             // When reading all of them, the name
+                                // of the one we're in
+    int depth;                  // How deeply nested the current element is
+    int skip;                   // The depth of the element whose contents
+                                // we're skipping (0 if we're not skipping)
+    int inside;                 // The depth of the interface element
+                                // (0 if we're not in the interface)
+    gboolean found;             // Have we read the whole interface?
+    gchar *method;              // The name of the current method (NULL
+                                // if we're not in a method)
+    GString *signature;         // The signature of the current method
+    int flags;                  // The flags of the current method
+    GArray *specs;              // The methods we've read
+    GStringChunk *strings;      // Storage for names and signatures
+  };
+typedef struct LouDBusXMLScan LouDBusXMLScan;
+
+/**
+ * The phases of one call that a thread is sampling for a profiler.
+ */
+struct LouDBusTimingSample
+  {
+    gboolean on;                // Are we sampling a call?
+    LouDBusCallTimes times;     // Where its time has gone so far
+    gint64 starts[LOUDBUS_PHASES];
+                                // When each phase first started
+  };
+typedef struct LouDBusTimingSample LouDBusTimingSample;
+
+
+// +---------+--------------------------------------------------------
+// | Globals |
+// +---------+
+
+/**
+ * The scratch arena used by calls.  Reset at the start of each call.
+ */
+LouDBusArena loudbus_scratch;
+
+/**
+ * The interned interfaces, indexed by the digest of their methods.  The
+ * table does not hold references; interfaces remove themselves when
+ * the last proxy lets go of them.
+ */
+static GHashTable *loudbus_interfaces = NULL;
+
+/**
+ * The interfaces we've already seen on each service, indexed by
+ * "service\ninterface".  When we find one here, we can build a proxy
+ * without introspecting.  Like loudbus_interfaces, it does not hold
+ * references.
+ */
+static GHashTable *loudbus_known_interfaces = NULL;
+
+/**
+ * The services, objects, and methods we recently found to be missing,
+ * indexed by "service\n", "service\nobject\ninterface", or
+ * "service\nobject\ninterface\nmethod".  Each value is a
+ * LouDBusMissing.  Protected by loudbus_missing_lock, since the
+ * scheduler's worker uses it, too.
+ */
+static GHashTable *loudbus_missing = NULL;
+static GMutex loudbus_missing_lock;
+
+/**
+ * The number of entries in loudbus_missing.  Lets calls skip the
+ * lock and the lookup when nothing is missing, which is most of the
+ * time.
+ */
+static gint loudbus_missing_count = 0;
+
+/**
+ * How long we remember that something is missing, in milliseconds.
+ * 0 means we don't remember.
+ */
+static gint loudbus_missing_ttl = LOUDBUS_MISSING_TTL;
+
+/**
+ * Have we subscribed to NameOwnerChanged?
+ */
+static gint loudbus_missing_watching = FALSE;
+
+/**
+ * Are we timing calls, and where has the time gone?  The totals are
+ * protected by loudbus_timing_lock.
+ */
+static gint loudbus_timing_on = FALSE;
+static LouDBusCallTimes loudbus_timing_totals;
+static GMutex loudbus_timing_lock;
+
+/**
+ * The call each thread is sampling (see loudbus_timing_sample_begin),
+ * and the number of threads sampling one, which lets other calls skip
+ * the lookup.
+ */
+static GPrivate loudbus_timing_sample = G_PRIVATE_INIT (g_free);
+static gint loudbus_timing_samplers = 0;
+
+
+// +------------+-----------------------------------------------------
+// | Core Setup |
+// +------------+
+
+/**
+ * Set up the core.  Safe to call more than once.
+ */
+void
+loudbus_core_init (void)
+{
+  // Only do this once
+  if (loudbus_interfaces != NULL)
+    return;
+
+  // Seed our random number generator
+  srandom (time (NULL));
+
+  // Set up the tables of interfaces
+  loudbus_interfaces = g_hash_table_new (g_str_hash, g_str_equal);
+  loudbus_known_interfaces = 
+    g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+
+  // Although g_type_init is deprecated since GLIB 2.36, it seems to be 
+  // needed in the version of GLib we have installed in MathLAN.
+  LOG ("GLIB %d.%d.%d", 
+       GLIB_MAJOR_VERSION, GLIB_MINOR_VERSION, GLIB_MICRO_VERSION);
+  if ((GLIB_MAJOR_VERSION == 2) && (GLIB_MINOR_VERSION < 36)) 
+    {
+      g_type_init ();
+    } // if before 2.36
+} // loudbus_core_init
+
+
+// +-----------------+------------------------------------------------
+// | Local Utilities |
+// +-----------------+
+
+/**
+ * Get the signature used to identify LouDBusProxy objects.
+ */
+static int
+loudbus_proxy_signature (void)
+{
+  static int signature = 0;     // The signature.
+
+  // Get a non-zero signature.
+  while (signature == 0)
+    {
+      signature = random ();
+    } // while (signature == 0)
+
+  return signature;
+} // loudbus_proxy_signature
+
+/**
+ * Get the introspection data for the object behind a proxy.  Returns
+ * a GVariant that holds the XML as its only child, or NULL (setting
+ * errorp) if the object doesn't describe itself.
+ */
+static GVariant *
+g_dbus_proxy_introspect (GDBusProxy *proxy, GError **errorp)
+{
+  return 
+    g_dbus_proxy_call_sync (proxy, 
+                            "org.freedesktop.DBus.Introspectable.Introspect",
+                            NULL, 
+                            G_DBUS_CALL_FLAGS_NONE,
+                            -1,
+                            NULL,
+                            errorp);
+} // g_dbus_proxy_introspect
+
+/**
+ * Get information on the proxy.
+ */
+GDBusNodeInfo *
+g_dbus_proxy_get_node_info (GDBusProxy *proxy)
+{
+  GError *error;                // Error returned by various functions.
+  GVariant *response;           // The response from the proxy call.
+  GDBusNodeInfo *info;          // Information on the node.
+  const gchar *xml;             // XML code for the proxy interface.
+
+  // Get the introspection data
+  error = NULL;
+  response = g_dbus_proxy_introspect (proxy, &error);
+  if (response == NULL)
+    {
+      g_clear_error (&error);
+      return NULL;
+    } // if (response == NULL)
+
+  // Get the XML from the introspection data
+  g_variant_get (response, "(&s)", &xml);
+
+  // Build an object that lets us explore the introspection data.
+  error = NULL;
+  info = g_dbus_node_info_new_for_xml (xml, &error);
+  g_variant_unref (response);
+  if (info == NULL)
+    {
+      g_clear_error (&error);
+      return NULL;
+    } // if (info == NULL)
+
+  // And return that object
+  return info;
+} // g_dbus_proxy_get_node_info
+
+/**
+ * Determine the length of a null-terminated array of pointers.
+ */
+int
+parray_len (gpointer *arr)
+{
+  int i;                // Index into the array
+  if (arr == NULL)
+    return 0;
+  for (i = 0; arr[i] != NULL; i++)
+    ;
+  return i;
+} // parray_len
+
+
+// +---------------+--------------------------------------------------
+// | Scratch Arena |
+// +---------------+
+
+/**
+ * Allocate n bytes from the arena.  The memory remains valid until the
+ * next call to loudbus_arena_reset.
+ */
+gpointer
+loudbus_arena_alloc (LouDBusArena *arena, gsize n)
+{
+  gpointer mem;         // The memory we return
+
+  // Keep everything aligned for doubles and 64-bit integers.
+  n = (n + 7) & ~((gsize) 7);
+
+  // Build the first block lazily.
+  if (arena->block == NULL)
+    {
+      arena->block = g_malloc (LOUDBUS_ARENA_INITIAL_SIZE);
+      arena->size = LOUDBUS_ARENA_INITIAL_SIZE;
+      arena->used = 0;
+    } // if (arena->block == NULL)
+
+  // Normal case: It fits in the block.
+  if (arena->used + n <= arena->size)
+    {
+      mem = arena->block + arena->used;
+      arena->used += n;
+      return mem;
+    } // if it fits
+
+  // Special case: Overflow.  Make a separate block and remember it.
+  mem = g_malloc (n);
+  arena->overflow = g_slist_prepend (arena->overflow, mem);
+  arena->overflow_size += n;
+  return mem;
+} // loudbus_arena_alloc
+
+/**
+ * Copy len bytes of str into the arena, adding a terminating null.
+ */
+gchar *
+loudbus_arena_strndup (LouDBusArena *arena, const gchar *str, gsize len)
+{
+  gchar *copy;          // The copy we're making
+
+  copy = loudbus_arena_alloc (arena, len + 1);
+  memcpy (copy, str, len);
+  copy[len] = '\0';
+  return copy;
+} // loudbus_arena_strndup
+
+/**
+ * Release everything allocated from the arena.  If the last call
+ * overflowed the block, grow the block (within reason) so that the
+ * next similar call fits.
+ */
+void
+loudbus_arena_reset (LouDBusArena *arena)
+{
+  gsize needed;         // The size that would have sufficed
+
+  if (arena->overflow != NULL)
+    {
+      needed = arena->size + arena->overflow_size;
+      g_slist_free_full (arena->overflow, g_free);
+      arena->overflow = NULL;
+      arena->overflow_size = 0;
+      if (needed <= LOUDBUS_ARENA_MAX_RETAINED)
+        {
+          g_free (arena->block);
+          arena->block = g_malloc (needed);
+          arena->size = needed;
+        } // if the combined size is reasonable
+    } // if (arena->overflow != NULL)
+
+  arena->used = 0;
+} // loudbus_arena_reset
+
+
+// +-------------------+----------------------------------------------
+// | Method Catalogues |
+// +-------------------+
+
+/**
+ * Get the catalogue of an interface, creating an empty one if it has
+ * none.
+ */
+static LouDBusCatalogue *
+loudbus_catalogue_get (LouDBusInterface *iface)
+{
+  if (iface->catalogue == NULL)
+    iface->catalogue = g_new0 (LouDBusCatalogue, 1);
+  return iface->catalogue;
+} // loudbus_catalogue_get
+
+/**
+ * Free the catalogue of an interface, if it has one.
+ */
+static void
+loudbus_catalogue_free (LouDBusInterface *iface)
+{
+  LouDBusCatalogue *catalogue;  // The catalogue
+  int m;                        // Counter variable for methods
+
+  catalogue = iface->catalogue;
+  if (catalogue == NULL)
+    return;
+  if (catalogue->trigrams != NULL)
+    g_hash_table_destroy (catalogue->trigrams);
+  if (catalogue->details != NULL)
+    {
+      for (m = 0; m < iface->nmethods; m++)
+        if (catalogue->details[m] != NULL)
+          g_variant_unref (catalogue->details[m]);
+      g_free (catalogue->details);
+    } // if we have the details
+  g_free (catalogue);
+  iface->catalogue = NULL;
+} // loudbus_catalogue_free
+
+/**
+ * Index the trigrams in the names of the methods of an interface.
+ * Each posting list holds positions in iface->sorted, in order, so
+ * searches find names in alphabetical order.
+ */
+static void
+loudbus_catalogue_index (LouDBusInterface *iface, 
+                         LouDBusCatalogue *catalogue)
+{
+  GArray *positions;            // The positions of one trigram
+  const gchar *name;            // The name of one method
+  gpointer key;                 // The key for one trigram
+  guint32 pos;                  // One position in the sorted index
+  gsize len;                    // The length of that name
+  gsize i;                      // Counter variable for characters
+
+  catalogue->trigrams = 
+    g_hash_table_new_full (g_direct_hash, g_direct_equal, NULL,
+                           (GDestroyNotify) g_array_unref);
+  for (pos = 0; pos < (guint32) iface->nmethods; pos++)
+    {
+      name = iface->methods[iface->sorted[pos]].name;
+      len = strlen (name);
+      for (i = 0; i + 3 <= len; i++)
+        {
+          key = GUINT_TO_POINTER (LOUDBUS_TRIGRAM (name + i));
+          positions = g_hash_table_lookup (catalogue->trigrams, key);
+          if (positions == NULL)
+            {
+              positions = g_array_new (FALSE, FALSE, sizeof (guint32));
+              g_hash_table_insert (catalogue->trigrams, key, positions);
+            } // if it's a new trigram
+          // A name that repeats a trigram goes in the list once.
+          if ((positions->len == 0)
+              || (g_array_index (positions, guint32, positions->len - 1)
+                  != pos))
+            g_array_append_val (positions, pos);
+        } // for each trigram in the name
+    } // for each method
+} // loudbus_catalogue_index
+
+/**
+ * Describe one method, as "(a(ss)a(ss)as)": the names and signatures
+ * of the parameters, the names and signatures of the return values,
+ * and the values of the annotations.
+ */
+static GVariant *
+loudbus_method_details (GDBusMethodInfo *method)
+{
+  GVariantBuilder builder;      // Builds the result
+  int m;                        // Counter variable
+
+  g_variant_builder_init (&builder, G_VARIANT_TYPE ("(a(ss)a(ss)as)"));
+  g_variant_builder_open (&builder, G_VARIANT_TYPE ("a(ss)"));
+  for (m = 0; m < parray_len ((gpointer *) method->in_args); m++)
+    g_variant_builder_add (&builder, "(ss)",
+                           method->in_args[m]->name, 
+                           method->in_args[m]->signature);
+  g_variant_builder_close (&builder);
+  g_variant_builder_open (&builder, G_VARIANT_TYPE ("a(ss)"));
+  for (m = 0; m < parray_len ((gpointer *) method->out_args); m++)
+    g_variant_builder_add (&builder, "(ss)",
+                           method->out_args[m]->name, 
+                           method->out_args[m]->signature);
+  g_variant_builder_close (&builder);
+  g_variant_builder_open (&builder, G_VARIANT_TYPE ("as"));
+  for (m = 0; m < parray_len ((gpointer *) method->annotations); m++)
+    g_variant_builder_add (&builder, "s", method->annotations[m]->value);
+  g_variant_builder_close (&builder);
+  return g_variant_ref_sink (g_variant_builder_end (&builder));
+} // loudbus_method_details
+
+/**
+ * Find the methods whose names start with prefix.  They sit together
+ * in the sorted index, so we return how many there are and set *first
+ * to the position of the first one.
+ */
+int
+loudbus_interface_complete (LouDBusInterface *iface, const gchar *prefix,
+                            int *first)
+{
+  int lo = 0;           // Lower bound of the search (inclusive)
+  int hi;               // Upper bound of the search (exclusive)
+  int mid;              // Midpoint
+  gsize len;            // The length of the prefix
+
+  hi = iface->nmethods;
+  while (lo < hi)
+    {
+      mid = lo + (hi - lo) / 2;
+      if (strcmp (iface->methods[iface->sorted[mid]].name, prefix) < 0)
+        lo = mid + 1;
+      else
+        hi = mid;
+    } // while
+
+  *first = lo;
+  len = strlen (prefix);
+  for (hi = lo; hi < iface->nmethods; hi++)
+    if (strncmp (iface->methods[iface->sorted[hi]].name, prefix, len) != 0)
+      break;
+  return hi - lo;
+} // loudbus_interface_complete
+
+/**
+ * Find the methods whose names contain text.  Fills in matches (which
+ * must have room for every method) with their positions in the sorted
+ * index, in order, and returns how many there are.  For text of three
+ * or more characters, we only check the names that contain its rarest
+ * trigram.
+ */
+int
+loudbus_interface_search (LouDBusInterface *iface, const gchar *text,
+                          guint32 *matches)
+{
+  LouDBusCatalogue *catalogue;  // Where we keep the index
+  GArray *positions;            // The positions of one trigram
+  GArray *best = NULL;          // The positions of the rarest trigram
+  const gchar *name;            // The name of one method
+  gsize len;                    // The length of the text
+  gsize i;                      // Counter variable
+  int n = 0;                    // The number of matches
+
+  len = strlen (text);
+  if (len < 3)
+    {
+      for (i = 0; i < (gsize) iface->nmethods; i++)
+        {
+          name = iface->methods[iface->sorted[i]].name;
+          if (strstr (name, text) != NULL)
+            matches[n++] = i;
+        } // for each method
+      return n;
+    } // if the text is too short to index
+
+  catalogue = loudbus_catalogue_get (iface);
+  if (catalogue->trigrams == NULL)
+    loudbus_catalogue_index (iface, catalogue);
+  for (i = 0; i + 3 <= len; i++)
+    {
+      positions = g_hash_table_lookup (catalogue->trigrams,
+                                       GUINT_TO_POINTER 
+                                         (LOUDBUS_TRIGRAM (text + i)));
+      if (positions == NULL)
+        return 0;
+      if ((best == NULL) || (positions->len < best->len))
+        best = positions;
+    } // for each trigram in the text
+
+  for (i = 0; i < best->len; i++)
+    {
+      name = iface->methods[iface->sorted[g_array_index (best, guint32, i)]]
+               .name;
+      if (strstr (name, text) != NULL)
+        matches[n++] = g_array_index (best, guint32, i);
+    } // for each candidate
+  return n;
+} // loudbus_interface_search
+
+/**
+ * Get the details of a method of an interface (see
+ * loudbus_method_details), introspecting through proxy the first time
+ * anyone asks about the interface.  The interface keeps the result, so
+ * the caller should not unref it.  Returns NULL and sets errorp if we
+ * can't get the details.
+ *
+ * Interfaces that differ only in argument names and annotations are
+ * the same interface, so the details come from the first object that
+ * we ask.
+ */
+GVariant *
+loudbus_interface_details (LouDBusInterface *iface, GDBusProxy *proxy,
+                           LouDBusMethod *method, GError **errorp)
+{
+  LouDBusCatalogue *catalogue;  // Where we keep the details
+  GDBusNodeInfo *ninfo;         // Information on the object
+  GDBusInterfaceInfo *iinfo;    // Information on one interface
+  GDBusMethodInfo *minfo;       // Information on one method
+  const gchar *name;            // The name of one method
+  const gchar *dot;             // The dot in a full name
+  gchar *interface;             // The interface of that method
+  GVariant *details;            // The details of the method
+  int m;                        // Counter variable for methods
+
+  catalogue = loudbus_catalogue_get (iface);
+  if (catalogue->details == NULL)
+    {
+      ninfo = g_dbus_proxy_get_node_info (proxy);
+      if (ninfo == NULL)
+        {
+          g_set_error (errorp, G_DBUS_ERROR, G_DBUS_ERROR_FAILED,
+                       "could not get information on the object");
+          return NULL;
+        } // if (ninfo == NULL)
+
+      // Node proxies name their methods in full; others use the
+      // interface's name.
+      catalogue->details = g_new0 (GVariant *, iface->nmethods);
+      for (m = 0; m < iface->nmethods; m++)
+        {
+          name = iface->methods[m].name;
+          dot = strrchr (name, '.');
+          interface = (dot == NULL) 
+                      ? g_strdup (iface->name)
+                      : g_strndup (name, dot - name);
+          iinfo = g_dbus_node_info_lookup_interface (ninfo, interface);
+          minfo = (iinfo == NULL) 
+                  ? NULL
+                  : g_dbus_interface_info_lookup_method 
+                      (iinfo, (dot == NULL) ? name : dot + 1);
+          if (minfo != NULL)
+            catalogue->details[m] = loudbus_method_details (minfo);
+          g_free (interface);
+        } // for each method
+      g_dbus_node_info_unref (ninfo);
+    } // if we don't have the details yet
+
+  details = catalogue->details[method - iface->methods];
+  if (details == NULL)
+    g_set_error (errorp, G_DBUS_ERROR, G_DBUS_ERROR_UNKNOWN_METHOD,
+                 "no such method: %s", method->name);
+  return details;
+} // loudbus_interface_details
+
+
+// +-----------------------+------------------------------------------
+// | Interface Information |
+// +-----------------------+
+
+/**
+ * Compare two methods by name, given their indices.  (A helper for
+ * sorting the index of an interface.)
+ */
+static gint
+loudbus_method_index_compare (gconstpointer a, gconstpointer b, 
+                              gpointer methods)
+{
+  return strcmp (((LouDBusMethod *) methods)[*(guint32 *) a].name,
+                 ((LouDBusMethod *) methods)[*(guint32 *) b].name);
+} // loudbus_method_index_compare
+
+/**
+ * Count the complete types in a D-Bus signature.
+ */
+static int
+dbus_signature_count_types (const gchar *signature)
+{
+  const gchar *end;     // The end of one complete type
+  int n = 0;            // The number of types we've seen
+
+  while (*signature != '\0')
+    {
+      if (! g_variant_type_string_scan (signature, NULL, &end))
+        break;
+      signature = end;
+      n++;
+    } // while
+
+  return n;
+} // dbus_signature_count_types
+
+/**
+ * Build the compact form of an interface from a list of method specs.
+ * We make two passes over the specs: one to figure out how much space
+ * we need and one to fill it in.
+ */
+static LouDBusInterface *
+loudbus_interface_new (const gchar *name, const gchar *digest,
+                       int n, LouDBusMethodSpec *specs)
+{
+  LouDBusInterface *iface;      // The interface we're building
+  const gchar *sig;             // One parameter signature
+  const gchar *end;             // The end of that signature
+  gchar **args;                 // Where the next argument signatures go
+  gchar *pool;                  // Where the next string goes
+  gsize strsize;                // Space needed for strings
+  int nargs;                    // The total number of parameters
+  int m;                        // Counter variable for methods
+  int a;                        // Counter variable for arguments
+
+  // Pass 1: Measure.  Each parameter signature gets its own terminator,
+  // so we need one more byte per parameter than the signatures take.
+  nargs = 0;
+  strsize = strlen (digest) + 1 + strlen (name) + 1;
+  for (m = 0; m < n; m++)
+    {
+      a = dbus_signature_count_types (specs[m].signature);
+      strsize += strlen (specs[m].name) + 1;
+      strsize += strlen (specs[m].signature) + a;
+      nargs += a;
+    } // for each method
+
+  // Allocate it all in one piece.  Pointers go first, so that they
+  // stay aligned.
+  iface = g_malloc (sizeof (LouDBusInterface)
+                    + n * sizeof (LouDBusMethod)
+                    + nargs * sizeof (gchar *)
+                    + n * sizeof (guint32)
+                    + strsize);
+  iface->nmethods = n;
+  iface->methods = (LouDBusMethod *) (iface + 1);
+  args = (gchar **) (iface->methods + n);
+  iface->sorted = (guint32 *) (args + nargs);
+  pool = (gchar *) (iface->sorted + n);
+
+  // Pass 2: Fill in
+  iface->refcount = 1;
+  iface->catalogue = NULL;
+  iface->digest = pool;
+  pool = g_stpcpy (pool, digest) + 1;
+  iface->name = pool;
+  pool = g_stpcpy (pool, name) + 1;
+  for (m = 0; m < n; m++)
+    {
+      iface->methods[m].name = pool;
+      pool = g_stpcpy (pool, specs[m].name) + 1;
+      iface->methods[m].in_args = args;
+      iface->methods[m].arity = 0;
+      iface->methods[m].flags = specs[m].flags;
+      sig = specs[m].signature;
+      while ((*sig != '\0') && g_variant_type_string_scan (sig, NULL, &end))
+        {
+          *args++ = pool;
+          memcpy (pool, sig, end - sig);
+          pool += end - sig;
+          *pool++ = '\0';
+          iface->methods[m].arity++;
+          sig = end;
+        } // for each parameter
+      iface->sorted[m] = m;
+    } // for each method
+
+  // Build the index
+  g_qsort_with_data (iface->sorted, n, sizeof (guint32),
+                     loudbus_method_index_compare, iface->methods);
+
+  return iface;
+} // loudbus_interface_new
+
+/**
+ * Look up a method in an interface.  Returns NULL if there is no
+ * such method.
+ */
+LouDBusMethod *
+loudbus_interface_lookup_method (LouDBusInterface *iface, const gchar *name)
+{
+  int lo = 0;           // Lower bound of the search (inclusive)
+  int hi;               // Upper bound of the search (exclusive)
+  int mid;              // Midpoint
+  int cmp;              // Result of comparison
+
+  hi = iface->nmethods;
+  while (lo < hi)
+    {
+      mid = lo + (hi - lo) / 2;
+      cmp = strcmp (name, iface->methods[iface->sorted[mid]].name);
+      if (cmp == 0)
+        return &iface->methods[iface->sorted[mid]];
+      else if (cmp < 0)
+        hi = mid;
+      else
+        lo = mid + 1;
+    } // while
+
+  return NULL;
+} // loudbus_interface_lookup_method
+
+/**
+ * Add a reference to an interface.
+ */
+LouDBusInterface *
+loudbus_interface_ref (LouDBusInterface *iface)
+{
+  iface->refcount++;
+  return iface;
+} // loudbus_interface_ref
+
+/**
+ * A helper for loudbus_interface_unref: Does this entry in the table
+ * of known interfaces refer to the interface in data?
+ */
+static gboolean
+loudbus_known_interface_is (gpointer key, gpointer value, gpointer data)
+{
+  return value == data;
+} // loudbus_known_interface_is
+
+/**
+ * Drop a reference to an interface, freeing it when no one uses it.
+ */
+void
+loudbus_interface_unref (LouDBusInterface *iface)
+{
+  if (--iface->refcount > 0)
+    return;
+
+  g_hash_table_remove (loudbus_interfaces, iface->digest);
+  g_hash_table_foreach_remove (loudbus_known_interfaces,
+                               loudbus_known_interface_is, iface);
+  loudbus_catalogue_free (iface);
+  g_free (iface);
+} // loudbus_interface_unref
+
+/**
+ * Get the shared compact form of an interface described by a list of
+ * method specs, building it if no proxy has seen an identical
+ * interface.  The caller owns the returned reference.
+ */
+LouDBusInterface *
+loudbus_interface_intern_specs (const gchar *name, 
+                                int n, LouDBusMethodSpec *specs)
+{
+  LouDBusInterface *iface;      // The interface we return
+  GChecksum *checksum;          // Used to compute the digest
+  int m;                        // Counter variable for methods
+
+  // Interfaces are the same if they have the same name and the same
+  // methods with the same signatures and flags.  (Argument names, most
+  // annotations, and the like don't matter for calls, so two pieces of
+  // XML that differ only in those yield the same interface.)
+  checksum = g_checksum_new (G_CHECKSUM_SHA256);
+  g_checksum_update (checksum, (const guchar *) name, -1);
+  for (m = 0; m < n; m++)
+    {
+      g_checksum_update (checksum, (const guchar *) "\n", 1);
+      g_checksum_update (checksum, (const guchar *) specs[m].name, -1);
+      g_checksum_update (checksum, (const guchar *) "(", 1);
+      g_checksum_update (checksum, (const guchar *) specs[m].signature, -1);
+      g_checksum_update (checksum, (const guchar *) ")", 1);
+      if (specs[m].flags != 0)
+        g_checksum_update (checksum, (const guchar *) "!", 1);
+    } // for each method
+
+  iface = g_hash_table_lookup (loudbus_interfaces, 
+                               g_checksum_get_string (checksum));
+  if (iface != NULL)
+    {
+      loudbus_interface_ref (iface);
+    } // if we've seen it before
+  else
+    {
+      iface = loudbus_interface_new (name, g_checksum_get_string (checksum),
+                                     n, specs);
+      g_hash_table_insert (loudbus_interfaces, iface->digest, iface);
+    } // if it's new
+
+  g_checksum_free (checksum);
+  return iface;
+} // loudbus_interface_intern_specs
+
+/**
+ * Find the value of an attribute of an XML element.  Returns NULL if
+ * the element has no such attribute.
+ */
+static const gchar *
+xml_attribute (const gchar **names, const gchar **values, const gchar *name)
+{
+  int i;                // Counter variable
+
+  for (i = 0; names[i] != NULL; i++)
+    {
+      if (strcmp (names[i], name) == 0)
+        return values[i];
+    } // for each attribute
+
+  return NULL;
+} // xml_attribute
+
+/**
+ * Handle the start of an element while scanning introspection XML.
+ */
+static void
+loudbus_xml_scan_start (GMarkupParseContext *context,
+                        const gchar *element,
+                        const gchar **names,
+                        const gchar **values,
+                        gpointer data,
+                        GError **errorp)
+{
+  LouDBusXMLScan *scan = data;  // The state of the scan
+  const gchar *attr;            // One attribute
+
+  scan->depth++;
+
+  // Skip the insides of anything we don't care about.
+  if (scan->skip != 0)
+    return;
+
+  // Outside the interface, we only care about the outermost node and
+  // the interface itself, which may be the outermost element or a
+  // child of the outermost node.  (In particular, we skip child nodes.)
+  if (scan->inside == 0)
+    {
+      if ((scan->depth == 1) && (strcmp (element, "node") == 0))
+        return;
+      attr = xml_attribute (names, values, "name");
+      if ((scan->depth <= 2) && (strcmp (element, "interface") == 0)
+          && (attr != NULL)
+          && ((scan->interface == NULL) 
+              || (strcmp (attr, scan->interface) == 0)))
+        {
+          scan->inside = scan->depth;
+          if (scan->interface == NULL)
+            scan->current = g_string_chunk_insert (scan->strings, attr);
+          return;
+        } // if it's an interface we want
+      scan->skip = scan->depth;
+      return;
+    } // if we're not in the interface
+
+  // Within the interface, we care about methods ...
+  if ((scan->depth == scan->inside + 1) && (strcmp (element, "method") == 0))
+    {
+      attr = xml_attribute (names, values, "name");
+      if (attr == NULL)
+        {
+          g_set_error (errorp, G_MARKUP_ERROR, 
+                       G_MARKUP_ERROR_MISSING_ATTRIBUTE,
+                       "method without a name");
+          return;
+        } // if the method has no name
+      if (scan->current == NULL)
+        scan->method = g_string_chunk_insert (scan->strings, attr);
+      else
+        {
+          // Name the method in full, as GDBus expects.
+          g_string_printf (scan->signature, "%s.%s", scan->current, attr);
+          scan->method = g_string_chunk_insert (scan->strings, 
+                                                scan->signature->str);
+        } // if we're reading all of the interfaces
+      g_string_truncate (scan->signature, 0);
+      scan->flags = 0;
+      return;
+    } // if it's a method
+
+  // ... their input arguments, ...
+  if ((scan->method != NULL) && (scan->depth == scan->inside + 2) 
+      && (strcmp (element, "arg") == 0))
+    {
+      attr = xml_attribute (names, values, "direction");
+      if ((attr == NULL) || (strcmp (attr, "in") == 0))
+        {
+          attr = xml_attribute (names, values, "type");
+          if ((attr == NULL) || (! g_variant_is_signature (attr)))
+            {
+              g_set_error (errorp, G_MARKUP_ERROR, 
+                           G_MARKUP_ERROR_INVALID_CONTENT,
+                           "invalid type for an argument of %s", 
+                           scan->method);
+              return;
+            } // if the type is missing or invalid
+          g_string_append (scan->signature, attr);
+        } // if it's an input
+    } // if it's an argument
+
+  // ... and the annotations that ask for compression and rings.
+  if ((scan->method != NULL) && (scan->depth == scan->inside + 2) 
+      && (strcmp (element, "annotation") == 0))
+    {
+      attr = xml_attribute (names, values, "name");
+      if ((g_strcmp0 (attr, LOUDBUS_COMPRESS_ANNOTATION) == 0)
+          && (g_strcmp0 (xml_attribute (names, values, "value"),
+                         LOUDBUS_COMPRESS_CODEC) == 0))
+        scan->flags |= LOUDBUS_METHOD_COMPRESS;
+      else if ((g_strcmp0 (attr, LOUDBUS_RING_ANNOTATION) == 0)
+               && (g_strcmp0 (xml_attribute (names, values, "value"),
+                              LOUDBUS_RING_TRANSPORT) == 0))
+        scan->flags |= LOUDBUS_METHOD_RING;
+    } // if it's an annotation on the method
+
+  // Everything else (other annotations, signals, properties, ...), and
+  // the insides of what we've just read, gets skipped.
+  scan->skip = scan->depth;
+} // loudbus_xml_scan_start
+
+/**
+ * Handle the end of an element while scanning introspection XML.
+ */
+static void
+loudbus_xml_scan_end (GMarkupParseContext *context,
+                      const gchar *element,
+                      gpointer data,
+                      GError **errorp)
+{
+  LouDBusXMLScan *scan = data;  // The state of the scan
+  LouDBusMethodSpec spec;       // The method we just finished
+
+  if (scan->skip == scan->depth)
+    {
+      scan->skip = 0;
+    } // if we're done skipping
+  else if ((scan->skip == 0) && (scan->method != NULL)
+           && (scan->depth == scan->inside + 1))
+    {
+      spec.name = scan->method;
+      spec.signature = g_string_chunk_insert (scan->strings, 
+                                              scan->signature->str);
+      spec.flags = scan->flags;
+      g_array_append_val (scan->specs, spec);
+      scan->method = NULL;
+    } // if we're done with a method
+  else if ((scan->skip == 0) && (scan->inside != 0)
+           && (scan->depth == scan->inside))
+    {
+      // That's the whole interface.  Unless we want all of them,
+      // there's no need to read the rest of the document.
+      scan->found = TRUE;
+      if (scan->interface != NULL)
+        g_set_error (errorp, LOUDBUS_XML_SCAN_DONE, 0, "done");
+      scan->inside = 0;
+      scan->current = NULL;
+    } // if we're done with the interface
+
+  scan->depth--;
+} // loudbus_xml_scan_end
+
+/**
+ * The callbacks for scanning introspection XML.
+ */
+static const GMarkupParser loudbus_xml_scan_parser =
+  {
+    loudbus_xml_scan_start,
+    loudbus_xml_scan_end,
+    NULL,
+    NULL,
+    NULL
+  };
+
+/**
+ * Get the shared compact form of an interface described in XML.  The
+ * XML may be a full introspection document or just the <interface>
+ * element.  Rather than building a GDBusNodeInfo for the whole
+ * document, we scan it, skipping other interfaces and child nodes,
+ * and stop as soon as we've read the interface.  Returns NULL and
+ * sets errorp if the XML is invalid or does not describe the
+ * interface.
+ *
+ * If interface is NULL, we instead read every interface of the node
+ * into one table, naming each method interface.method, for node
+ * proxies.
+ */
+LouDBusInterface *
+loudbus_interface_from_xml (const gchar *xml, const gchar *interface,
+                            GError **errorp)
+{
+  LouDBusInterface *iface = NULL;
+                                // The interface we return
+  LouDBusXMLScan scan;          // The state of the scan
+  GMarkupParseContext *context; // The parser
+  GError *error = NULL;         // An error from parsing
+
+  memset (&scan, 0, sizeof (scan));
+  scan.interface = interface;
+  scan.strings = g_string_chunk_new (1024);
+  scan.specs = g_array_new (FALSE, FALSE, sizeof (LouDBusMethodSpec));
+  scan.signature = g_string_new (NULL);
+
+  context = g_markup_parse_context_new (&loudbus_xml_scan_parser, 0, 
+                                        &scan, NULL);
+  if (g_markup_parse_context_parse (context, xml, -1, &error))
+    g_markup_parse_context_end_parse (context, &error);
+  g_markup_parse_context_free (context);
+
+  // Finding the interface stops the parse with a special error.
+  if ((error != NULL) && (error->domain == LOUDBUS_XML_SCAN_DONE))
+    g_clear_error (&error);
+
+  if (error != NULL)
+    g_propagate_error (errorp, error);
+  else if (! scan.found)
+    g_set_error (errorp, G_DBUS_ERROR, G_DBUS_ERROR_UNKNOWN_INTERFACE,
+                 "no interface %s in the XML", 
+                 (interface == NULL) ? "at all" : interface);
+  else
+    iface = loudbus_interface_intern_specs ((interface == NULL) 
+                                              ? LOUDBUS_NODE_INTERFACE
+                                              : interface,
+                                            scan.specs->len,
+                                            (LouDBusMethodSpec *) 
+                                              scan.specs->data);
+
+  g_string_free (scan.signature, TRUE);
+  g_array_free (scan.specs, TRUE);
+  g_string_chunk_free (scan.strings);
+  return iface;
+} // loudbus_interface_from_xml
+
+
+// +----------------+-------------------------------------------------
+// | Missing Things |
+// +----------------+
+
+/**
+ * Free an entry in loudbus_missing.
+ */
+static void
+loudbus_missing_free (LouDBusMissing *missing)
+{
+  g_error_free (missing->error);
+  g_free (missing);
+} // loudbus_missing_free
+
+/**
+ * Decide which key an error belongs under: that of the whole service
+ * ('s'), of the object or interface ('o'), or of the method ('m').
+ * Returns 0 for errors that don't mean something is missing.  While
+ * we're looking for a service (but not during ordinary calls),
+ * timeouts count as its being missing, since it's the repeated
+ * timeouts that we most want to avoid.  They go under a key of their
+ * own ('t'), which only the search for a service looks at, so that
+ * one slow start doesn't fail calls through proxies that work.
+ */
+static int
+loudbus_missing_scope (GError *error, gboolean finding)
+{
+  if (error->domain == G_IO_ERROR)
+    return (finding && (error->code == G_IO_ERROR_TIMED_OUT)) ? 't' : 0;
+  if (error->domain != G_DBUS_ERROR)
+    return 0;
+  switch (error->code)
+    {
+      case G_DBUS_ERROR_SERVICE_UNKNOWN:
+      case G_DBUS_ERROR_NAME_HAS_NO_OWNER:
+      case G_DBUS_ERROR_SPAWN_SERVICE_NOT_FOUND:
+      case G_DBUS_ERROR_SPAWN_EXEC_FAILED:
+      case G_DBUS_ERROR_SPAWN_CHILD_EXITED:
+      case G_DBUS_ERROR_SPAWN_FAILED:
+        return 's';
+      case G_DBUS_ERROR_NO_REPLY:
+      case G_DBUS_ERROR_TIMEOUT:
+      case G_DBUS_ERROR_TIMED_OUT:
+        return finding ? 't' : 0;
+      case G_DBUS_ERROR_UNKNOWN_OBJECT:
+      case G_DBUS_ERROR_UNKNOWN_INTERFACE:
+        return 'o';
+      case G_DBUS_ERROR_UNKNOWN_METHOD:
+        return 'm';
+      default:
+        return 0;
+    } // switch
+} // loudbus_missing_scope
+
+/**
+ * Build the key for something that may be missing.  Stops at the
+ * first NULL part, so loudbus_missing_key (service, NULL, NULL, NULL)
+ * gives the key for the whole service.  (Timeouts go under
+ * loudbus_missing_key (service, LOUDBUS_MISSING_TIMEOUT, NULL, NULL),
+ * which can't clash with an object, since object paths start with
+ * a slash.)
+ */
+static gchar *
+loudbus_missing_key (const gchar *service, const gchar *object,
+                     const gchar *interface, const gchar *method)
+{
+  if (object == NULL)
+    return g_strconcat (service, "\n", NULL);
+  if (method == NULL)
+    return g_strconcat (service, "\n", object, "\n", interface, NULL);
+  return g_strconcat (service, "\n", object, "\n", interface, "\n", 
+                      method, NULL);
+} // loudbus_missing_key
+
+/**
+ * Helper for loudbus_missing_forget: Does key belong to the service
+ * in data (or is data NULL)?
+ */
+static gboolean
+loudbus_missing_key_is_for (gpointer key, gpointer value, gpointer data)
+{
+  return (data == NULL) || g_str_has_prefix (key, data);
+} // loudbus_missing_key_is_for
+
+/**
+ * Handle NameOwnerChanged.  When a service gets an owner, anything
+ * we remember about it being missing is probably wrong.  Runs on the
+ * scheduler's worker.
+ */
+static void
+loudbus_missing_owner_changed (GDBusConnection *connection,
+                               const gchar *sender,
+                               const gchar *object,
+                               const gchar *interface,
+                               const gchar *signal,
+                               GVariant *parameters,
+                               gpointer data)
+{
+  const gchar *name;            // The name whose owner changed
+  const gchar *new_owner;       // Its new owner, if any
+
+  loudbus_trace_instant ("worker", "signal", signal, loudbus_trace_now ());
+  g_variant_get (parameters, "(&s&s&s)", &name, NULL, &new_owner);
+  if (*new_owner != '\0')
+    loudbus_missing_forget (name);
+} // loudbus_missing_owner_changed
+
+/**
+ * Subscribe to NameOwnerChanged.  We subscribe from the worker, so
+ * that the signals get handled there, rather than waiting for someone
+ * to run the default main context.  We stay subscribed for good.
+ */
+static gboolean
+loudbus_missing_subscribe (gpointer data)
+{
+  GDBusConnection *connection;  // The connection to the bus
+
+  connection = g_bus_get_sync (G_BUS_TYPE_SESSION, NULL, NULL);
+  if (connection == NULL)
+    {
+      g_atomic_int_set (&loudbus_missing_watching, FALSE);
+      return G_SOURCE_REMOVE;
+    } // if we can't reach the bus
+  g_dbus_connection_signal_subscribe (connection,
+                                        "org.freedesktop.DBus",
+                                        "org.freedesktop.DBus",
+                                        "NameOwnerChanged",
+                                        "/org/freedesktop/DBus",
+                                        NULL,
+                                        G_DBUS_SIGNAL_FLAGS_NONE,
+                                        loudbus_missing_owner_changed,
+                                        NULL, NULL);
+  g_object_unref (connection);
+  return G_SOURCE_REMOVE;
+} // loudbus_missing_subscribe
+
+/**
+ * Determine whether we recently found something to be missing.  If
+ * so, returns TRUE and sets errorp to (a copy of) the error we got
+ * then.
+ */
+static gboolean
+loudbus_missing_check (const gchar *key, GError **errorp)
+{
+  LouDBusMissing *missing;      // What we know
+  gboolean found = FALSE;       // Did we find anything?
+
+  if (g_atomic_int_get (&loudbus_missing_count) == 0)
+    return FALSE;
+
+  g_mutex_lock (&loudbus_missing_lock);
+  missing = g_hash_table_lookup (loudbus_missing, key);
+  if ((missing != NULL) && (missing->expires <= g_get_monotonic_time ()))
+    {
+      g_hash_table_remove (loudbus_missing, key);
+      g_atomic_int_add (&loudbus_missing_count, -1);
+    } // if we've remembered long enough
+  else if (missing != NULL)
+    {
+      g_propagate_error (errorp, g_error_copy (missing->error));
+      found = TRUE;
+    } // if it's still missing
+  g_mutex_unlock (&loudbus_missing_lock);
+
+  return found;
+} // loudbus_missing_check
+
+/**
+ * Remember that something is missing.  Takes over key.
+ */
+static void
+loudbus_missing_record (gchar *key, GError *error)
+{
+  LouDBusMissing *missing;      // What we remember
+  gint ttl;                     // For how long
+
+  ttl = g_atomic_int_get (&loudbus_missing_ttl);
+  if (ttl <= 0)
+    {
+      g_free (key);
+      return;
+    } // if we aren't remembering
+
+  // We can only hear that services have come back if we're watching.
+  if (g_atomic_int_compare_and_exchange (&loudbus_missing_watching, 
+                                         FALSE, TRUE))
+    g_main_context_invoke (loudbus_worker_context (), 
+                           loudbus_missing_subscribe, NULL);
+
+  missing = g_new (LouDBusMissing, 1);
+  missing->error = g_error_copy (error);
+  missing->expires = g_get_monotonic_time () + (gint64) ttl * 1000;
+  g_mutex_lock (&loudbus_missing_lock);
+  if (loudbus_missing == NULL)
+    loudbus_missing = 
+      g_hash_table_new_full (g_str_hash, g_str_equal, g_free, 
+                             (GDestroyNotify) loudbus_missing_free);
+  if (! g_hash_table_contains (loudbus_missing, key))
+    g_atomic_int_inc (&loudbus_missing_count);
+  g_hash_table_replace (loudbus_missing, key, missing);
+  g_mutex_unlock (&loudbus_missing_lock);
+} // loudbus_missing_record
+
+/**
+ * Remember that a call failed because something was missing (if it
+ * did).
+ */
+static void
+loudbus_missing_record_failure (const gchar *service, const gchar *object,
+                                const gchar *interface, const gchar *method,
+                                GError *error, gboolean finding)
+{
+  switch (loudbus_missing_scope (error, finding))
+    {
+      case 's':
+        loudbus_missing_record (loudbus_missing_key (service, NULL, 
+                                                     NULL, NULL), 
+                                error);
+        break;
+      case 't':
+        loudbus_missing_record (loudbus_missing_key
+                                  (service, LOUDBUS_MISSING_TIMEOUT,
+                                   NULL, NULL),
+                                error);
+        break;
+      case 'o':
+        loudbus_missing_record (loudbus_missing_key (service, object, 
+                                                     interface, NULL), 
+                                error);
+        break;
+      case 'm':
+        if (method != NULL)
+          loudbus_missing_record (loudbus_missing_key (service, object, 
+                                                       interface, method),
+                                  error);
+        break;
+    } // switch
+} // loudbus_missing_record_failure
+
+/**
+ * Determine whether we recently found a service, object, or interface
+ * (and, if method is not NULL, a method) to be missing, or, if we're
+ * finding the service, found it to time out.  If so, returns TRUE and
+ * sets errorp to (a copy of) the error we got.
+ */
+static gboolean
+loudbus_missing_check_all (const gchar *service, const gchar *object,
+                           const gchar *interface, const gchar *method,
+                           gboolean finding, GError **errorp)
+{
+  gchar *key;           // One key
+  gboolean found;       // Did we find it?
+
+  if (g_atomic_int_get (&loudbus_missing_count) == 0)
+    return FALSE;
+
+  key = loudbus_missing_key (service, NULL, NULL, NULL);
+  found = loudbus_missing_check (key, errorp);
+  g_free (key);
+  if ((! found) && finding)
+    {
+      key = loudbus_missing_key (service, LOUDBUS_MISSING_TIMEOUT,
+                                 NULL, NULL);
+      found = loudbus_missing_check (key, errorp);
+      g_free (key);
+    } // if we're finding the service
+  if ((! found) && (object != NULL))
+    {
+      key = loudbus_missing_key (service, object, interface, NULL);
+      found = loudbus_missing_check (key, errorp);
+      g_free (key);
+    } // if we should check the object
+  if ((! found) && (method != NULL))
+    {
+      key = loudbus_missing_key (service, object, interface, method);
+      found = loudbus_missing_check (key, errorp);
+      g_free (key);
+    } // if we should check the method
+
+  return found;
+} // loudbus_missing_check_all
+
+/**
+ * Before a call: Determine whether we recently found its method (or
+ * object or service) to be missing.  If so, returns TRUE and sets
+ * errorp.
+ */
+gboolean
+loudbus_missing_check_call (GDBusProxy *proxy, const gchar *method,
+                            GError **errorp)
+{
+  gchar *interface;     // The interface of the method
+  const gchar *member;  // The method, without the interface
+  gboolean found;       // Is something missing?
+
+  if (g_atomic_int_get (&loudbus_missing_count) == 0)
+    return FALSE;
+  member = loudbus_method_split (proxy, method, &interface);
+  found = loudbus_missing_check_all (g_dbus_proxy_get_name (proxy),
+                                     g_dbus_proxy_get_object_path (proxy),
+                                     interface, member, FALSE, errorp);
+  g_free (interface);
+  return found;
+} // loudbus_missing_check_call
+
+/**
+ * After a call fails: Remember what was missing, if anything.
+ */
+void
+loudbus_missing_record_call (GDBusProxy *proxy, const gchar *method,
+                             GError *error)
+{
+  gchar *interface;     // The interface of the method
+  const gchar *member;  // The method, without the interface
+
+  member = loudbus_method_split (proxy, method, &interface);
+  loudbus_missing_record_failure (g_dbus_proxy_get_name (proxy),
+                                  g_dbus_proxy_get_object_path (proxy),
+                                  interface, member, error, FALSE);
+  g_free (interface);
+} // loudbus_missing_record_call
+
+/**
+ * Forget what we know about missing parts of a service, or about
+ * everything if service is NULL.
+ */
+void
+loudbus_missing_forget (const gchar *service)
+{
+  gchar *prefix;        // The prefix of the keys for the service
+  guint n;              // How many entries we removed
+
+  if (g_atomic_int_get (&loudbus_missing_count) == 0)
+    return;
+
+  prefix = (service == NULL) ? NULL : g_strconcat (service, "\n", NULL);
+  g_mutex_lock (&loudbus_missing_lock);
+  if (loudbus_missing != NULL)
+    {
+      n = g_hash_table_foreach_remove (loudbus_missing, 
+                                       loudbus_missing_key_is_for, prefix);
+      g_atomic_int_add (&loudbus_missing_count, -(gint) n);
+    } // if we've ever missed anything
+  g_mutex_unlock (&loudbus_missing_lock);
+  g_free (prefix);
+} // loudbus_missing_forget
+
+/**
+ * Set how long (in milliseconds) we remember that something is
+ * missing.  0 turns off remembering (and forgets everything).
+ */
+void
+loudbus_missing_set_ttl (int ttl)
+{
+  g_atomic_int_set (&loudbus_missing_ttl, MAX (0, ttl));
+  if (ttl <= 0)
+    loudbus_missing_forget (NULL);
+} // loudbus_missing_set_ttl
+
+
+// +-----------------+------------------------------------------------
+// | Proxy Functions |
+// +-----------------+
+
+/**
+ * Free one of the allocated proxies.
+ */
+void
+loudbus_proxy_free (LouDBusProxy *proxy)
+{
+  // Sanity check 1.  Make sure that it's not NULL.
+  if (proxy == NULL)
+    return;
+
+  // Sanity check 2.  Make sure that it's really an LouDBusProxy.
+  if (! loudbus_proxy_validate (proxy))
+    return;
+ 
+  // Clear the signature (so that we don't identify this as a
+  // LouDBusProxy in the future).
+  proxy->signature = 0;
+
+  // Give back the ring, while we can still tell the service.
+  loudbus_proxy_ring_close (proxy);
+
+  // Clear the proxy.
+  if (proxy->proxy != NULL)
+    {
+      g_object_unref (proxy->proxy);
+      proxy->proxy = NULL;
+    } // if (proxy->proxy != NULL)
+
+  // Clear the interface information.
+  if (proxy->iface != NULL)
+    {
+      loudbus_interface_unref (proxy->iface);
+      proxy->iface = NULL;
+    } // if (proxy->iface != NULL)
+
+  // And free the enclosing structure
+  g_free (proxy);
+} // loudbus_proxy_free
+
+/**
+ * Allocate a proxy and its underlying GDBus proxy, but don't fill in
+ * the interface information or the signature.
+ */
+static LouDBusProxy *
+loudbus_proxy_alloc (gchar *service, gchar *object, gchar *interface, 
+                     GError **errorp)
+{
+  LouDBusProxy *proxy;          // The proxy we're creating
+
+  // If the service was missing a moment ago, it probably still is.
+  if (loudbus_missing_check_all (service, NULL, NULL, NULL, TRUE, errorp))
+    {
+      LOG ("loudbus_proxy_alloc: %s is still missing.", service);
+      return NULL;
+    } // if we know the service is missing
+
+  // Allocate space for the struct.
+  proxy = g_malloc0 (sizeof (LouDBusProxy));
+  if (proxy == NULL)
+    {
+      LOG ("loudbus_proxy_alloc: Could not allocate proxy.");
+      return NULL;
+    } // if (proxy == NULL)
+
+  proxy->priority = LOUDBUS_PRIORITY_NORMAL;
+
+  LOG ("Creating proxy for (%s,%s,%s)", service, object, interface);
+  proxy->proxy = g_dbus_proxy_new_for_bus_sync (G_BUS_TYPE_SESSION,
+                                                LOUDBUS_PROXY_FLAGS,
+                                                NULL,
+                                                service,
+                                                object,
+                                                interface,
+                                                NULL,
+                                                errorp);
+  if (proxy->proxy == NULL)
+    {
+      LOG ("loudbus_proxy_alloc: Could not build proxy.");
+      if ((errorp != NULL) && (*errorp != NULL))
+        loudbus_missing_record_failure (service, object, interface, NULL,
+                                        *errorp, TRUE);
+      g_free (proxy);
+      return NULL;
+    } // if we failed to create the proxy.
+
+  return proxy;
+} // loudbus_proxy_alloc
+
+LouDBusProxy *
+loudbus_proxy_new (gchar *service, gchar *object, gchar *interface, 
+                   GError **errorp)
+{
+  LouDBusProxy *proxy;          // The proxy we're creating
+  GVariant *response;           // The introspection data
+  const gchar *xml;             // The XML in that data
+  gchar *known;                 // Key for loudbus_known_interfaces
+
+  proxy = loudbus_proxy_alloc (service, object, interface, errorp);
+  if (proxy == NULL)
+    return NULL;
+
+  // If we've already seen this interface on this service, there's
+  // no need to introspect.
+  known = g_strdup_printf ("%s\n%s", service, interface);
+  proxy->iface = g_hash_table_lookup (loudbus_known_interfaces, known);
+  if (proxy->iface != NULL)
+    {
+      LOG ("loudbus_proxy_new: Reusing interface info for %s", interface);
+      g_free (known);
+      loudbus_interface_ref (proxy->iface);
+      proxy->signature = loudbus_proxy_signature ();
+      return proxy;
+    } // if we know the interface
+
+  // Don't keep introspecting an object that isn't there.
+  if (loudbus_missing_check_all (service, object, interface, NULL, TRUE,
+                                 errorp))
+    {
+      LOG ("loudbus_proxy_new: %s on %s is still missing.", object, 
+           service);
+      g_free (known);
+      g_object_unref (proxy->proxy);
+      g_free (proxy);
+      return NULL;
+    } // if we know the object is missing
+
+  // Get the introspection data
+  response = g_dbus_proxy_introspect (proxy->proxy, errorp);
+  if (response == NULL)
+    {
+      LOG ("loudbus_proxy_new: Could not introspect.");
+      if ((errorp != NULL) && (*errorp != NULL))
+        loudbus_missing_record_failure (service, object, interface, NULL,
+                                        *errorp, TRUE);
+      g_free (known);
+      g_object_unref (proxy->proxy);
+      g_free (proxy);
+      return NULL;
+    } // if we failed to introspect
+
+  // Pull out the compact, shared form of the interface.  The rest of
+  // the data can be large, so we don't keep (or even build) it.
+  g_variant_get (response, "(&s)", &xml);
+  proxy->iface = loudbus_interface_from_xml (xml, interface, errorp);
+  g_variant_unref (response);
+  if (proxy->iface == NULL)
+    {
+      LOG ("loudbus_proxy_new: Could not get interface info.");
+      if ((errorp != NULL) && (*errorp != NULL))
+        loudbus_missing_record_failure (service, object, interface, NULL,
+                                        *errorp, TRUE);
+      g_free (known);
+      g_object_unref (proxy->proxy);
+      g_free (proxy);
+      return NULL;
+    } // if we failed to get interface information
+  g_hash_table_replace (loudbus_known_interfaces, known, proxy->iface);
+
+  // Set the signature
+  proxy->signature = loudbus_proxy_signature ();
+
+  // And we seem to be done
+  return proxy;
+} // loudbus_proxy_new
+
+/**
+ * Create a new proxy using interface information that the caller
+ * supplies, rather than introspecting.  Takes over the caller's
+ * reference to iface, even on failure.
+ */
+LouDBusProxy *
+loudbus_proxy_new_with_interface (gchar *service, gchar *object, 
+                                  LouDBusInterface *iface,
+                                  GError **errorp)
+{
+  LouDBusProxy *proxy;          // The proxy we're creating
+
+  proxy = loudbus_proxy_alloc (service, object, iface->name, errorp);
+  if (proxy == NULL)
+    {
+      loudbus_interface_unref (iface);
+      return NULL;
+    } // if (proxy == NULL)
+
+  proxy->iface = iface;
+  proxy->signature = loudbus_proxy_signature ();
+  return proxy;
+} // loudbus_proxy_new_with_interface
+
+/**
+ * Create a new proxy that covers every interface of an object, from
+ * one round of introspection.  Methods go by their full names
+ * (interface.method).
+ */
+LouDBusProxy *
+loudbus_proxy_new_for_node (gchar *service, gchar *object, 
+                            GError **errorp)
+{
+  LouDBusProxy *proxy;          // The proxy we're creating
+  GVariant *response;           // The introspection data
+  const gchar *xml;             // The XML in that data
+  gchar *known;                 // Key for loudbus_known_interfaces
+
+  proxy = loudbus_proxy_alloc (service, object, LOUDBUS_NODE_INTERFACE,
+                               errorp);
+  if (proxy == NULL)
+    return NULL;
+
+  // If we've already seen this object, there's no need to introspect.
+  // (Object paths start with a slash and interface names can't, so the
+  // keys for nodes don't collide with those for interfaces.)
+  known = g_strdup_printf ("%s\n%s", service, object);
+  proxy->iface = g_hash_table_lookup (loudbus_known_interfaces, known);
+  if (proxy->iface != NULL)
+    {
+      g_free (known);
+      loudbus_interface_ref (proxy->iface);
+      proxy->signature = loudbus_proxy_signature ();
+      return proxy;
+    } // if we know the object
+
+  // Don't keep introspecting an object that isn't there.
+  if (loudbus_missing_check_all (service, object, LOUDBUS_NODE_INTERFACE,
+                                 NULL, TRUE, errorp))
+    {
+      g_free (known);
+      g_object_unref (proxy->proxy);
+      g_free (proxy);
+      return NULL;
+    } // if we know the object is missing
+
+  // One round of introspection describes every interface.
+  response = g_dbus_proxy_introspect (proxy->proxy, errorp);
+  if (response != NULL)
+    {
+      g_variant_get (response, "(&s)", &xml);
+      proxy->iface = loudbus_interface_from_xml (xml, NULL, errorp);
+      g_variant_unref (response);
+    } // if we have the introspection data
+  if (proxy->iface == NULL)
+    {
+      LOG ("loudbus_proxy_new_for_node: Could not describe %s.", object);
+      if ((errorp != NULL) && (*errorp != NULL))
+        loudbus_missing_record_failure (service, object, 
+                                        LOUDBUS_NODE_INTERFACE, NULL,
+                                        *errorp, TRUE);
+      g_free (known);
+      g_object_unref (proxy->proxy);
+      g_free (proxy);
+      return NULL;
+    } // if we could not get the interfaces
+  g_hash_table_replace (loudbus_known_interfaces, known, proxy->iface);
+
+  proxy->signature = loudbus_proxy_signature ();
+  return proxy;
+} // loudbus_proxy_new_for_node
+
+/**
+ * Split the name of a method into its interface and the method itself.
+ * Full names (interface.method, as node proxies use) carry their own
+ * interface; other names belong to the interface of the proxy.  Sets
+ * *interface to a string that the caller frees, and returns the
+ * method, which points into name.
+ */
+const gchar *
+loudbus_method_split (GDBusProxy *proxy, const gchar *name, 
+                      gchar **interface)
+{
+  const gchar *dot;     // The last dot in the name
+
+  dot = strrchr (name, '.');
+  if (dot == NULL)
+    {
+      *interface = g_strdup (g_dbus_proxy_get_interface_name (proxy));
+      return name;
+    } // if it's a short name
+  *interface = g_strndup (name, dot - name);
+  return dot + 1;
+} // loudbus_method_split
+
+int
+loudbus_proxy_validate (LouDBusProxy *proxy)
+{
+  // Sanity check.  We don't want segfaults.
+  if (proxy == NULL)
+    return 0;
+
+  // Things are only proxies if they contain the magic signature.
+  return (proxy->signature == loudbus_proxy_signature ());
+} // loudbus_proxy_validate
+
+
+/**
+ * Determine whether the byte arrays of a method travel in compressed
+ * frames.
+ */
+int
+loudbus_proxy_compresses (LouDBusProxy *proxy, const gchar *method)
+{
+  LouDBusMethod *m;     // The method
+
+  m = loudbus_interface_lookup_method (proxy->iface, method);
+  return (m != NULL) && (m->flags & LOUDBUS_METHOD_COMPRESS);
+} // loudbus_proxy_compresses
+
+/**
+ * Get the LOUDBUS_METHOD_* flags of a method, or 0 if there's no such
+ * method.
+ */
+int
+loudbus_proxy_method_flags (LouDBusProxy *proxy, const gchar *method)
+{
+  LouDBusMethod *m;     // The method
+
+  m = loudbus_interface_lookup_method (proxy->iface, method);
+  return (m == NULL) ? 0 : m->flags;
+} // loudbus_proxy_method_flags
+
+/**
+ * Open a shared-memory ring, with lanes of capacity bytes, between a
+ * proxy and its service, replacing any ring the proxy already has.
+ * Methods with the ring annotation then send and receive large byte
+ * arrays through it.  Returns FALSE (setting errorp) if we can't make
+ * the ring, or the service won't attach it.
+ */
+gboolean
+loudbus_proxy_ring_open (LouDBusProxy *proxy, gsize capacity,
+                         GError **errorp)
+{
+  LouDBusRing *ring;            // The new ring
+  GUnixFDList *fds;             // Carries its descriptor to the service
+  GVariant *result;             // The reply to Attach
+  guint32 id;                   // The service's number for the ring
+  int fd;                       // The descriptor
+
+  ring = loudbus_ring_new (capacity, errorp);
+  if (ring == NULL)
+    return FALSE;
+  fd = loudbus_ring_steal_fd (ring);
+  fds = g_unix_fd_list_new_from_array (&fd, 1);
+  result = 
+    g_dbus_connection_call_with_unix_fd_list_sync
+      (g_dbus_proxy_get_connection (proxy->proxy),
+       g_dbus_proxy_get_name (proxy->proxy),
+       g_dbus_proxy_get_object_path (proxy->proxy),
+       LOUDBUS_RING_INTERFACE,
+       "Attach",
+       g_variant_new ("(h)", 0),
+       G_VARIANT_TYPE ("(u)"),
+       G_DBUS_CALL_FLAGS_NONE,
+       -1,
+       fds,
+       NULL,
+       NULL,
+       errorp);
+  g_object_unref (fds);
+  if (result == NULL)
+    {
+      loudbus_ring_unref (ring);
+      return FALSE;
+    } // if the service would not attach the ring
+  g_variant_get (result, "(u)", &id);
+  g_variant_unref (result);
+  loudbus_ring_set_id (ring, id);
+
+  loudbus_proxy_ring_close (proxy);
+  proxy->ring = ring;
+  return TRUE;
+} // loudbus_proxy_ring_open
+
+/**
+ * Give back the proxy's shared-memory ring, if it has one.  Calls
+ * already on their way keep the ring until they finish.
+ */
+void
+loudbus_proxy_ring_close (LouDBusProxy *proxy)
+{
+  if (proxy->ring == NULL)
+    return;
+  // We don't wait for the reply, since the service frees the ring
+  // when we go away, anyway.
+  if (proxy->proxy != NULL)
+    g_dbus_connection_call (g_dbus_proxy_get_connection (proxy->proxy),
+                            g_dbus_proxy_get_name (proxy->proxy),
+                            g_dbus_proxy_get_object_path (proxy->proxy),
+                            LOUDBUS_RING_INTERFACE,
+                            "Detach",
+                            g_variant_new ("(u)",
+                                           loudbus_ring_id (proxy->ring)),
+                            NULL,
+                            G_DBUS_CALL_FLAGS_NO_AUTO_START,
+                            -1,
+                            NULL,
+                            NULL,
+                            NULL);
+  loudbus_ring_unref (proxy->ring);
+  proxy->ring = NULL;
+} // loudbus_proxy_ring_close
+
+/**
+ * Call a method through a proxy.  Takes over actuals if it is floating.
+ * Returns the results as a tuple, or NULL (setting errorp) if the call
+ * fails.
+ */
+GVariant *
+loudbus_proxy_call_sync (LouDBusProxy *proxy, const gchar *method,
+                         GVariant *actuals, GError **errorp)
+{
+  GVariant *framed;     // The parameters or results, framed
+  GVariant *result;     // The results
+  GError *error = NULL; // Why the call failed
+  gint64 start;         // When the call went out, if we're timing
+  LouDBusRing *ring;    // The ring that byte arrays go through (or NULL)
+  gsize threshold;      // The size of byte arrays we compress
+  int flags;            // The LOUDBUS_METHOD_* flags of the method
+
+  // Don't bother the bus about things we know are missing.
+  if (loudbus_missing_check_call (proxy->proxy, method, errorp))
+    {
+      if (actuals != NULL)
+        g_variant_unref (g_variant_ref_sink (actuals));
+      return NULL;
+    } // if we know something is missing
+
+  // Frame the byte arrays in the parameters, if the method wants that.
+  // Large ones go through the ring, if there is one.
+  flags = loudbus_proxy_method_flags (proxy, method);
+  ring = (flags & LOUDBUS_METHOD_RING) ? proxy->ring : NULL;
+  threshold = (flags & LOUDBUS_METHOD_COMPRESS)
+              ? LOUDBUS_FRAME_THRESHOLD : G_MAXSIZE;
+  if (actuals != NULL)
+    {
+      g_variant_ref_sink (actuals);
+      if (flags & LOUDBUS_METHOD_FRAMED)
+        {
+          framed = loudbus_ring_tuple (ring, actuals, TRUE, threshold, NULL);
+          g_variant_unref (actuals);
+          actuals = framed;
+        } // if the method uses frames
+    } // if (actuals != NULL)
+
+  // Don't send more than the connection allows.
+  if (! loudbus_connection_check_size 
+          (g_dbus_proxy_get_connection (proxy->proxy), actuals, errorp))
+    {
+      if (flags & LOUDBUS_METHOD_FRAMED)
+        loudbus_ring_tuple_release (ring, actuals);
+      g_variant_unref (actuals);
+      return NULL;
+    } // if the call is too big
+
+  start = loudbus_timing_start ();
+  result = g_dbus_proxy_call_sync (proxy->proxy,
+                                   method,
+                                   actuals,
+                                   G_DBUS_CALL_FLAGS_NONE,
+                                   -1,
+                                   NULL,
+                                   &error);
+  loudbus_timing_stop (LOUDBUS_PHASE_WIRE, start);
+  if (actuals != NULL)
+    g_variant_unref (actuals);
+  if (result == NULL)
+    {
+      loudbus_missing_record_call (proxy->proxy, method, error);
+      g_propagate_error (errorp, error);
+      return NULL;
+    } // if the call failed
+  result = loudbus_spill_check_reply (result, ring, errorp);
+  if (result == NULL)
+    return NULL;
+
+  // Decode the framed results.
+  if ((result != NULL) && (flags & LOUDBUS_METHOD_FRAMED))
+    {
+      framed = result;
+      result = loudbus_ring_tuple (ring, framed, FALSE, 0, errorp);
+      g_variant_unref (framed);
+    } // if the method uses frames
+
+  return result;
+} // loudbus_proxy_call_sync
+
+
+// +---------------------+--------------------------------------------
+// | Connection Settings |
+// +---------------------+
+
+/**
+ * Get the socket behind a connection, or NULL if it doesn't use one.
+ * The socket belongs to the connection.
+ */
+static GSocket *
+g_dbus_connection_get_socket (GDBusConnection *connection)
+{
+  GIOStream *stream;    // The stream behind the connection
+
+  stream = g_dbus_connection_get_stream (connection);
+  if (! G_IS_SOCKET_CONNECTION (stream))
+    return NULL;
+  return g_socket_connection_get_socket (G_SOCKET_CONNECTION (stream));
+} // g_dbus_connection_get_socket
+
+/**
+ * Change the settings of a connection.  sndbuf and rcvbuf are the
+ * sizes of the socket's buffers, in bytes.  max_message is the size
+ * of the largest call we send on the connection, or 0 for no limit.
+ * Negative values leave a setting as it is.  Returns FALSE (setting
+ * errorp) if the socket won't take the settings.
+ */
+gboolean
+loudbus_connection_configure (GDBusConnection *connection,
+                              int sndbuf, int rcvbuf, gssize max_message,
+                              GError **errorp)
+{
+  GSocket *socket;      // The socket behind the connection
+
+  if ((sndbuf >= 0) || (rcvbuf >= 0))
+    {
+      socket = g_dbus_connection_get_socket (connection);
+      if (socket == NULL)
+        {
+          g_set_error (errorp, G_IO_ERROR, G_IO_ERROR_NOT_SUPPORTED,
+                       "connection does not use a socket");
+          return FALSE;
+        } // if there's no socket
+      if ((sndbuf >= 0)
+          && (! g_socket_set_option (socket, SOL_SOCKET, SO_SNDBUF, sndbuf,
+                                     errorp)))
+        return FALSE;
+      if ((rcvbuf >= 0)
+          && (! g_socket_set_option (socket, SOL_SOCKET, SO_RCVBUF, rcvbuf,
+                                     errorp)))
+        return FALSE;
+    } // if we're changing the buffers
+
+  if (max_message >= 0)
+    g_object_set_data (G_OBJECT (connection), LOUDBUS_MAX_MESSAGE_KEY,
+                       GSIZE_TO_POINTER (max_message));
+
+  return TRUE;
+} // loudbus_connection_configure
+
+/**
+ * Get the settings of a connection.  The buffer sizes are what the
+ * kernel actually uses (Linux, for example, doubles what we ask for),
+ * or -1 if the connection doesn't use a socket.
+ */
+void
+loudbus_connection_settings (GDBusConnection *connection,
+                             int *sndbuf, int *rcvbuf, gsize *max_message)
+{
+  GSocket *socket;      // The socket behind the connection
+
+  *sndbuf = -1;
+  *rcvbuf = -1;
+  socket = g_dbus_connection_get_socket (connection);
+  if ((socket == NULL)
+      || (! g_socket_get_option (socket, SOL_SOCKET, SO_SNDBUF, sndbuf,
+                                 NULL)))
+    *sndbuf = -1;
+  if ((socket == NULL)
+      || (! g_socket_get_option (socket, SOL_SOCKET, SO_RCVBUF, rcvbuf,
+                                 NULL)))
+    *rcvbuf = -1;
+  *max_message = GPOINTER_TO_SIZE (g_object_get_data (G_OBJECT (connection),
+                                                      LOUDBUS_MAX_MESSAGE_KEY));
+} // loudbus_connection_settings
+
+/**
+ * Check that the parameters of a call are no bigger than the
+ * connection allows.  Returns FALSE (setting errorp) if they are.
+ */
+gboolean
+loudbus_connection_check_size (GDBusConnection *connection,
+                               GVariant *actuals, GError **errorp)
+{
+  gsize max_message;    // The limit
+  gsize size;           // The size of the parameters
+
+  max_message = GPOINTER_TO_SIZE (g_object_get_data (G_OBJECT (connection),
+                                                     LOUDBUS_MAX_MESSAGE_KEY));
+  if ((max_message == 0) || (actuals == NULL))
+    return TRUE;
+  size = g_variant_get_size (actuals);
+  if (size <= max_message)
+    return TRUE;
+  g_set_error (errorp, G_IO_ERROR, G_IO_ERROR_MESSAGE_TOO_LARGE,
+               "call is %" G_GSIZE_FORMAT " bytes, but the connection "
+               "allows at most %" G_GSIZE_FORMAT, size, max_message);
+  return FALSE;
+} // loudbus_connection_check_size
+
+
+// +-------------+----------------------------------------------------
+// | Call Timing |
+// +-------------+
+
+/**
+ * Start or stop timing calls.  Either way, we forget the old times.
+ */
+void
+loudbus_timing_enable (gboolean on)
+{
+  g_mutex_lock (&loudbus_timing_lock);
+  memset (&loudbus_timing_totals, 0, sizeof (loudbus_timing_totals));
+  g_mutex_unlock (&loudbus_timing_lock);
+  g_atomic_int_set (&loudbus_timing_on, on);
+} // loudbus_timing_enable
+
+/**
+ * Get this thread's sample, or NULL if it isn't sampling a call.
+ */
+static LouDBusTimingSample *
+loudbus_timing_sampling (void)
+{
+  LouDBusTimingSample *sample;  // The sample
+
+  if (g_atomic_int_get (&loudbus_timing_samplers) == 0)
+    return NULL;
+  sample = g_private_get (&loudbus_timing_sample);
+  return ((sample != NULL) && sample->on) ? sample : NULL;
+} // loudbus_timing_sampling
+
+/**
+ * Add the time spent in one phase to a set of times.
+ */
+static void
+loudbus_timing_add (LouDBusCallTimes *times, LouDBusPhase phase,
+                    gint64 elapsed)
+{
+  switch (phase)
+    {
+      case LOUDBUS_PHASE_ENCODE:
+        times->encode_ns += elapsed;
+        break;
+      case LOUDBUS_PHASE_WIRE:
+        times->wire_ns += elapsed;
+        times->calls++;
+        break;
+      case LOUDBUS_PHASE_DECODE:
+        times->decode_ns += elapsed;
+        break;
+      default:
+        break;
+    } // switch
+} // loudbus_timing_add
+
+/**
+ * Note the start of a phase of a call.  Returns the time in
+ * nanoseconds, or 0 if we aren't timing calls.  (The clock is finer
+ * than g_get_monotonic_time, which matters for calls that take tens
+ * of microseconds.)
+ */
+gint64
+loudbus_timing_start (void)
+{
+  struct timespec now;  // The time
+
+  if ((! g_atomic_int_get (&loudbus_timing_on))
+      && (loudbus_timing_sampling () == NULL))
+    return 0;
+  clock_gettime (CLOCK_MONOTONIC, &now);
+  return (gint64) now.tv_sec * G_GINT64_CONSTANT (1000000000) + now.tv_nsec;
+} // loudbus_timing_start
+
+/**
+ * Note the end of a phase that started at start.  The wire phase
+ * happens once per call, so it also counts the calls.
+ */
+void
+loudbus_timing_stop (LouDBusPhase phase, gint64 start)
+{
+  LouDBusTimingSample *sample;  // The call this thread is sampling
+  gint64 elapsed;               // How long the phase took
+
+  if (start == 0)
+    return;
+  elapsed = loudbus_timing_start () - start;
+  if (elapsed < 0)
+    return;
+
+  sample = loudbus_timing_sampling ();
+  if (sample != NULL)
+    {
+      loudbus_timing_add (&sample->times, phase, elapsed);
+      if (sample->starts[phase] == 0)
+        sample->starts[phase] = start;
+    } // if this thread is sampling a call
+  if (g_atomic_int_get (&loudbus_timing_on))
+    {
+      g_mutex_lock (&loudbus_timing_lock);
+      loudbus_timing_add (&loudbus_timing_totals, phase, elapsed);
+      g_mutex_unlock (&loudbus_timing_lock);
+    } // if we're timing all calls
+} // loudbus_timing_stop
+
+/**
+ * Time the phases of the next call this thread makes, whether or not
+ * we're timing all calls, so that a profiler can tell where the time
+ * in that call went (see loudbus_timing_sample_end).
+ */
+void
+loudbus_timing_sample_begin (void)
+{
+  LouDBusTimingSample *sample;  // This thread's sample
+
+  sample = g_private_get (&loudbus_timing_sample);
+  if (sample == NULL)
+    {
+      sample = g_new0 (LouDBusTimingSample, 1);
+      g_private_set (&loudbus_timing_sample, sample);
+    } // if the thread has never sampled a call
+  memset (&sample->times, 0, sizeof (sample->times));
+  memset (sample->starts, 0, sizeof (sample->starts));
+  if (! sample->on)
+    {
+      sample->on = TRUE;
+      g_atomic_int_inc (&loudbus_timing_samplers);
+    } // if we weren't sampling (say, an earlier call escaped)
+} // loudbus_timing_sample_begin
+
+/**
+ * Stop sampling, and get where the time in the sampled call went and
+ * when (on the clock of loudbus_trace_now) each phase started, or 0
+ * for phases that never started.
+ */
+void
+loudbus_timing_sample_end (LouDBusCallTimes *times,
+                           gint64 starts[LOUDBUS_PHASES])
+{
+  LouDBusTimingSample *sample;  // This thread's sample
+
+  sample = g_private_get (&loudbus_timing_sample);
+  if ((sample == NULL) || (! sample->on))
+    {
+      memset (times, 0, sizeof (*times));
+      memset (starts, 0, LOUDBUS_PHASES * sizeof (gint64));
+      return;
+    } // if we aren't sampling
+  *times = sample->times;
+  memcpy (starts, sample->starts, sizeof (sample->starts));
+  sample->on = FALSE;
+  g_atomic_int_add (&loudbus_timing_samplers, -1);
+} // loudbus_timing_sample_end
+
+/**
+ * Get where the time in calls has gone since timing started.
+ */
+void
+loudbus_timing_get (LouDBusCallTimes *times)
+{
+  g_mutex_lock (&loudbus_timing_lock);
+  *times = loudbus_timing_totals;
+  g_mutex_unlock (&loudbus_timing_lock);
+} // loudbus_timing_get
+
+
+// +--------+---------------------------------------------------------
+// | Errors |
+// +--------+
+
+/**
+ * Get the D-Bus name of an error (e.g., 
+ * "org.freedesktop.DBus.Error.UnknownMethod").  Errors that did not
+ * come from the other end get the name GDBus would send for them.
+ * Names are interned, so the caller does not free them and can compare
+ * them by address.
+ */
+const gchar *
+loudbus_error_name (GError *error)
+{
+  gchar *name;                  // The name, as GDBus gives it to us
+  const gchar *interned;        // The interned name
+
+  if (g_dbus_error_is_remote_error (error))
+    name = g_dbus_error_get_remote_error (error);
+  else
+    name = g_dbus_error_encode_gerror (error);
+  interned = g_intern_string (name);
+  g_free (name);
+
+  return interned;
+} // loudbus_error_name
+
+
+// +-------------------+----------------------------------------------
+// | Foreign Interface |
+// +-------------------+
+
+/**
+ * Record an error message for a foreign caller, freeing the GError.
+ * (The GError may be NULL, in which case we don't know why.)
+ */
+static void
+loudbus_ffi_set_error (gchar **errmsg, const gchar *what, GError *error)
+{
+  if (errmsg == NULL)
+    {
+      g_clear_error (&error);
+      return;
+    } // if (errmsg == NULL)
+
+  if (error == NULL)
+    *errmsg = g_strdup_printf ("%s for an unknown reason", what);
+  else
+    {
+      *errmsg = g_strdup_printf ("%s because %s", what, error->message);
+      g_error_free (error);
+    } // if (error != NULL)
+} // loudbus_ffi_set_error
+
+/**
+ * Free memory that the core handed to a foreign caller.
+ */
+void
+loudbus_ffi_free (gpointer ptr)
+{
+  g_free (ptr);
+} // loudbus_ffi_free
+
+/**
+ * Create a new proxy.  If xml is NULL, we get the interface
+ * information by introspecting; otherwise, we read it from the xml.
+ * If interface is NULL too, the proxy covers every interface of the
+ * object (see loudbus_proxy_new_for_node).
+ */
+LouDBusProxy *
+loudbus_ffi_proxy_new (const gchar *service, const gchar *object,
+                       const gchar *interface, const gchar *xml,
+                       gchar **errmsg)
+{
+  LouDBusInterface *iface;      // Interface information from the XML
+  LouDBusProxy *proxy;          // The proxy we build
+  GError *error = NULL;         // A place to hold errors
+
+  loudbus_core_init ();
+
+  if ((xml == NULL) && (interface == NULL))
+    {
+      proxy = loudbus_proxy_new_for_node ((gchar *) service, 
+                                          (gchar *) object, &error);
+      if (proxy == NULL)
+        loudbus_ffi_set_error (errmsg, "Could not create proxy", error);
+      return proxy;
+    } // if it's a proxy for the whole node
+
+  if (xml == NULL)
+    {
+      proxy = loudbus_proxy_new ((gchar *) service, (gchar *) object,
+                                 (gchar *) interface, &error);
+      if (proxy == NULL)
+        loudbus_ffi_set_error (errmsg, "Could not create proxy", error);
+      return proxy;
+    } // if (xml == NULL)
+
+  iface = loudbus_interface_from_xml (xml, interface, &error);
+  if (iface == NULL)
+    {
+      loudbus_ffi_set_error (errmsg, "Could not read the XML", error);
+      return NULL;
+    } // if (iface == NULL)
+
+  proxy = loudbus_proxy_new_with_interface ((gchar *) service,
+                                            (gchar *) object,
+                                            iface, &error);
+  if (proxy == NULL)
+    loudbus_ffi_set_error (errmsg, "Could not create proxy", error);
+  return proxy;
+} // loudbus_ffi_proxy_new
+
+/**
+ * Create a new proxy from a table of method names and signatures.
+ */
+LouDBusProxy *
+loudbus_ffi_proxy_new_with_specs (const gchar *service, const gchar *object,
+                                  const gchar *interface,
+                                  int n, gchar **names, gchar **signatures,
+                                  gchar **errmsg)
+{
+  LouDBusMethodSpec *specs;     // The table, as the core wants it
+  LouDBusInterface *iface;      // The interface information
+  LouDBusProxy *proxy;          // The proxy we build
+  GError *error = NULL;         // A place to hold errors
+  int m;                        // Counter variable for methods
+
+  loudbus_core_init ();
+
+  specs = g_new (LouDBusMethodSpec, n);
+  for (m = 0; m < n; m++)
+    {
+      if (! g_variant_is_signature (signatures[m]))
+        {
+          if (errmsg != NULL)
+            *errmsg = g_strdup_printf ("invalid signature \"%s\" for %s",
+                                       signatures[m], names[m]);
+          g_free (specs);
+          return NULL;
+        } // if the signature is invalid
+      specs[m].name = names[m];
+      specs[m].signature = signatures[m];
+      specs[m].flags = 0;
+    } // for each method
+  iface = loudbus_interface_intern_specs (interface, n, specs);
+  g_free (specs);
+
+  proxy = loudbus_proxy_new_with_interface ((gchar *) service,
+                                            (gchar *) object,
+                                            iface, &error);
+  if (proxy == NULL)
+    loudbus_ffi_set_error (errmsg, "Could not create proxy", error);
+  return proxy;
+} // loudbus_ffi_proxy_new_with_specs
+
+/**
+ * Get the number of methods a proxy supports.
+ */
+int
+loudbus_ffi_method_count (LouDBusProxy *proxy)
+{
+  return proxy->iface->nmethods;
+} // loudbus_ffi_method_count
+
+/**
+ * Get the name of method m.
+ */
+const gchar *
+loudbus_ffi_method_name (LouDBusProxy *proxy, int m)
+{
+  return proxy->iface->methods[m].name;
+} // loudbus_ffi_method_name
+
+/**
+ * Get the arity of method m.
+ */
+int
+loudbus_ffi_method_arity (LouDBusProxy *proxy, int m)
+{
+  return proxy->iface->methods[m].arity;
+} // loudbus_ffi_method_arity
+
+/**
+ * Get the signature of parameter a of method m.
+ */
+const gchar *
+loudbus_ffi_method_arg (LouDBusProxy *proxy, int m, int a)
+{
+  return proxy->iface->methods[m].in_args[a];
+} // loudbus_ffi_method_arg
+
+/**
+ * Find the index of a method.  Returns -1 if there is no such method.
+ */
+int
+loudbus_ffi_method_lookup (LouDBusProxy *proxy, const gchar *name)
+{
+  LouDBusMethod *method;        // The method with that name
+
+  method = loudbus_interface_lookup_method (proxy->iface, name);
+  if (method == NULL)
+    return -1;
+  return method - proxy->iface->methods;
+} // loudbus_ffi_method_lookup
+
+/**
+ * Get information on one method, as a GVariant of type
+ * "(a(ss)a(ss)as)": the names and signatures of the parameters, the
+ * names and signatures of the return values, and the values of the
+ * annotations.
+ */
+GVariant *
+loudbus_ffi_method_info (LouDBusProxy *proxy, const gchar *name,
+                         gchar **errmsg)
+{
+  LouDBusMethod *method;        // The method
+  GVariant *details;            // What we know about it
+  GError *error = NULL;         // Why we don't know
+
+  method = loudbus_interface_lookup_method (proxy->iface, name);
+  if (method == NULL)
+    {
+      if (errmsg != NULL)
+        *errmsg = g_strdup_printf ("no such method: %s", name);
+      return NULL;
+    } // if (method == NULL)
+  details = loudbus_interface_details (proxy->iface, proxy->proxy, method,
+                                       &error);
+  if (details == NULL)
+    {
+      if (errmsg != NULL)
+        *errmsg = g_strdup (error->message);
+      g_error_free (error);
+      return NULL;
+    } // if (details == NULL)
+  return g_variant_ref (details);
+} // loudbus_ffi_method_info
+
+/**
+ * Get the digest of the interface of a proxy, which foreign callers
+ * can use as a key for what they know about the interface.
+ */
+const gchar *
+loudbus_ffi_proxy_digest (LouDBusProxy *proxy)
+{
+  return proxy->iface->digest;
+} // loudbus_ffi_proxy_digest
+
+/**
+ * Get the index of the method at position p in alphabetical order.
+ */
+int
+loudbus_ffi_method_sorted (LouDBusProxy *proxy, int p)
+{
+  return proxy->iface->sorted[p];
+} // loudbus_ffi_method_sorted
+
+/**
+ * Find the methods whose names start with prefix.  (See
+ * loudbus_interface_complete.)
+ */
+int
+loudbus_ffi_method_complete (LouDBusProxy *proxy, const gchar *prefix,
+                             int *first)
+{
+  return loudbus_interface_complete (proxy->iface, prefix, first);
+} // loudbus_ffi_method_complete
+
+/**
+ * Find the methods whose names contain text.  (See
+ * loudbus_interface_search.)
+ */
+int
+loudbus_ffi_method_search (LouDBusProxy *proxy, const gchar *text,
+                           guint32 *matches)
+{
+  return loudbus_interface_search (proxy->iface, text, matches);
+} // loudbus_ffi_method_search
+
+/**
+ * Get the names of the services on the session bus, as a GVariant
+ * of type "(as)".
+ */
+GVariant *
+loudbus_ffi_services (gchar **errmsg)
+{
+  GDBusConnection *connection;  // The session bus
+  GVariant *result;             // The names
+  GError *error = NULL;         // A place to hold errors
+
+  connection = g_bus_get_sync (G_BUS_TYPE_SESSION, NULL, &error);
+  if (connection == NULL)
+    {
+      loudbus_ffi_set_error (errmsg, "Could not connect to the bus", error);
+      return NULL;
+    } // if (connection == NULL)
+
+  result = g_dbus_connection_call_sync (connection,
+                                        "org.freedesktop.DBus",
+                                        "/",
+                                        "org.freedesktop.DBus",
+                                        "ListNames",
+                                        NULL,
+                                        G_VARIANT_TYPE ("(as)"),
+                                        G_DBUS_CALL_FLAGS_NONE,
+                                        -1,
+                                        NULL,
+                                        &error);
+  g_object_unref (connection);
+  if (result == NULL)
+    loudbus_ffi_set_error (errmsg, "Could not list services", error);
+  return result;
+} // loudbus_ffi_services
+
+/**
+ * Start building the parameters for a call.
+ */
+GVariantBuilder *
+loudbus_ffi_args_new (void)
+{
+  return g_variant_builder_new (G_VARIANT_TYPE_TUPLE);
+} // loudbus_ffi_args_new
+
+/**
+ * Give up on building the parameters for a call.
+ */
+void
+loudbus_ffi_args_free (GVariantBuilder *args)
+{
+  g_variant_builder_unref (args);
+} // loudbus_ffi_args_free
+
+/**
+ * Start a container (e.g., an array) of the given type.
+ */
+void
+loudbus_ffi_args_open (GVariantBuilder *args, const gchar *type)
+{
+  g_variant_builder_open (args, G_VARIANT_TYPE (type));
+} // loudbus_ffi_args_open
+
+/**
+ * Finish the innermost open container.
+ */
+void
+loudbus_ffi_args_close (GVariantBuilder *args)
+{
+  g_variant_builder_close (args);
+} // loudbus_ffi_args_close
+
+void
+loudbus_ffi_args_add_int32 (GVariantBuilder *args, gint32 i)
+{
+  g_variant_builder_add_value (args, g_variant_new_int32 (i));
+} // loudbus_ffi_args_add_int32
+
+void
+loudbus_ffi_args_add_uint32 (GVariantBuilder *args, guint32 u)
+{
+  g_variant_builder_add_value (args, g_variant_new_uint32 (u));
+} // loudbus_ffi_args_add_uint32
+
+void
+loudbus_ffi_args_add_int64 (GVariantBuilder *args, gint64 x)
+{
+  g_variant_builder_add_value (args, g_variant_new_int64 (x));
+} // loudbus_ffi_args_add_int64
+
+void
+loudbus_ffi_args_add_boolean (GVariantBuilder *args, gboolean b)
+{
+  g_variant_builder_add_value (args, g_variant_new_boolean (b));
+} // loudbus_ffi_args_add_boolean
+
+void
+loudbus_ffi_args_add_double (GVariantBuilder *args, gdouble d)
+{
+  g_variant_builder_add_value (args, g_variant_new_double (d));
+} // loudbus_ffi_args_add_double
+
+void
+loudbus_ffi_args_add_string (GVariantBuilder *args, const gchar *str)
+{
+  g_variant_builder_add_value (args, g_variant_new_string (str));
+} // loudbus_ffi_args_add_string
+
+/**
+ * Add an array of fixed-size values (type "ad", "ai", "au", "ax", or "ay")
+ * from a block of n values, such as the contents of a byte string or
+ * an flvector.  Returns 0 if the type is not one we can copy.
+ */
+int
+loudbus_ffi_args_add_fixed_array (GVariantBuilder *args, const gchar *type,
+                                  gconstpointer data, gsize n)
+{
+  gsize elsize;         // The size of one element
+
+  if ((type[0] != 'a') || (type[1] == '\0') || (type[2] != '\0'))
+    return 0;
+  switch (type[1])
+    {
+      case 'd':
+        elsize = sizeof (gdouble);
+        break;
+      case 'i':
+        elsize = sizeof (gint32);
+        break;
+      case 'u':
+        elsize = sizeof (guint32);
+        break;
+      case 'x':
+        elsize = sizeof (gint64);
+        break;
+      case 'y':
+        elsize = sizeof (guchar);
+        break;
+      default:
+        return 0;
+    } // switch
+
+  g_variant_builder_add_value (args,
+                               g_variant_new_fixed_array 
+                                 (G_VARIANT_TYPE (type + 1),
+                                  data, n, elsize));
+  return 1;
+} // loudbus_ffi_args_add_fixed_array
+
+/**
+ * Finish building a single value in args (say, one parameter), and
+ * return it, so that it can be added to other calls with
+ * loudbus_ffi_args_add_value.  Frees args.  The caller releases the
+ * value with loudbus_ffi_value_unref.
+ */
+GVariant *
+loudbus_ffi_args_value (GVariantBuilder *args)
+{
+  GVariant *tuple;      // What we built
+  GVariant *value;      // The value in it
+
+  tuple = g_variant_ref_sink (g_variant_builder_end (args));
+  g_variant_builder_unref (args);
+  value = g_variant_get_child_value (tuple, 0);
+  g_variant_unref (tuple);
+  return value;
+} // loudbus_ffi_args_value
+
+/**
+ * Add a value built by loudbus_ffi_args_value.  The caller keeps its
+ * reference.
+ */
+void
+loudbus_ffi_args_add_value (GVariantBuilder *args, GVariant *value)
+{
+  g_variant_builder_add_value (args, value);
+} // loudbus_ffi_args_add_value
+
+/**
+ * Call a method, using (and freeing) the parameters in args.  Returns
+ * the results as a tuple, which the caller releases with
+ * loudbus_ffi_value_unref.
+ */
+GVariant *
+loudbus_ffi_call (LouDBusProxy *proxy, const gchar *method,
+                  GVariantBuilder *args, gchar **errmsg)
+{
+  GVariant *actuals;    // The actual parameters
+  GVariant *result;     // The result of the call
+  GError *error = NULL; // Possible error from call
+
+  actuals = g_variant_builder_end (args);
+  g_variant_builder_unref (args);
+  result = loudbus_proxy_call_sync (proxy, method, actuals, &error);
+  if (result == NULL)
+    loudbus_ffi_set_error (errmsg, "call failed", error);
+  return result;
+} // loudbus_ffi_call
+
+/**
+ * Call a method, using (and freeing) the parameters in args.  Like
+ * loudbus_ffi_call, except that on failure we just report the name
+ * and code of the error, without building a message.  The name is
+ * interned, so the caller should not free it.  (On success, the name
+ * is NULL and the code is 0.)
+ */
+GVariant *
+loudbus_ffi_call_try (LouDBusProxy *proxy, const gchar *method,
+                      GVariantBuilder *args, const gchar **name, gint *code)
+{
+  GVariant *actuals;    // The actual parameters
+  GVariant *result;     // The result of the call
+  GError *error = NULL; // Possible error from call
+
+  actuals = g_variant_builder_end (args);
+  g_variant_builder_unref (args);
+  result = loudbus_proxy_call_sync (proxy, method, actuals, &error);
+  *name = NULL;
+  *code = 0;
+  if (result == NULL)
+    {
+      *name = loudbus_error_name (error);
+      *code = error->code;
+      g_error_free (error);
+    } // if (result == NULL)
+  return result;
+} // loudbus_ffi_call_try
+
+/**
+ * Start an asynchronous call, using (and freeing) the parameters in
+ * args.  priority and timeout are as for loudbus_call_async.  The
+ * caller releases the ticket with loudbus_ticket_unref.
+ */
+LouDBusTicket *
+loudbus_ffi_send (LouDBusProxy *proxy, const gchar *method,
+                  GVariantBuilder *args, int priority, int timeout)
+{
+  GVariant *actuals;    // The actual parameters
+
+  actuals = g_variant_builder_end (args);
+  g_variant_builder_unref (args);
+  return loudbus_call_async (proxy, method, actuals, priority, timeout);
+} // loudbus_ffi_send
+
+/**
+ * Get the result of a finished asynchronous call.  On failure, reports
+ * the name and code of the error, as loudbus_ffi_call_try does.
+ */
+GVariant *
+loudbus_ffi_ticket_result (LouDBusTicket *ticket,
+                           const gchar **name, gint *code)
+{
+  GVariant *result;     // The result of the call
+  GError *error = NULL; // Possible error from call
+
+  result = loudbus_ticket_result (ticket, &error);
+  *name = NULL;
+  *code = 0;
+  if (result == NULL)
+    {
+      *name = loudbus_error_name (error);
+      *code = error->code;
+      g_error_free (error);
+    } // if (result == NULL)
+  return result;
+} // loudbus_ffi_ticket_result
+
+/**
+ * Give a priority class its own connection to the bus (or return it
+ * to sharing the connection of each proxy).
+ */
+int
+loudbus_ffi_scheduler_separate_lane (int priority, int separate,
+                                     gchar **errmsg)
+{
+  GError *error = NULL; // Possible error from connecting
+
+  if (loudbus_scheduler_separate_lane (priority, separate, &error))
+    return 1;
+  loudbus_ffi_set_error (errmsg, "could not connect", error);
+  return 0;
+} // loudbus_ffi_scheduler_separate_lane
+
+/**
+ * Set the priority class of the asynchronous calls made through a
+ * proxy.
+ */
+void
+loudbus_ffi_proxy_set_priority (LouDBusProxy *proxy, int priority)
+{
+  if ((priority >= 0) && (priority < LOUDBUS_PRIORITIES))
+    proxy->priority = priority;
+} // loudbus_ffi_proxy_set_priority
+
+/**
+ * Open a shared-memory ring between a proxy and its service (see
+ * loudbus_proxy_ring_open).  Returns 0 (setting *errmsg) on failure.
+ */
+int
+loudbus_ffi_ring_open (LouDBusProxy *proxy, gsize capacity, gchar **errmsg)
+{
+  GError *error = NULL; // Why we could not open the ring
+
+  if (loudbus_proxy_ring_open (proxy, capacity, &error))
+    return 1;
+  loudbus_ffi_set_error (errmsg, "could not open ring", error);
+  return 0;
+} // loudbus_ffi_ring_open
+
+/**
+ * Give back a proxy's shared-memory ring.
+ */
+void
+loudbus_ffi_ring_close (LouDBusProxy *proxy)
+{
+  loudbus_proxy_ring_close (proxy);
+} // loudbus_ffi_ring_close
+
+/**
+ * Change the settings of a connection and report the settings now in
+ * effect.  The connection is the proxy's or, if proxy is NULL, the
+ * private connection of a priority class.  Settings are as for
+ * loudbus_connection_configure.  Returns 0 (setting *errmsg) on
+ * failure.
+ */
+int
+loudbus_ffi_connection_configure (LouDBusProxy *proxy, int priority,
+                                  int sndbuf, int rcvbuf, gssize max_message,
+                                  int *sndbuf_now, int *rcvbuf_now,
+                                  gsize *max_message_now, gchar **errmsg)
+{
+  GDBusConnection *connection;  // The connection
+  GError *error = NULL;         // Possible error from the socket
+  int ok;                       // Did it work?
+
+  if (proxy != NULL)
+    connection = g_object_ref (g_dbus_proxy_get_connection (proxy->proxy));
+  else
+    connection = loudbus_scheduler_lane (priority);
+  if (connection == NULL)
+    {
+      loudbus_ffi_set_error (errmsg, "could not configure", 
+                             g_error_new_literal (G_IO_ERROR, 
+                                                  G_IO_ERROR_NOT_FOUND,
+                                                  "no such connection"));
+      return 0;
+    } // if there's no connection
+
+  ok = loudbus_connection_configure (connection, sndbuf, rcvbuf, max_message,
+                                     &error);
+  if (! ok)
+    loudbus_ffi_set_error (errmsg, "could not configure", error);
+  loudbus_connection_settings (connection, sndbuf_now, rcvbuf_now, 
+                               max_message_now);
+  g_object_unref (connection);
+  return ok;
+} // loudbus_ffi_connection_configure
+
+/**
+ * Start checking the health of a service.  Returns 0 (setting
+ * *errmsg) if we can't reach the bus.
+ */
+int
+loudbus_ffi_probe_start (const gchar *service, int interval, int timeout,
+                         gchar **errmsg)
+{
+  GError *error = NULL; // Possible error from connecting
+
+  if (loudbus_probe_start (service, interval, timeout, &error))
+    return 1;
+  loudbus_ffi_set_error (errmsg, "could not connect", error);
+  return 0;
+} // loudbus_ffi_probe_start
+
+/**
+ * Get the type of a value, as a GVariant type string.
+ */
+const gchar *
+loudbus_ffi_value_type (GVariant *value)
+{
+  return g_variant_get_type_string (value);
+} // loudbus_ffi_value_type
+
+gint32
+loudbus_ffi_value_int32 (GVariant *value)
+{
+  return g_variant_get_int32 (value);
+} // loudbus_ffi_value_int32
+
+gdouble
+loudbus_ffi_value_double (GVariant *value)
+{
+  return g_variant_get_double (value);
+} // loudbus_ffi_value_double
+
+/**
+ * Get the string in a value.  The string belongs to the value.
+ */
+const gchar *
+loudbus_ffi_value_string (GVariant *value)
+{
+  return g_variant_get_string (value, NULL);
+} // loudbus_ffi_value_string
+
+/**
+ * Get the number of children of a tuple or array.
+ */
+gsize
+loudbus_ffi_value_count (GVariant *value)
+{
+  return g_variant_n_children (value);
+} // loudbus_ffi_value_count
+
+/**
+ * Get one child of a tuple or array.  The caller releases the child
+ * with loudbus_ffi_value_unref.
+ */
+GVariant *
+loudbus_ffi_value_child (GVariant *value, gsize i)
+{
+  return g_variant_get_child_value (value, i);
+} // loudbus_ffi_value_child
+
+/**
+ * Get the elements of an array of fixed-size values, so that the
+ * caller can copy them in one step.  The elements belong to the value.
+ */
+gconstpointer
+loudbus_ffi_value_fixed_array (GVariant *value, gsize *n)
+{
+  const gchar *type;    // The type of the value
+  gsize elsize;         // The size of one element
+
+  type = g_variant_get_type_string (value);
+  switch (type[1])
+    {
+      case 'd':
+        elsize = sizeof (gdouble);
+        break;
+      case 'i':
+        elsize = sizeof (gint32);
+        break;
+      case 'u':
+        elsize = sizeof (guint32);
+        break;
+      default:
+        elsize = sizeof (guchar);
+        break;
+    } // switch
+
+  return g_variant_get_fixed_array (value, n, elsize);
+} // loudbus_ffi_value_fixed_array
+
+void
+loudbus_ffi_value_unref (GVariant *value)
+{
+  g_variant_unref (value);
+} // loudbus_ffi_value_unref
@@ -0,0 +1,754 @@
+/**
+ * loudbus-core.h
+ *   The core of A D-Bus Client for Racket: proxies, interface
+ *   information, and the scratch arena.  Nothing here depends on
+ *   Racket, so the core can sit behind either the "Inside Racket"
+ *   API (Racket BC, see loudbus.c) or the FFI (Racket CS, see
+ *   loudbus-cs.rkt).
+ *
+ * Copyright (c) 2012-15 Zarni Htet, Alexandra Greenberg, Mark Lewis,
+ * Evan Manuella, Samuel A. Rebelsky, Hart Russell, Mani Tiwaree,
+ * and Christine Tran.  All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the Lesser GNU General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __LOUDBUS_CORE_H__
+#define __LOUDBUS_CORE_H__
+
+// +---------+--------------------------------------------------------
+// | Headers |
+// +---------+
+
+#include <stdio.h>      // For fprintf in LOG
+
+#include <glib.h>       // For various glib stuff.
+#include <gio/gio.h>    // For the GDBus functions.
+
+
+// +--------+---------------------------------------------------------
+// | Macros |
+// +--------+
+
+#ifdef VERBOSE
+#define LOG(FORMAT, ARGS...) \
+  do { \
+    fprintf (stderr, "\t *** "); \
+    fprintf (stderr, FORMAT, ## ARGS); \
+    fprintf (stderr, "\n"); \
+  } while (0)
+#else
+#define LOG(FORMAT, ARGS...) do { } while (0)
+#endif
+
+/**
+ * The priority classes of calls, from most to least urgent.  When
+ * too many calls are in flight, the scheduler sends waiting calls in
+ * this order.
+ */
+#define LOUDBUS_PRIORITY_INTERACTIVE 0
+#define LOUDBUS_PRIORITY_NORMAL 1
+#define LOUDBUS_PRIORITY_BULK 2
+#define LOUDBUS_PRIORITIES 3
+
+/**
+ * Flags for methods.  LOUDBUS_METHOD_COMPRESS means that byte-array
+ * parameters and results travel in compressed frames (see
+ * loudbus-frame.c).  A service turns it on for a method with the
+ * annotation
+ *   <annotation name="edu.grinnell.cs.glimmer.louDBus.Compress"
+ *               value="deflate"/>
+ */
+#define LOUDBUS_METHOD_COMPRESS 1
+#define LOUDBUS_COMPRESS_ANNOTATION "edu.grinnell.cs.glimmer.louDBus.Compress"
+#define LOUDBUS_COMPRESS_CODEC "deflate"
+
+/**
+ * LOUDBUS_METHOD_RING means that large byte-array parameters and
+ * results travel through a shared-memory ring, once the client opens
+ * one (see loudbus-ring.c).  A service turns it on for a method with
+ * the annotation
+ *   <annotation name="edu.grinnell.cs.glimmer.louDBus.Ring"
+ *               value="shm"/>
+ * and implements LOUDBUS_RING_INTERFACE on the same object.  Methods
+ * with either flag are framed.
+ */
+#define LOUDBUS_METHOD_RING 2
+#define LOUDBUS_METHOD_FRAMED (LOUDBUS_METHOD_COMPRESS | LOUDBUS_METHOD_RING)
+#define LOUDBUS_RING_ANNOTATION "edu.grinnell.cs.glimmer.louDBus.Ring"
+#define LOUDBUS_RING_TRANSPORT "shm"
+#define LOUDBUS_RING_INTERFACE "edu.grinnell.cs.glimmer.louDBus.Ring"
+
+/**
+ * Byte arrays smaller than this are framed, but not compressed.
+ */
+#define LOUDBUS_FRAME_THRESHOLD 4096
+
+/**
+ * Byte arrays smaller than this go in their frames, even when there's
+ * a ring.
+ */
+#define LOUDBUS_RING_THRESHOLD (64 * 1024)
+
+/**
+ * The size of each direction of a ring, unless the client asks for
+ * another.
+ */
+#define LOUDBUS_RING_CAPACITY (4 * 1024 * 1024)
+
+/**
+ * The size of the frame header, and the codecs.
+ */
+#define LOUDBUS_FRAME_HEADER 8
+#define LOUDBUS_FRAME_STORED 0
+#define LOUDBUS_FRAME_DEFLATE 1
+#define LOUDBUS_FRAME_RING 2
+
+/**
+ * The largest array we compress or decompress: the largest message
+ * D-Bus allows.  The length in a frame header comes from the peer, so
+ * we don't trust it any further than that.
+ */
+#define LOUDBUS_FRAME_MAX (128 * 1024 * 1024)
+
+
+// +-------+----------------------------------------------------------
+// | Types |
+// +-------+
+
+/**
+ * The information we store for a proxy.  In addition to the main
+ * proxy, we also need information on the proxy, so that we can
+ * look up information.
+ */
+struct LouDBusProxy
+  {
+    int signature;              // Identifies this as a proxy
+    GDBusProxy *proxy;          // The real proxy
+    struct LouDBusInterface *iface;
+                                // Information on the interface, used
+                                // to extract info about param. types
+    int priority;               // The priority class of its calls
+    struct LouDBusRing *ring;   // The shared-memory ring (or NULL)
+  };
+typedef struct LouDBusProxy LouDBusProxy;
+
+/**
+ * The information we need to call one method.
+ */
+struct LouDBusMethod
+  {
+    gchar *name;                // The name of the method
+    gchar **in_args;            // The signature of each parameter
+    int arity;                  // The number of parameters
+    int flags;                  // LOUDBUS_METHOD_* flags
+  };
+typedef struct LouDBusMethod LouDBusMethod;
+
+/**
+ * A compact description of an interface.  Unlike a GDBusInterfaceInfo,
+ * which keeps argument names, annotations, signals, and properties,
+ * this keeps only what we need to make calls.  The struct, the methods,
+ * the index, and all of the strings live in a single allocation, so
+ * freeing the interface is just g_free (plus the catalogue, if anyone
+ * searched the methods or asked for their details).
+ *
+ * Interfaces are interned, so all of the proxies for objects that
+ * share an interface (even ones built from different sources, such as
+ * introspection and caller-supplied signatures) share one
+ * LouDBusInterface.
+ */
+struct LouDBusInterface
+  {
+    int refcount;               // The number of proxies that use this
+    gchar *digest;              // A hash of the methods and signatures
+    gchar *name;                // The name of the interface
+    int nmethods;               // The number of methods
+    LouDBusMethod *methods;     // The methods, in the order declared
+    guint32 *sorted;            // Indices of the methods, sorted by name
+    struct LouDBusCatalogue *catalogue;
+                                // The search index and details of the
+                                // methods, built on demand (or NULL)
+  };
+typedef struct LouDBusInterface LouDBusInterface;
+
+/**
+ * A description of one method, used while building a LouDBusInterface.
+ */
+struct LouDBusMethodSpec
+  {
+    gchar *name;                // The name of the method
+    gchar *signature;           // The signatures of all the parameters
+    int flags;                  // LOUDBUS_METHOD_* flags
+  };
+typedef struct LouDBusMethodSpec LouDBusMethodSpec;
+
+/**
+ * A scratch arena for the temporary strings and buffers we need while
+ * converting the parameters of one call.  Allocation just bumps a
+ * pointer in one reusable block.  If a call needs more space than the
+ * block has, we allocate overflow blocks and, when the arena is reset,
+ * replace the block with one large enough for next time.
+ */
+struct LouDBusArena
+  {
+    gchar *block;               // The reusable block
+    gsize size;                 // The size of that block
+    gsize used;                 // How much of the block is in use
+    GSList *overflow;           // Extra blocks allocated since the reset
+    gsize overflow_size;        // The total size of those blocks
+  };
+typedef struct LouDBusArena LouDBusArena;
+
+/**
+ * What a health probe has learned about a service.  Latencies are in
+ * milliseconds.
+ */
+struct LouDBusProbeStats
+  {
+    gdouble latency_ms;         // Recent latency (a quick average)
+    gdouble baseline_ms;        // Usual latency (a slow average)
+    gdouble last_ms;            // The latency of the last ping
+    guint64 pings;              // The number of pings answered or failed
+    guint64 failures;           // The number of pings that failed
+    int failures_in_row;        // The number of failures since a success
+    gboolean degraded;          // Is the service slower than usual?
+  };
+typedef struct LouDBusProbeStats LouDBusProbeStats;
+
+/**
+ * The parts of a call that we time.
+ */
+enum LouDBusPhase
+  {
+    LOUDBUS_PHASE_ENCODE,       // Converting the parameters
+    LOUDBUS_PHASE_WIRE,         // Sending the call and waiting for results
+    LOUDBUS_PHASE_DECODE,       // Converting the results
+    LOUDBUS_PHASES
+  };
+typedef enum LouDBusPhase LouDBusPhase;
+
+/**
+ * Where the time in calls went, in nanoseconds, since timing started.
+ */
+struct LouDBusCallTimes
+  {
+    guint64 calls;              // The number of calls timed
+    gint64 encode_ns;           // Time spent converting parameters
+    gint64 wire_ns;             // Time spent in GDBus
+    gint64 decode_ns;           // Time spent converting results
+  };
+typedef struct LouDBusCallTimes LouDBusCallTimes;
+
+/**
+ * An asynchronous call.  (Defined in loudbus-async.c.)
+ */
+typedef struct LouDBusTicket LouDBusTicket;
+
+/**
+ * A large array, decoded into flat columns.  (Defined in
+ * loudbus-decode.c.)
+ */
+typedef struct LouDBusFlat LouDBusFlat;
+
+/**
+ * A byte array spilled to a mapped file.  (Defined in
+ * loudbus-spill.c.)
+ */
+typedef struct LouDBusSpill LouDBusSpill;
+
+/**
+ * A shared-memory ring.  (Defined in loudbus-ring.c.)
+ */
+typedef struct LouDBusRing LouDBusRing;
+
+/**
+ * A direct encoder for the parameters of calls.  (Defined in
+ * loudbus-wire.c.)
+ */
+typedef struct LouDBusWire LouDBusWire;
+
+
+// +---------+--------------------------------------------------------
+// | Globals |
+// +---------+
+
+/**
+ * The scratch arena used by calls.  Reset at the start of each call.
+ */
+extern LouDBusArena loudbus_scratch;
+
+
+// +------------+-----------------------------------------------------
+// | Core Setup |
+// +------------+
+
+void loudbus_core_init (void);
+
+
+// +-----------+------------------------------------------------------
+// | Utilities |
+// +-----------+
+
+GDBusNodeInfo *g_dbus_proxy_get_node_info (GDBusProxy *proxy);
+
+int parray_len (gpointer *arr);
+
+
+// +---------------+--------------------------------------------------
+// | Scratch Arena |
+// +---------------+
+
+gpointer loudbus_arena_alloc (LouDBusArena *arena, gsize n);
+
+gchar *loudbus_arena_strndup (LouDBusArena *arena, const gchar *str,
+                              gsize len);
+
+void loudbus_arena_reset (LouDBusArena *arena);
+
+
+// +-----------------------+------------------------------------------
+// | Interface Information |
+// +-----------------------+
+
+LouDBusMethod *loudbus_interface_lookup_method (LouDBusInterface *iface,
+                                                const gchar *name);
+
+LouDBusInterface *loudbus_interface_ref (LouDBusInterface *iface);
+
+void loudbus_interface_unref (LouDBusInterface *iface);
+
+LouDBusInterface *loudbus_interface_intern_specs (const gchar *name,
+                                                  int n,
+                                                  LouDBusMethodSpec *specs);
+
+LouDBusInterface *loudbus_interface_from_xml (const gchar *xml,
+                                              const gchar *interface,
+                                              GError **errorp);
+
+
+// +-------------------+----------------------------------------------
+// | Method Catalogues |
+// +-------------------+
+
+int loudbus_interface_complete (LouDBusInterface *iface, 
+                                const gchar *prefix, int *first);
+
+int loudbus_interface_search (LouDBusInterface *iface, const gchar *text,
+                              guint32 *matches);
+
+GVariant *loudbus_interface_details (LouDBusInterface *iface,
+                                     GDBusProxy *proxy,
+                                     LouDBusMethod *method,
+                                     GError **errorp);
+
+
+// +----------------+-------------------------------------------------
+// | Missing Things |
+// +----------------+
+
+gboolean loudbus_missing_check_call (GDBusProxy *proxy, const gchar *method,
+                                     GError **errorp);
+
+void loudbus_missing_record_call (GDBusProxy *proxy, const gchar *method,
+                                  GError *error);
+
+void loudbus_missing_forget (const gchar *service);
+
+void loudbus_missing_set_ttl (int ttl);
+
+
+// +-----------------+------------------------------------------------
+// | Proxy Functions |
+// +-----------------+
+
+void loudbus_proxy_free (LouDBusProxy *proxy);
+
+LouDBusProxy *loudbus_proxy_new (gchar *service, gchar *object,
+                                 gchar *interface, GError **errorp);
+
+LouDBusProxy *loudbus_proxy_new_with_interface (gchar *service,
+                                                gchar *object,
+                                                LouDBusInterface *iface,
+                                                GError **errorp);
+
+LouDBusProxy *loudbus_proxy_new_for_node (gchar *service, gchar *object,
+                                          GError **errorp);
+
+const gchar *loudbus_method_split (GDBusProxy *proxy, const gchar *name,
+                                   gchar **interface);
+
+int loudbus_proxy_validate (LouDBusProxy *proxy);
+
+int loudbus_proxy_compresses (LouDBusProxy *proxy, const gchar *method);
+
+int loudbus_proxy_method_flags (LouDBusProxy *proxy, const gchar *method);
+
+gboolean loudbus_proxy_ring_open (LouDBusProxy *proxy, gsize capacity,
+                                  GError **errorp);
+
+void loudbus_proxy_ring_close (LouDBusProxy *proxy);
+
+GVariant *loudbus_proxy_call_sync (LouDBusProxy *proxy,
+                                   const gchar *method,
+                                   GVariant *actuals,
+                                   GError **errorp);
+
+
+// +---------------------+--------------------------------------------
+// | Connection Settings |
+// +---------------------+
+
+gboolean loudbus_connection_configure (GDBusConnection *connection,
+                                       int sndbuf, int rcvbuf,
+                                       gssize max_message,
+                                       GError **errorp);
+
+void loudbus_connection_settings (GDBusConnection *connection,
+                                  int *sndbuf, int *rcvbuf,
+                                  gsize *max_message);
+
+gboolean loudbus_connection_check_size (GDBusConnection *connection,
+                                        GVariant *actuals,
+                                        GError **errorp);
+
+
+// +--------------------+---------------------------------------------
+// | Asynchronous Calls |
+// +--------------------+
+
+LouDBusTicket *loudbus_call_async (LouDBusProxy *proxy, const gchar *method,
+                                   GVariant *actuals, 
+                                   int priority, int timeout);
+
+void loudbus_ticket_unref (LouDBusTicket *ticket);
+
+int loudbus_ticket_validate (LouDBusTicket *ticket);
+
+int loudbus_ticket_done (LouDBusTicket *ticket);
+
+GVariant *loudbus_ticket_result (LouDBusTicket *ticket, GError **errorp);
+
+void loudbus_scheduler_set_window (int window);
+
+gboolean loudbus_scheduler_separate_lane (int priority, gboolean separate,
+                                          GError **errorp);
+
+GDBusConnection *loudbus_scheduler_lane (int priority);
+
+int loudbus_wake_fd (void);
+
+void loudbus_wake_drain (void);
+
+GMainContext *loudbus_worker_context (void);
+
+
+// +---------------+--------------------------------------------------
+// | Health Probes |
+// +---------------+
+
+gboolean loudbus_probe_start (const gchar *service, int interval,
+                              int timeout, GError **errorp);
+
+void loudbus_probe_stop (const gchar *service);
+
+gboolean loudbus_probe_stats (const gchar *service,
+                              LouDBusProbeStats *stats);
+
+
+// +---------------------+--------------------------------------------
+// | Compressed Payloads |
+// +---------------------+
+
+GVariant *loudbus_frame_encode (GVariant *bytes, gsize threshold);
+
+GVariant *loudbus_frame_decode (GVariant *framed, GError **errorp);
+
+GVariant *loudbus_frame_tuple (GVariant *tuple, gboolean encode,
+                               GError **errorp);
+
+
+// +---------------------+--------------------------------------------
+// | Shared-Memory Rings |
+// +---------------------+
+
+LouDBusRing *loudbus_ring_new (gsize capacity, GError **errorp);
+
+LouDBusRing *loudbus_ring_attach (int fd, guint32 id, GError **errorp);
+
+int loudbus_ring_steal_fd (LouDBusRing *ring);
+
+void loudbus_ring_set_id (LouDBusRing *ring, guint32 id);
+
+guint32 loudbus_ring_id (LouDBusRing *ring);
+
+LouDBusRing *loudbus_ring_ref (LouDBusRing *ring);
+
+void loudbus_ring_unref (LouDBusRing *ring);
+
+GVariant *loudbus_ring_tuple (LouDBusRing *ring, GVariant *tuple,
+                              gboolean encode, gsize threshold,
+                              GError **errorp);
+
+gboolean loudbus_ring_tuple_id (GVariant *tuple, guint32 *id);
+
+void loudbus_ring_tuple_release (LouDBusRing *ring, GVariant *tuple);
+
+void loudbus_ring_tuple_discard (LouDBusRing *ring, GVariant *tuple);
+
+
+// +---------------+--------------------------------------------------
+// | Flat Decoding |
+// +---------------+
+
+LouDBusFlat *loudbus_flat_decode (GVariant *array);
+
+void loudbus_flat_set_threads (int threads);
+
+void loudbus_flat_unref (LouDBusFlat *flat);
+
+gsize loudbus_flat_rows (LouDBusFlat *flat);
+
+const gchar *loudbus_flat_types (LouDBusFlat *flat, gboolean *tuple);
+
+gconstpointer loudbus_flat_column (LouDBusFlat *flat, int c);
+
+const guchar *loudbus_flat_data (LouDBusFlat *flat, gsize *size);
+
+
+// +-----------------+------------------------------------------------
+// | Spilled Replies |
+// +-----------------+
+
+void loudbus_spill_configure (gssize threshold, gssize limit);
+
+gsize loudbus_spill_threshold (void);
+
+GVariant *loudbus_spill_check_reply (GVariant *reply, LouDBusRing *ring,
+                                     GError **errorp);
+
+void loudbus_spill_watch (GDBusConnection *connection);
+
+LouDBusSpill *loudbus_spill_new (GVariant *bytes, GError **errorp);
+
+void loudbus_spill_free (LouDBusSpill *spill);
+
+int loudbus_spill_validate (LouDBusSpill *spill);
+
+const guchar *loudbus_spill_data (LouDBusSpill *spill, gsize *size);
+
+
+// +-------------+----------------------------------------------------
+// | Call Timing |
+// +-------------+
+
+void loudbus_timing_enable (gboolean on);
+
+gint64 loudbus_timing_start (void);
+
+void loudbus_timing_stop (LouDBusPhase phase, gint64 start);
+
+void loudbus_timing_get (LouDBusCallTimes *times);
+
+void loudbus_timing_sample_begin (void);
+
+void loudbus_timing_sample_end (LouDBusCallTimes *times,
+                                gint64 starts[LOUDBUS_PHASES]);
+
+
+// +--------------+---------------------------------------------------
+// | Call Tracing |
+// +--------------+
+
+gint64 loudbus_trace_now (void);
+
+void loudbus_trace_enable (gboolean on);
+
+gboolean loudbus_trace_enabled (void);
+
+void loudbus_trace_async (const gchar *track, const gchar *category,
+                          const gchar *name, guint64 id, gchar phase,
+                          gint64 ts);
+
+void loudbus_trace_instant (const gchar *track, const gchar *category,
+                            const gchar *name, gint64 ts);
+
+gchar *loudbus_trace_json (int pid);
+
+
+// +-----------------+------------------------------------------------
+// | Direct Encoding |
+// +-----------------+
+
+LouDBusWire *loudbus_wire_new (void);
+
+void loudbus_wire_free (LouDBusWire *wire);
+
+void loudbus_wire_begin (LouDBusWire *wire, gchar **types, int n);
+
+void loudbus_wire_add_fixed (LouDBusWire *wire, gconstpointer value);
+
+void loudbus_wire_add_string (LouDBusWire *wire, const gchar *str);
+
+void loudbus_wire_add_fixed_array (LouDBusWire *wire, gconstpointer data,
+                                   gsize n);
+
+void loudbus_wire_open_array (LouDBusWire *wire);
+
+void loudbus_wire_close_array (LouDBusWire *wire);
+
+void loudbus_wire_add_value (LouDBusWire *wire, GVariant *value);
+
+GVariant *loudbus_wire_end (LouDBusWire *wire);
+
+
+// +--------+---------------------------------------------------------
+// | Errors |
+// +--------+
+
+const gchar *loudbus_error_name (GError *error);
+
+
+// +-------------------+----------------------------------------------
+// | Foreign Interface |
+// +-------------------+
+
+/*
+ * A narrow interface for callers that reach the core through a
+ * foreign-function interface, rather than linking against it.  Only
+ * plain C types cross the boundary: strings, numbers, opaque pointers,
+ * and pointers to blocks of fixed-size values.  Errors come back as
+ * a message in *errmsg, which the caller frees with loudbus_ffi_free.
+ */
+
+void loudbus_ffi_free (gpointer ptr);
+
+LouDBusProxy *loudbus_ffi_proxy_new (const gchar *service,
+                                     const gchar *object,
+                                     const gchar *interface,
+                                     const gchar *xml,
+                                     gchar **errmsg);
+
+LouDBusProxy *loudbus_ffi_proxy_new_with_specs (const gchar *service,
+                                                const gchar *object,
+                                                const gchar *interface,
+                                                int n,
+                                                gchar **names,
+                                                gchar **signatures,
+                                                gchar **errmsg);
+
+int loudbus_ffi_method_count (LouDBusProxy *proxy);
+
+const gchar *loudbus_ffi_method_name (LouDBusProxy *proxy, int m);
+
+int loudbus_ffi_method_arity (LouDBusProxy *proxy, int m);
+
+const gchar *loudbus_ffi_method_arg (LouDBusProxy *proxy, int m, int a);
+
+int loudbus_ffi_method_lookup (LouDBusProxy *proxy, const gchar *name);
+
+GVariant *loudbus_ffi_method_info (LouDBusProxy *proxy, const gchar *name,
+                                   gchar **errmsg);
+
+const gchar *loudbus_ffi_proxy_digest (LouDBusProxy *proxy);
+
+int loudbus_ffi_method_sorted (LouDBusProxy *proxy, int p);
+
+int loudbus_ffi_method_complete (LouDBusProxy *proxy, const gchar *prefix,
+                                 int *first);
+
+int loudbus_ffi_method_search (LouDBusProxy *proxy, const gchar *text,
+                               guint32 *matches);
+
+GVariant *loudbus_ffi_services (gchar **errmsg);
+
+GVariantBuilder *loudbus_ffi_args_new (void);
+
+void loudbus_ffi_args_free (GVariantBuilder *args);
+
+void loudbus_ffi_args_open (GVariantBuilder *args, const gchar *type);
+
+void loudbus_ffi_args_close (GVariantBuilder *args);
+
+void loudbus_ffi_args_add_int32 (GVariantBuilder *args, gint32 i);
+
+void loudbus_ffi_args_add_uint32 (GVariantBuilder *args, guint32 u);
+
+void loudbus_ffi_args_add_int64 (GVariantBuilder *args, gint64 x);
+
+void loudbus_ffi_args_add_boolean (GVariantBuilder *args, gboolean b);
+
+void loudbus_ffi_args_add_double (GVariantBuilder *args, gdouble d);
+
+void loudbus_ffi_args_add_string (GVariantBuilder *args, const gchar *str);
+
+int loudbus_ffi_args_add_fixed_array (GVariantBuilder *args,
+                                      const gchar *type,
+                                      gconstpointer data, gsize n);
+
+GVariant *loudbus_ffi_args_value (GVariantBuilder *args);
+
+void loudbus_ffi_args_add_value (GVariantBuilder *args, GVariant *value);
+
+GVariant *loudbus_ffi_call (LouDBusProxy *proxy, const gchar *method,
+                            GVariantBuilder *args, gchar **errmsg);
+
+GVariant *loudbus_ffi_call_try (LouDBusProxy *proxy, const gchar *method,
+                                GVariantBuilder *args,
+                                const gchar **name, gint *code);
+
+LouDBusTicket *loudbus_ffi_send (LouDBusProxy *proxy, const gchar *method,
+                                 GVariantBuilder *args,
+                                 int priority, int timeout);
+
+GVariant *loudbus_ffi_ticket_result (LouDBusTicket *ticket,
+                                     const gchar **name, gint *code);
+
+int loudbus_ffi_scheduler_separate_lane (int priority, int separate,
+                                         gchar **errmsg);
+
+void loudbus_ffi_proxy_set_priority (LouDBusProxy *proxy, int priority);
+
+int loudbus_ffi_ring_open (LouDBusProxy *proxy, gsize capacity,
+                           gchar **errmsg);
+
+void loudbus_ffi_ring_close (LouDBusProxy *proxy);
+
+int loudbus_ffi_connection_configure (LouDBusProxy *proxy, int priority,
+                                      int sndbuf, int rcvbuf,
+                                      gssize max_message,
+                                      int *sndbuf_now, int *rcvbuf_now,
+                                      gsize *max_message_now,
+                                      gchar **errmsg);
+
+int loudbus_ffi_probe_start (const gchar *service, int interval,
+                             int timeout, gchar **errmsg);
+
+const gchar *loudbus_ffi_value_type (GVariant *value);
+
+gint32 loudbus_ffi_value_int32 (GVariant *value);
+
+gdouble loudbus_ffi_value_double (GVariant *value);
+
+const gchar *loudbus_ffi_value_string (GVariant *value);
+
+gsize loudbus_ffi_value_count (GVariant *value);
+
+GVariant *loudbus_ffi_value_child (GVariant *value, gsize i);
+
+gconstpointer loudbus_ffi_value_fixed_array (GVariant *value, gsize *n);
+
+void loudbus_ffi_value_unref (GVariant *value);
+
+#endif // __LOUDBUS_CORE_H__
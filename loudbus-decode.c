@@ -0,0 +1,471 @@
+/**
+ * loudbus-decode.c
+ *   Flat decoding of large arrays for A D-Bus Client for Racket.  We
+ *   pull the members of a large array out into flat C buffers on a
+ *   small pool of threads, so that Racket only has to build the
+ *   final objects.
+ *
+ * Copyright (c) 2012-15 Zarni Htet, Alexandra Greenberg, Mark Lewis,
+ * Evan Manuella, Samuel A. Rebelsky, Hart Russell, Mani Tiwaree,
+ * and Christine Tran.  All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the Lesser GNU General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+// +-------+----------------------------------------------------------
+// | Notes |
+// +-------+
+
+/*
+
+* We handle arrays whose elements are strings, 32-bit integers,
+  doubles, or structs of those.  Each member of the element (or the
+  element itself) becomes a column: an array of gint32, an array of
+  gdouble, or, for strings, pairs of gsize giving the offset and
+  length of the string in the serialized data of the array.
+
+* Strings are not copied.  D-Bus strings already sit, NUL-terminated,
+  in the serialized array, so the workers only find them, measure
+  them, and check that they are valid UTF-8.  Racket BC builds its
+  strings straight from that data; Racket CS copies the data once and
+  slices it.
+
+* The caller works on the chunks, too, so a decode never waits for
+  the pool to get around to it.  The workers claim chunks until there
+  are none left.  Workers that start late find nothing to do; they
+  hold a reference to the decode, so it's fine if the caller has
+  already moved on.
+
+* Arrays with fewer than LOUDBUS_FLAT_MIN_ROWS elements aren't worth
+  the trouble; loudbus_flat_decode returns NULL and the caller
+  converts them one element at a time, as before.
+
+ */
+
+
+// +---------+--------------------------------------------------------
+// | Headers |
+// +---------+
+
+#include <string.h>     // For strchr
+
+#include <glib.h>       // For various glib stuff.
+
+#include "loudbus-core.h"
+
+
+// +--------+---------------------------------------------------------
+// | Macros |
+// +--------+
+
+/**
+ * The smallest array we decode on the pool.
+ */
+#define LOUDBUS_FLAT_MIN_ROWS 1024
+
+/**
+ * The smallest chunk of rows we hand to one thread.  Smaller chunks
+ * balance the work better, but each one costs a trip through the
+ * lock.
+ */
+#define LOUDBUS_FLAT_CHUNK 1024
+
+/**
+ * The most threads in the pool, and the most members in a struct.
+ */
+#define LOUDBUS_FLAT_MAX_THREADS 8
+#define LOUDBUS_FLAT_MAX_WIDTH 16
+
+
+// +-------+----------------------------------------------------------
+// | Types |
+// +-------+
+
+/**
+ * An array, decoded into columns.  Shared by the caller and the
+ * workers, each of which holds a reference.
+ */
+struct LouDBusFlat
+  {
+    gint refcount;              // The number of references
+    GVariant *array;            // The array we decode
+    const guchar *data;         // Its serialized data
+    gsize size;                 // The size of that data
+    gsize rows;                 // The number of elements
+    int width;                  // The number of columns
+    gboolean tuple;             // Are the elements structs?
+    gchar types[LOUDBUS_FLAT_MAX_WIDTH + 1];
+                                // The type of each column
+    gpointer columns[LOUDBUS_FLAT_MAX_WIDTH];
+                                // The columns
+    gboolean owned[LOUDBUS_FLAT_MAX_WIDTH];
+                                // Did we allocate the column?
+    gsize chunk;                // Rows per chunk
+    guint chunks;               // The number of chunks
+    gint next;                  // The next chunk to claim
+    gint failed;                // Did some chunk fail?
+    guint finished;             // The number of finished chunks
+    GMutex lock;                // Protects finished
+    GCond done;                 // Signalled when all chunks finish
+  };
+
+
+// +---------+--------------------------------------------------------
+// | Globals |
+// +---------+
+
+/**
+ * The pool of workers, created when we first need it.
+ */
+static GThreadPool *loudbus_flat_pool = NULL;
+
+
+// +-----------------+------------------------------------------------
+// | Local Utilities |
+// +-----------------+
+
+static LouDBusFlat *
+loudbus_flat_ref (LouDBusFlat *flat)
+{
+  g_atomic_int_inc (&flat->refcount);
+  return flat;
+} // loudbus_flat_ref
+
+/**
+ * Decide whether we can decode arrays of a type, and if so, fill in
+ * the types of the columns.
+ */
+static gboolean
+loudbus_flat_shape (LouDBusFlat *flat, const gchar *type)
+{
+  const gchar *members;         // The types of the members
+  int i;                        // Counter variable
+
+  if (type[0] != 'a')
+    return FALSE;
+
+  flat->tuple = (type[1] == '(');
+  members = flat->tuple ? type + 2 : type + 1;
+  for (i = 0; (members[i] != '\0') && (members[i] != ')'); i++)
+    {
+      if ((i == LOUDBUS_FLAT_MAX_WIDTH)
+          || (strchr ("ids", members[i]) == NULL))
+        return FALSE;
+      flat->types[i] = members[i];
+    } // for each member
+  flat->types[i] = '\0';
+  flat->width = i;
+
+  // The element must be exactly one basic type or one flat struct.
+  if (flat->tuple)
+    return (i > 0) && (members[i] == ')') && (members[i+1] == '\0');
+  else
+    return (i == 1) && (members[i] == '\0');
+} // loudbus_flat_shape
+
+/**
+ * Record one member of one row.  Returns FALSE if a string is not in
+ * the array's data or is not valid UTF-8.
+ */
+static gboolean
+loudbus_flat_cell (LouDBusFlat *flat, int c, gsize r, GVariant *member)
+{
+  const gchar *str;     // A string member
+  gsize len;            // Its length
+  gsize *span;          // Where we record its place
+
+  switch (flat->types[c])
+    {
+      case 'i':
+        ((gint32 *) flat->columns[c])[r] = g_variant_get_int32 (member);
+        return TRUE;
+      case 'd':
+        ((gdouble *) flat->columns[c])[r] = g_variant_get_double (member);
+        return TRUE;
+      default:
+        str = g_variant_get_string (member, &len);
+        if (((const guchar *) str < flat->data)
+            || ((const guchar *) str + len > flat->data + flat->size)
+            || (! g_utf8_validate (str, len, NULL)))
+          return FALSE;
+        span = (gsize *) flat->columns[c] + 2*r;
+        span[0] = (const guchar *) str - flat->data;
+        span[1] = len;
+        return TRUE;
+    } // switch
+} // loudbus_flat_cell
+
+/**
+ * Decode one chunk of rows.
+ */
+static gboolean
+loudbus_flat_chunk (LouDBusFlat *flat, guint chunk)
+{
+  gsize first;          // The first row of the chunk
+  gsize last;           // One past the last row
+  gsize r;              // One row
+  int c;                // One column
+  GVariant *row;        // The element in that row
+  GVariant *member;     // One member of the element
+  gboolean ok = TRUE;   // Is everything okay so far?
+
+  first = chunk * flat->chunk;
+  last = MIN (first + flat->chunk, flat->rows);
+  for (r = first; ok && (r < last); r++)
+    {
+      row = g_variant_get_child_value (flat->array, r);
+      if (! flat->tuple)
+        ok = loudbus_flat_cell (flat, 0, r, row);
+      else
+        for (c = 0; ok && (c < flat->width); c++)
+          {
+            member = g_variant_get_child_value (row, c);
+            ok = loudbus_flat_cell (flat, c, r, member);
+            g_variant_unref (member);
+          } // for each member
+      g_variant_unref (row);
+    } // for each row
+
+  return ok;
+} // loudbus_flat_chunk
+
+/**
+ * Claim and decode chunks until there are none left.  Run by the
+ * caller and by the workers.
+ */
+static void
+loudbus_flat_work (gpointer data, gpointer unused)
+{
+  LouDBusFlat *flat = data;     // The decode we're helping with
+  guint chunk;                  // The chunk we claimed
+  guint n = 0;                  // How many chunks we decoded
+
+  while ((chunk = g_atomic_int_add (&flat->next, 1)) < flat->chunks)
+    {
+      // Once a chunk fails, we only need to count the rest.
+      if (! g_atomic_int_get (&flat->failed)
+          && ! loudbus_flat_chunk (flat, chunk))
+        g_atomic_int_set (&flat->failed, TRUE);
+      n++;
+    } // while there are chunks left
+
+  if (n > 0)
+    {
+      g_mutex_lock (&flat->lock);
+      flat->finished += n;
+      if (flat->finished == flat->chunks)
+        g_cond_signal (&flat->done);
+      g_mutex_unlock (&flat->lock);
+    } // if we did anything
+} // loudbus_flat_work
+
+/**
+ * The function the pool runs.
+ */
+static void
+loudbus_flat_worker (gpointer data, gpointer unused)
+{
+  loudbus_flat_work (data, unused);
+  loudbus_flat_unref (data);
+} // loudbus_flat_worker
+
+/**
+ * Get the pool, creating it if need be.  We leave one processor for
+ * the caller, which also works.
+ */
+static GThreadPool *
+loudbus_flat_get_pool (void)
+{
+  static gsize ready = 0;       // Have we created the pool?
+  guint threads;                // How many threads it gets
+
+  if (g_once_init_enter (&ready))
+    {
+      threads = g_get_num_processors ();
+      threads = CLAMP (threads, 2, LOUDBUS_FLAT_MAX_THREADS + 1) - 1;
+      loudbus_flat_pool = g_thread_pool_new (loudbus_flat_worker, NULL,
+                                             threads, FALSE, NULL);
+      g_once_init_leave (&ready, 1);
+    } // if we haven't created the pool
+  return loudbus_flat_pool;
+} // loudbus_flat_get_pool
+
+
+// +---------------+--------------------------------------------------
+// | Flat Decoding |
+// +---------------+
+
+/**
+ * Decode a large array of strings, integers, doubles, or structs of
+ * those into columns, using the pool.  Returns NULL if the array is
+ * small, of some other type, or has a string that isn't valid UTF-8;
+ * the caller should then convert it one element at a time.  The
+ * caller releases the result with loudbus_flat_unref.
+ */
+LouDBusFlat *
+loudbus_flat_decode (GVariant *array)
+{
+  LouDBusFlat *flat;            // The decoded array
+  GThreadPool *pool;            // The workers
+  guint helpers;                // How many workers to ask for help
+  int c;                        // Counter variable
+  gsize rows;                   // The number of elements
+
+  rows = g_variant_n_children (array);
+  if (rows < LOUDBUS_FLAT_MIN_ROWS)
+    return NULL;
+
+  flat = g_new0 (LouDBusFlat, 1);
+  if (! loudbus_flat_shape (flat, g_variant_get_type_string (array)))
+    {
+      g_free (flat);
+      return NULL;
+    } // if we can't handle the type
+
+  flat->refcount = 1;
+  flat->array = g_variant_ref (array);
+  flat->rows = rows;
+  g_mutex_init (&flat->lock);
+  g_cond_init (&flat->done);
+
+  // Serialize the array now, so the workers all see the same data.
+  flat->data = g_variant_get_data (array);
+  flat->size = g_variant_get_size (array);
+
+  // Arrays of integers or doubles are already flat.
+  if (! flat->tuple && (flat->types[0] != 's'))
+    {
+      flat->columns[0] = (gpointer)
+        g_variant_get_fixed_array (array, &rows,
+                                   (flat->types[0] == 'i')
+                                   ? sizeof (gint32) : sizeof (gdouble));
+      return flat;
+    } // if the elements are fixed-size
+
+  for (c = 0; c < flat->width; c++)
+    {
+      switch (flat->types[c])
+        {
+          case 'i':
+            flat->columns[c] = g_new (gint32, rows);
+            break;
+          case 'd':
+            flat->columns[c] = g_new (gdouble, rows);
+            break;
+          default:
+            flat->columns[c] = g_new (gsize, 2 * rows);
+            break;
+        } // switch
+      flat->owned[c] = TRUE;
+    } // for each column
+
+  // Split the rows so that every thread gets a few chunks.
+  pool = loudbus_flat_get_pool ();
+  helpers = (pool == NULL) ? 0 : g_thread_pool_get_max_threads (pool);
+  flat->chunk = MAX (LOUDBUS_FLAT_CHUNK, rows / ((helpers + 1) * 4));
+  flat->chunks = (rows + flat->chunk - 1) / flat->chunk;
+  helpers = MIN (helpers, flat->chunks - 1);
+  while (helpers-- > 0)
+    g_thread_pool_push (pool, loudbus_flat_ref (flat), NULL);
+
+  // Do our share, then wait for the rest.
+  loudbus_flat_work (flat, NULL);
+  g_mutex_lock (&flat->lock);
+  while (flat->finished < flat->chunks)
+    g_cond_wait (&flat->done, &flat->lock);
+  g_mutex_unlock (&flat->lock);
+
+  if (flat->failed)
+    {
+      loudbus_flat_unref (flat);
+      return NULL;
+    } // if a string was bad
+  return flat;
+} // loudbus_flat_decode
+
+/**
+ * Set the number of threads that help with decoding, not counting
+ * the caller.  0 means the caller does all the work.
+ */
+void
+loudbus_flat_set_threads (int threads)
+{
+  GThreadPool *pool;    // The workers
+
+  pool = loudbus_flat_get_pool ();
+  if (pool != NULL)
+    g_thread_pool_set_max_threads (pool, MAX (0, threads), NULL);
+} // loudbus_flat_set_threads
+
+/**
+ * Release a decoded array.
+ */
+void
+loudbus_flat_unref (LouDBusFlat *flat)
+{
+  int c;        // Counter variable
+
+  if (! g_atomic_int_dec_and_test (&flat->refcount))
+    return;
+  for (c = 0; c < flat->width; c++)
+    if (flat->owned[c])
+      g_free (flat->columns[c]);
+  g_variant_unref (flat->array);
+  g_mutex_clear (&flat->lock);
+  g_cond_clear (&flat->done);
+  g_free (flat);
+} // loudbus_flat_unref
+
+/**
+ * Get the number of elements in a decoded array.
+ */
+gsize
+loudbus_flat_rows (LouDBusFlat *flat)
+{
+  return flat->rows;
+} // loudbus_flat_rows
+
+/**
+ * Get the types of the columns of a decoded array, one character
+ * ('i', 'd', or 's') per column.  If the elements are structs, each
+ * column is one member; otherwise, there is one column.
+ */
+const gchar *
+loudbus_flat_types (LouDBusFlat *flat, gboolean *tuple)
+{
+  *tuple = flat->tuple;
+  return flat->types;
+} // loudbus_flat_types
+
+/**
+ * Get one column of a decoded array: gint32s for 'i', gdoubles for
+ * 'd', and, for 's', two gsizes per row, giving the offset of the
+ * string in loudbus_flat_data and its length in bytes.
+ */
+gconstpointer
+loudbus_flat_column (LouDBusFlat *flat, int c)
+{
+  return flat->columns[c];
+} // loudbus_flat_column
+
+/**
+ * Get the data that the strings of a decoded array point into.
+ */
+const guchar *
+loudbus_flat_data (LouDBusFlat *flat, gsize *size)
+{
+  *size = flat->size;
+  return flat->data;
+} // loudbus_flat_data
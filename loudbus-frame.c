@@ -0,0 +1,313 @@
+/**
+ * loudbus-frame.c
+ *   Compressed frames for the byte arrays of A D-Bus Client for Racket.
+ *   This file uses only GLib, so services can build it into their own
+ *   code to decode what louDBus sends (and encode what it expects back).
+ *
+ * Copyright (c) 2012-15 Zarni Htet, Alexandra Greenberg, Mark Lewis,
+ * Evan Manuella, Samuel A. Rebelsky, Hart Russell, Mani Tiwaree,
+ * and Christine Tran.  All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the Lesser GNU General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+// +-------+----------------------------------------------------------
+// | Notes |
+// +-------+
+
+/*
+
+* For methods with the compression annotation (see loudbus-core.h),
+  every top-level "ay" parameter and result is a frame, whatever its
+  size.  A frame is an eight-byte header followed by the payload.
+
+    bytes 0-1   'L' 'Z'
+    byte  2     the codec: 0 for stored, 1 for raw deflate, 2 for
+                a shared-memory ring (see loudbus-ring.c)
+    byte  3     0 (reserved)
+    bytes 4-7   the length of the original bytes, little-endian
+
+* Small arrays, and arrays that don't shrink, are stored.  Always
+  framing means that the receiver never has to guess whether an
+  array is compressed.
+
+* We use deflate because GIO already provides it, so neither louDBus
+  nor the services need another library.  The codec byte leaves room
+  for others.
+
+ */
+
+
+// +---------+--------------------------------------------------------
+// | Headers |
+// +---------+
+
+#include <string.h>     // For memcpy
+
+#include <glib.h>       // For various glib stuff.
+#include <gio/gio.h>    // For the zlib converters.
+
+#include "loudbus-core.h"
+
+
+// +--------+---------------------------------------------------------
+// | Macros |
+// +--------+
+
+/**
+ * The deflate level.  The payloads we see compress well even at the
+ * fastest level, and we'd rather not hold up calls.
+ */
+#define LOUDBUS_FRAME_LEVEL 1
+
+
+// +-----------------+------------------------------------------------
+// | Local Utilities |
+// +-----------------+
+
+/**
+ * Run all of the input through a converter into a buffer of fixed
+ * size.  Returns FALSE (setting errorp) if the converter fails or the
+ * buffer is too small.
+ */
+static gboolean
+loudbus_frame_convert (GConverter *converter,
+                       const guchar *in, gsize inlen,
+                       guchar *out, gsize outlen, gsize *written,
+                       GError **errorp)
+{
+  GConverterResult status;      // The result of one step
+  gsize nread;                  // Bytes read in one step
+  gsize nwritten;               // Bytes written in one step
+
+  *written = 0;
+  do
+    {
+      if (*written == outlen)
+        {
+          g_set_error (errorp, G_IO_ERROR, G_IO_ERROR_NO_SPACE,
+                       "converted data does not fit");
+          return FALSE;
+        } // if we're out of space
+      status = g_converter_convert (converter, in, inlen,
+                                    out + *written, outlen - *written,
+                                    G_CONVERTER_INPUT_AT_END,
+                                    &nread, &nwritten, errorp);
+      if (status == G_CONVERTER_ERROR)
+        return FALSE;
+      in += nread;
+      inlen -= nread;
+      *written += nwritten;
+    } // do
+  while (status != G_CONVERTER_FINISHED);
+
+  return TRUE;
+} // loudbus_frame_convert
+
+
+// +---------------------+--------------------------------------------
+// | Compressed Payloads |
+// +---------------------+
+
+/**
+ * Frame an array of bytes, compressing it if it has at least
+ * threshold bytes and compression helps.  Returns a floating "ay".
+ */
+GVariant *
+loudbus_frame_encode (GVariant *bytes, gsize threshold)
+{
+  const guchar *data;           // The bytes
+  gsize n;                      // How many there are
+  guchar *frame;                // The frame we're building
+  gsize len = 0;                // The length of its payload
+  GConverter *compressor;       // Compresses the bytes
+
+  data = g_variant_get_fixed_array (bytes, &n, sizeof (guchar));
+
+  // The compressed form is only useful if it fits in the space the
+  // stored form would take, so we never need more than this.
+  frame = g_malloc (LOUDBUS_FRAME_HEADER + n);
+  frame[0] = 'L';
+  frame[1] = 'Z';
+  frame[2] = LOUDBUS_FRAME_STORED;
+  frame[3] = 0;
+  frame[4] = n & 0xff;
+  frame[5] = (n >> 8) & 0xff;
+  frame[6] = (n >> 16) & 0xff;
+  frame[7] = (n >> 24) & 0xff;
+
+  if ((n >= threshold) && (n > 0) && (n <= LOUDBUS_FRAME_MAX))
+    {
+      compressor = G_CONVERTER (g_zlib_compressor_new
+                                  (G_ZLIB_COMPRESSOR_FORMAT_RAW,
+                                   LOUDBUS_FRAME_LEVEL));
+      if (loudbus_frame_convert (compressor, data, n,
+                                 frame + LOUDBUS_FRAME_HEADER, n, &len,
+                                 NULL))
+        frame[2] = LOUDBUS_FRAME_DEFLATE;
+      g_object_unref (compressor);
+    } // if it's worth trying to compress
+
+  if (frame[2] == LOUDBUS_FRAME_STORED)
+    {
+      memcpy (frame + LOUDBUS_FRAME_HEADER, data, n);
+      len = n;
+    } // if we're storing the bytes
+
+  return g_variant_new_from_data (G_VARIANT_TYPE_BYTESTRING, frame,
+                                  LOUDBUS_FRAME_HEADER + len, TRUE,
+                                  g_free, frame);
+} // loudbus_frame_encode
+
+/**
+ * Get the array of bytes in a frame.  Returns a floating "ay", or
+ * NULL (setting errorp) if the frame is invalid.
+ */
+GVariant *
+loudbus_frame_decode (GVariant *framed, GError **errorp)
+{
+  const guchar *data;           // The frame
+  gsize n;                      // Its size
+  gsize len;                    // The size of the original bytes
+  guchar *bytes;                // The original bytes
+  gsize written;                // How many bytes we decompressed
+  GConverter *decompressor;     // Decompresses the bytes
+  gboolean ok;                  // Did decompression work?
+
+  data = g_variant_get_fixed_array (framed, &n, sizeof (guchar));
+  if ((n < LOUDBUS_FRAME_HEADER) || (data[0] != 'L') || (data[1] != 'Z')
+      || (data[3] != 0))
+    {
+      g_set_error (errorp, G_IO_ERROR, G_IO_ERROR_INVALID_DATA,
+                   "not a louDBus frame");
+      return NULL;
+    } // if it's not a frame
+  len = data[4] | (data[5] << 8) | (data[6] << 16) | ((gsize) data[7] << 24);
+
+  switch (data[2])
+    {
+      case LOUDBUS_FRAME_STORED:
+        if (n - LOUDBUS_FRAME_HEADER != len)
+          {
+            g_set_error (errorp, G_IO_ERROR, G_IO_ERROR_INVALID_DATA,
+                         "frame is %" G_GSIZE_FORMAT " bytes, expected %"
+                         G_GSIZE_FORMAT, n - LOUDBUS_FRAME_HEADER, len);
+            return NULL;
+          } // if the lengths don't match
+        // Share the bytes of the frame, rather than copying them.
+        return g_variant_new_from_data (G_VARIANT_TYPE_BYTESTRING,
+                                        data + LOUDBUS_FRAME_HEADER, len,
+                                        TRUE,
+                                        (GDestroyNotify) g_variant_unref,
+                                        g_variant_ref (framed));
+
+      case LOUDBUS_FRAME_DEFLATE:
+        // The header tells us exactly how much space we need, so a
+        // frame that decompresses to anything else is corrupt.
+        if (len > LOUDBUS_FRAME_MAX)
+          {
+            g_set_error (errorp, G_IO_ERROR, G_IO_ERROR_INVALID_DATA,
+                         "frame claims %" G_GSIZE_FORMAT " bytes, more "
+                         "than %d", len, LOUDBUS_FRAME_MAX);
+            return NULL;
+          } // if the length is absurd
+        bytes = g_try_malloc (MAX (len, 1));
+        if (bytes == NULL)
+          {
+            g_set_error (errorp, G_IO_ERROR, G_IO_ERROR_NO_SPACE,
+                         "no room to decompress %" G_GSIZE_FORMAT
+                         " bytes", len);
+            return NULL;
+          } // if (bytes == NULL)
+        decompressor = G_CONVERTER (g_zlib_decompressor_new
+                                      (G_ZLIB_COMPRESSOR_FORMAT_RAW));
+        ok = loudbus_frame_convert (decompressor,
+                                    data + LOUDBUS_FRAME_HEADER,
+                                    n - LOUDBUS_FRAME_HEADER,
+                                    bytes, len, &written, errorp);
+        g_object_unref (decompressor);
+        if (ok && (written != len))
+          {
+            g_set_error (errorp, G_IO_ERROR, G_IO_ERROR_INVALID_DATA,
+                         "frame decompressed to %" G_GSIZE_FORMAT
+                         " bytes, expected %" G_GSIZE_FORMAT, written, len);
+            ok = FALSE;
+          } // if the lengths don't match
+        if (! ok)
+          {
+            g_free (bytes);
+            return NULL;
+          } // if (! ok)
+        return g_variant_new_from_data (G_VARIANT_TYPE_BYTESTRING,
+                                        bytes, len, TRUE, g_free, bytes);
+
+      case LOUDBUS_FRAME_RING:
+        // loudbus_ring_tuple handles these before they get here.
+        g_set_error (errorp, G_IO_ERROR, G_IO_ERROR_NOT_SUPPORTED,
+                     "frame refers to a shared-memory ring, but there "
+                     "is none");
+        return NULL;
+
+      default:
+        g_set_error (errorp, G_IO_ERROR, G_IO_ERROR_NOT_SUPPORTED,
+                     "unknown codec %d in frame", data[2]);
+        return NULL;
+    } // switch
+} // loudbus_frame_decode
+
+/**
+ * Encode (or decode) each top-level byte array in a tuple, leaving
+ * the other members alone.  Returns a new reference to the converted
+ * tuple, or NULL (setting errorp) if some frame is invalid.
+ */
+GVariant *
+loudbus_frame_tuple (GVariant *tuple, gboolean encode, GError **errorp)
+{
+  GVariant **children;          // The members of the new tuple
+  GVariant *child;              // One member of the old tuple
+  GVariant *result;             // The new tuple
+  gsize n;                      // The number of members
+  gsize i;                      // Counter variable
+
+  n = g_variant_n_children (tuple);
+  children = g_new (GVariant *, MAX (n, 1));
+  for (i = 0; i < n; i++)
+    {
+      child = g_variant_get_child_value (tuple, i);
+      if (! g_variant_is_of_type (child, G_VARIANT_TYPE_BYTESTRING))
+        children[i] = child;
+      else
+        {
+          children[i] = encode
+                        ? loudbus_frame_encode (child, LOUDBUS_FRAME_THRESHOLD)
+                        : loudbus_frame_decode (child, errorp);
+          g_variant_unref (child);
+          if (children[i] == NULL)
+            {
+              while (i > 0)
+                g_variant_unref (children[--i]);
+              g_free (children);
+              return NULL;
+            } // if we could not decode the frame
+          g_variant_ref_sink (children[i]);
+        } // if it's a byte array
+    } // for each member
+
+  result = g_variant_ref_sink (g_variant_new_tuple (children, n));
+  for (i = 0; i < n; i++)
+    g_variant_unref (children[i]);
+  g_free (children);
+  return result;
+} // loudbus_frame_tuple
@@ -0,0 +1,340 @@
+/**
+ * loudbus-health.c
+ *   Health probes for A D-Bus Client for Racket.  A probe pings a
+ *   service now and then and keeps track of how quickly it answers,
+ *   so that clients can steer work away from a service that's bogged
+ *   down before their calls start timing out.
+ *
+ * Copyright (c) 2012-15 Zarni Htet, Alexandra Greenberg, Mark Lewis,
+ * Evan Manuella, Samuel A. Rebelsky, Hart Russell, Mani Tiwaree,
+ * and Christine Tran.  All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the Lesser GNU General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+// +-------+----------------------------------------------------------
+// | Notes |
+// +-------+
+
+/*
+
+* Probes run on the worker thread of the scheduler (loudbus-async.c),
+  so they keep going while Racket is busy.  They call
+  org.freedesktop.DBus.Peer.Ping, which GDBus (and libdbus) services
+  answer for any object without involving the service's own code;
+  a slow Ping therefore means a busy main loop or a crowded socket,
+  which is just what we want to know about.
+
+* We keep two averages of the latency: a quick one that follows
+  recent pings and a slow one that serves as the baseline.  A service
+  is degraded when the quick average climbs well above the baseline,
+  or when pings fail or time out.  While it's degraded, we stop
+  moving the baseline, so that a long spike doesn't come to look
+  normal.
+
+* A timed-out ping counts as taking the whole timeout.
+
+ */
+
+
+// +---------+--------------------------------------------------------
+// | Headers |
+// +---------+
+
+#include <glib.h>       // For various glib stuff.
+#include <gio/gio.h>    // For the GDBus functions.
+
+#include "loudbus-core.h"
+
+
+// +--------+---------------------------------------------------------
+// | Macros |
+// +--------+
+
+/**
+ * How quickly the two averages follow new pings.
+ */
+#define LOUDBUS_PROBE_ALPHA_QUICK 0.3
+#define LOUDBUS_PROBE_ALPHA_SLOW 0.05
+
+/**
+ * A service is degraded when the quick average exceeds the baseline
+ * by this factor (and by at least LOUDBUS_PROBE_SPIKE_MIN_MS, so that
+ * services that answer in microseconds don't flap), or after this
+ * many failures in a row.  It recovers when the quick average falls
+ * back below LOUDBUS_PROBE_RECOVER times the baseline.
+ */
+#define LOUDBUS_PROBE_SPIKE 3.0
+#define LOUDBUS_PROBE_SPIKE_MIN_MS 5.0
+#define LOUDBUS_PROBE_FAILURES 2
+#define LOUDBUS_PROBE_RECOVER 1.5
+
+
+// +-------+----------------------------------------------------------
+// | Types |
+// +-------+
+
+/**
+ * One probe.  Shared between the table of probes, the timer, and a
+ * ping in flight, each of which holds a reference.  The statistics are
+ * protected by loudbus_probes_lock.
+ */
+struct LouDBusProbe
+  {
+    gint refcount;              // The number of references
+    gchar *service;             // The service we ping
+    GDBusConnection *connection;// The connection we ping it on
+    GSource *timer;             // Sends the pings
+    int timeout;                // How long a ping may take (ms)
+    gboolean pinging;           // Is a ping in flight?
+    gint64 sent;                // When it was sent (monotonic time)
+    LouDBusProbeStats stats;    // What we've learned
+  };
+typedef struct LouDBusProbe LouDBusProbe;
+
+
+// +---------+--------------------------------------------------------
+// | Globals |
+// +---------+
+
+/**
+ * The probes, indexed by service name.
+ */
+static GHashTable *loudbus_probes = NULL;
+
+/**
+ * Protects loudbus_probes and the statistics of the probes.
+ */
+static GMutex loudbus_probes_lock;
+
+
+// +-----------------+------------------------------------------------
+// | Local Utilities |
+// +-----------------+
+
+static LouDBusProbe *
+loudbus_probe_ref (LouDBusProbe *probe)
+{
+  g_atomic_int_inc (&probe->refcount);
+  return probe;
+} // loudbus_probe_ref
+
+static void
+loudbus_probe_unref (LouDBusProbe *probe)
+{
+  if (! g_atomic_int_dec_and_test (&probe->refcount))
+    return;
+  g_object_unref (probe->connection);
+  g_free (probe->service);
+  g_free (probe);
+} // loudbus_probe_unref
+
+/**
+ * Record the result of a ping.  Called with the lock held.
+ */
+static void
+loudbus_probe_record (LouDBusProbe *probe, gdouble ms, gboolean ok)
+{
+  LouDBusProbeStats *stats = &probe->stats;
+  gdouble spike;        // The average that counts as a spike
+
+  stats->pings++;
+  stats->last_ms = ms;
+  if (ok)
+    stats->failures_in_row = 0;
+  else
+    {
+      stats->failures++;
+      stats->failures_in_row++;
+    } // if the ping failed
+
+  // The first ping sets both averages.
+  if (stats->pings == 1)
+    {
+      stats->latency_ms = ms;
+      stats->baseline_ms = ms;
+    } // if it's the first ping
+  else
+    {
+      stats->latency_ms += LOUDBUS_PROBE_ALPHA_QUICK
+                           * (ms - stats->latency_ms);
+      if (! stats->degraded)
+        stats->baseline_ms += LOUDBUS_PROBE_ALPHA_SLOW
+                              * (ms - stats->baseline_ms);
+    } // if it's a later ping
+
+  spike = MAX (stats->baseline_ms * LOUDBUS_PROBE_SPIKE,
+               stats->baseline_ms + LOUDBUS_PROBE_SPIKE_MIN_MS);
+  if ((stats->failures_in_row >= LOUDBUS_PROBE_FAILURES)
+      || (stats->latency_ms > spike))
+    stats->degraded = TRUE;
+  else if (stats->degraded && ok
+           && (stats->latency_ms
+               < stats->baseline_ms * LOUDBUS_PROBE_RECOVER))
+    stats->degraded = FALSE;
+} // loudbus_probe_record
+
+/**
+ * Handle the reply to a ping.  Runs on the worker.
+ */
+static void
+loudbus_probe_pong (GObject *source, GAsyncResult *res, gpointer data)
+{
+  LouDBusProbe *probe = data;   // The probe that pinged
+  GVariant *result;             // The (empty) result
+  GError *error = NULL;         // Why the ping failed
+  gdouble ms;                   // How long it took
+
+  result = g_dbus_connection_call_finish (G_DBUS_CONNECTION (source),
+                                          res, &error);
+  ms = (g_get_monotonic_time () - probe->sent) / 1000.0;
+
+  g_mutex_lock (&loudbus_probes_lock);
+  probe->pinging = FALSE;
+  if (result != NULL)
+    loudbus_probe_record (probe, ms, TRUE);
+  else if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_TIMED_OUT))
+    loudbus_probe_record (probe, probe->timeout, FALSE);
+  else
+    loudbus_probe_record (probe, ms, FALSE);
+  g_mutex_unlock (&loudbus_probes_lock);
+
+  if (result != NULL)
+    g_variant_unref (result);
+  g_clear_error (&error);
+  loudbus_probe_unref (probe);
+} // loudbus_probe_pong
+
+/**
+ * Send a ping, unless the last one is still out.  Runs on the worker.
+ */
+static gboolean
+loudbus_probe_ping (gpointer data)
+{
+  LouDBusProbe *probe = data;   // The probe
+
+  g_mutex_lock (&loudbus_probes_lock);
+  if (probe->pinging)
+    {
+      g_mutex_unlock (&loudbus_probes_lock);
+      return G_SOURCE_CONTINUE;
+    } // if the last ping is still out
+  probe->pinging = TRUE;
+  probe->sent = g_get_monotonic_time ();
+  g_mutex_unlock (&loudbus_probes_lock);
+
+  // Pinging a service that isn't running shouldn't start it.
+  g_dbus_connection_call (probe->connection,
+                          probe->service,
+                          "/",
+                          "org.freedesktop.DBus.Peer",
+                          "Ping",
+                          NULL,
+                          NULL,
+                          G_DBUS_CALL_FLAGS_NO_AUTO_START,
+                          probe->timeout,
+                          NULL,
+                          loudbus_probe_pong,
+                          loudbus_probe_ref (probe));
+  return G_SOURCE_CONTINUE;
+} // loudbus_probe_ping
+
+
+// +---------------+--------------------------------------------------
+// | Health Probes |
+// +---------------+
+
+/**
+ * Start probing a service every interval milliseconds, allowing each
+ * ping timeout milliseconds.  If the service is already being probed,
+ * we start over with the new settings.  Returns FALSE (setting
+ * errorp) if we can't reach the bus.
+ */
+gboolean
+loudbus_probe_start (const gchar *service, int interval, int timeout,
+                     GError **errorp)
+{
+  GDBusConnection *connection;  // The connection to the bus
+  LouDBusProbe *probe;          // The new probe
+
+  connection = g_bus_get_sync (G_BUS_TYPE_SESSION, NULL, errorp);
+  if (connection == NULL)
+    return FALSE;
+
+  probe = g_new0 (LouDBusProbe, 1);
+  probe->refcount = 1;          // For the table
+  probe->service = g_strdup (service);
+  probe->connection = connection;
+  probe->timeout = MAX (1, timeout);
+  probe->timer = g_timeout_source_new (MAX (1, interval));
+  g_source_set_callback (probe->timer, loudbus_probe_ping,
+                         loudbus_probe_ref (probe),
+                         (GDestroyNotify) loudbus_probe_unref);
+
+  loudbus_probe_stop (service);
+  g_mutex_lock (&loudbus_probes_lock);
+  if (loudbus_probes == NULL)
+    loudbus_probes = g_hash_table_new (g_str_hash, g_str_equal);
+  g_hash_table_insert (loudbus_probes, probe->service, probe);
+  g_mutex_unlock (&loudbus_probes_lock);
+
+  g_source_attach (probe->timer, loudbus_worker_context ());
+  return TRUE;
+} // loudbus_probe_start
+
+/**
+ * Stop probing a service.  (A ping in flight still finishes, but no
+ * one will see its result.)
+ */
+void
+loudbus_probe_stop (const gchar *service)
+{
+  LouDBusProbe *probe = NULL;   // The probe
+
+  g_mutex_lock (&loudbus_probes_lock);
+  if (loudbus_probes != NULL)
+    {
+      probe = g_hash_table_lookup (loudbus_probes, service);
+      if (probe != NULL)
+        g_hash_table_remove (loudbus_probes, service);
+    } // if there are probes
+  g_mutex_unlock (&loudbus_probes_lock);
+
+  if (probe != NULL)
+    {
+      g_source_destroy (probe->timer);
+      g_source_unref (probe->timer);
+      loudbus_probe_unref (probe);
+    } // if (probe != NULL)
+} // loudbus_probe_stop
+
+/**
+ * Get what a probe has learned about a service.  Returns FALSE if
+ * we aren't probing the service.
+ */
+gboolean
+loudbus_probe_stats (const gchar *service, LouDBusProbeStats *stats)
+{
+  LouDBusProbe *probe = NULL;   // The probe
+
+  g_mutex_lock (&loudbus_probes_lock);
+  if (loudbus_probes != NULL)
+    probe = g_hash_table_lookup (loudbus_probes, service);
+  if (probe != NULL)
+    *stats = probe->stats;
+  g_mutex_unlock (&loudbus_probes_lock);
+
+  return probe != NULL;
+} // loudbus_probe_stats
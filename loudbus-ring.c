@@ -0,0 +1,878 @@
+/**
+ * loudbus-ring.c
+ *   Shared-memory rings for the byte arrays of A D-Bus Client for
+ *   Racket.  For a steady stream of large byte arrays (frames, tiles,
+ *   and the like), a client and a cooperating service can share a
+ *   ring of memory, so that the bytes skip the bus and only a small
+ *   descriptor travels in the call.  This file uses only GLib and
+ *   Linux system calls, so services can build it into their own code,
+ *   as they do loudbus-frame.c.
+ *
+ * Copyright (c) 2012-15 Zarni Htet, Alexandra Greenberg, Mark Lewis,
+ * Evan Manuella, Samuel A. Rebelsky, Hart Russell, Mani Tiwaree,
+ * and Christine Tran.  All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the Lesser GNU General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+// +-------+----------------------------------------------------------
+// | Notes |
+// +-------+
+
+/*
+
+* The client makes the ring: a sealed memfd with a header page and
+  two lanes of the same size, one for bytes going to the service and
+  one for bytes coming back.  It passes the memfd to the Attach method
+  of LOUDBUS_RING_INTERFACE, on the object it calls, and gets back the
+  service's number for the ring.  Detach gives the ring back.
+
+* Methods that use the ring are framed (see loudbus-frame.c).  A byte
+  array of at least LOUDBUS_RING_THRESHOLD bytes goes into a record in
+  the sender's lane, and the frame carries only where it is:
+
+    bytes 0-7   the frame header, with codec 2 and the length
+    bytes 8-11  the number of the ring, little-endian
+    bytes 12-15 0 (reserved)
+    bytes 16-23 the position of the record in the lane, little-endian
+
+  Smaller arrays, and arrays that don't fit in the space left, go in
+  the frame as usual, so a full ring slows things down but never
+  stops them.
+
+* Each lane has one producer and one consumer.  In the header page,
+  the producer publishes how far it has written (the head) and the
+  consumer how far it has read (the tail).  The producer only reuses
+  space behind the tail, and the consumer only looks at records
+  between the tail and the head, so it never mistakes old bytes for
+  a record.  A record is a
+  16-byte header (state and length) and the bytes, padded to 16.  A
+  record that won't fit before the end of the lane is preceded by a
+  skip record that fills the rest.
+
+* The consumer copies the bytes out, marks the record done, and moves
+  the tail past every done record at the front of the lane, so
+  records may be taken in any order.  We don't need doorbells: the
+  call that carries the descriptor is the signal that a record is
+  ready, and its reply is the signal that the service has read it.
+
+* When we drop a call before sending it (because it's too big, say,
+  or its deadline passed in the queue), we give its records back.
+  The newest record just comes off the head; an older one is marked
+  done, as though the service had taken it.  A record whose call
+  never reaches the service for other reasons (because the service
+  went away, say) is never taken, so the space behind it isn't
+  reused.  Arrays then go in their frames until the ring is reopened.
+
+* The memfd is sealed against shrinking, so a service can map it
+  without fear that the client will truncate it underneath.
+
+ */
+
+
+// +---------+--------------------------------------------------------
+// | Headers |
+// +---------+
+
+#define _GNU_SOURCE     // For memfd_create and the file seals
+
+#include <errno.h>      // For errno
+#include <fcntl.h>      // For fcntl and the seals
+#include <string.h>     // For memcpy
+#include <sys/mman.h>   // For memfd_create, mmap, and munmap
+#include <sys/stat.h>   // For fstat
+#include <unistd.h>     // For ftruncate and close
+
+#include <glib.h>       // For various glib stuff.
+#include <gio/gio.h>    // For the I/O errors.
+
+#include "loudbus-core.h"
+
+
+// +--------+---------------------------------------------------------
+// | Macros |
+// +--------+
+
+/**
+ * Identifies the header page of a ring, and the version of its
+ * layout.
+ */
+#define LOUDBUS_RING_MAGIC 0x4c52494e   // "LRIN"
+#define LOUDBUS_RING_VERSION 1
+
+/**
+ * The size of the header page.  The lanes follow it.
+ */
+#define LOUDBUS_RING_HEADER 4096
+
+/**
+ * The limits on the size of a lane.  (The frame header has room for
+ * 32-bit lengths only.)
+ */
+#define LOUDBUS_RING_MIN (64 * 1024)
+#define LOUDBUS_RING_MAX (1024 * 1024 * 1024)
+
+/**
+ * The lanes, named for the side that writes into them.
+ */
+#define LOUDBUS_RING_CLIENT 0
+#define LOUDBUS_RING_SERVICE 1
+
+/**
+ * The states of a record.
+ */
+#define LOUDBUS_RECORD_FREE 0   // Nothing there (or already passed)
+#define LOUDBUS_RECORD_FULL 1   // Written, but not yet taken
+#define LOUDBUS_RECORD_DONE 2   // Taken
+#define LOUDBUS_RECORD_SKIP 3   // Padding to the end of the lane
+
+/**
+ * The size of a record with n bytes.
+ */
+#define LOUDBUS_RECORD_SIZE(n) \
+  (sizeof (LouDBusRecord) + (((n) + 15) & ~((guint64) 15)))
+
+/**
+ * The size of the payload of a ring frame.
+ */
+#define LOUDBUS_RING_PAYLOAD 16
+
+
+// +-------+----------------------------------------------------------
+// | Types |
+// +-------+
+
+/**
+ * The header page of a ring, which both sides map.  Each head and
+ * tail gets a cache line to itself, since different sides write them.
+ * (Only head[lane][0] and tail[lane][0] are used.)
+ */
+struct LouDBusRingShared
+  {
+    guint32 magic;              // LOUDBUS_RING_MAGIC
+    guint32 version;            // LOUDBUS_RING_VERSION
+    guint64 capacity;           // The size of each lane
+    guint64 pad[6];             // Fills out the first cache line
+    guint64 head[2][8];         // How far the producer of each lane
+                                // has written
+    guint64 tail[2][8];         // How far the consumer of each lane
+                                // has read
+  };
+typedef struct LouDBusRingShared LouDBusRingShared;
+
+/**
+ * The header of one record in a lane.
+ */
+struct LouDBusRecord
+  {
+    guint32 state;              // LOUDBUS_RECORD_*
+    guint32 reserved;           // 0
+    guint64 length;             // The number of bytes that follow
+  };
+typedef struct LouDBusRecord LouDBusRecord;
+
+/**
+ * One side's view of a ring.
+ */
+struct LouDBusRing
+  {
+    gint refcount;              // The number of references
+    GMutex lock;                // Protects head and the records we take
+                                // (calls and replies can come from
+                                // different threads)
+    guchar *map;                // The mapping of the whole ring
+    gsize size;                 // Its size
+    LouDBusRingShared *shared;  // The header page
+    guint64 capacity;           // The size of each lane
+    int lane;                   // The lane we write into
+    guint64 head;               // How far we've written into it (our
+                                // copy of the shared head)
+    guint32 id;                 // The service's number for the ring
+    int fd;                     // The memfd, until we hand it over
+  };
+
+
+// +-----------------+------------------------------------------------
+// | Local Utilities |
+// +-----------------+
+
+/**
+ * Get the record at a position in a lane.
+ */
+static LouDBusRecord *
+loudbus_ring_record (LouDBusRing *ring, int lane, guint64 position)
+{
+  return (LouDBusRecord *) (ring->map + LOUDBUS_RING_HEADER
+                            + lane * ring->capacity
+                            + (position & (ring->capacity - 1)));
+} // loudbus_ring_record
+
+/**
+ * Map a ring and check its header.  Takes over fd.  Returns NULL
+ * (setting errorp) if fd doesn't hold a ring.
+ */
+static LouDBusRing *
+loudbus_ring_map (int fd, GError **errorp)
+{
+  LouDBusRing *ring;            // The ring we return
+  struct stat info;             // Information on the file
+  guchar *map;                  // The mapping
+
+  if (fstat (fd, &info) < 0)
+    {
+      g_set_error (errorp, G_IO_ERROR, g_io_error_from_errno (errno),
+                   "could not examine the ring: %s", g_strerror (errno));
+      close (fd);
+      return NULL;
+    } // if we can't look at the file
+  if (info.st_size < LOUDBUS_RING_HEADER + 2 * LOUDBUS_RING_MIN)
+    {
+      g_set_error (errorp, G_IO_ERROR, G_IO_ERROR_INVALID_DATA,
+                   "the ring is too small");
+      close (fd);
+      return NULL;
+    } // if the file is too small
+
+  map = mmap (NULL, info.st_size, PROT_READ | PROT_WRITE, MAP_SHARED,
+              fd, 0);
+  close (fd);
+  if (map == MAP_FAILED)
+    {
+      g_set_error (errorp, G_IO_ERROR, g_io_error_from_errno (errno),
+                   "could not map the ring: %s", g_strerror (errno));
+      return NULL;
+    } // if (map == MAP_FAILED)
+
+  ring = g_new0 (LouDBusRing, 1);
+  ring->refcount = 1;
+  g_mutex_init (&ring->lock);
+  ring->map = map;
+  ring->size = info.st_size;
+  ring->fd = -1;
+  ring->shared = (LouDBusRingShared *) map;
+  ring->capacity = (info.st_size - LOUDBUS_RING_HEADER) / 2;
+  return ring;
+} // loudbus_ring_map
+
+/**
+ * Put n bytes into a new record in our lane, and set *position to
+ * where it is.  Returns FALSE if there isn't room.  The caller holds
+ * the lock.
+ */
+static gboolean
+loudbus_ring_put (LouDBusRing *ring, const guchar *bytes, gsize n,
+                  guint64 *position)
+{
+  LouDBusRecord *record;        // The record we write
+  guint64 tail;                 // How far the consumer has read
+  guint64 offset;               // Where the head is in the lane
+  guint64 size;                 // The size of the record
+  guint64 skip;                 // Space we skip at the end of the lane
+
+  size = LOUDBUS_RECORD_SIZE (n);
+  if (size > ring->capacity)
+    return FALSE;
+  tail = __atomic_load_n (&ring->shared->tail[ring->lane][0],
+                          __ATOMIC_ACQUIRE);
+  offset = ring->head & (ring->capacity - 1);
+  skip = (offset + size > ring->capacity) ? ring->capacity - offset : 0;
+  if (ring->head + skip + size - tail > ring->capacity)
+    return FALSE;
+
+  if (skip > 0)
+    {
+      record = loudbus_ring_record (ring, ring->lane, ring->head);
+      record->reserved = 0;
+      record->length = skip - sizeof (LouDBusRecord);
+      __atomic_store_n (&record->state, LOUDBUS_RECORD_SKIP,
+                        __ATOMIC_RELEASE);
+      ring->head += skip;
+    } // if we need to wrap around
+
+  record = loudbus_ring_record (ring, ring->lane, ring->head);
+  memcpy (record + 1, bytes, n);
+  record->reserved = 0;
+  record->length = n;
+  __atomic_store_n (&record->state, LOUDBUS_RECORD_FULL, __ATOMIC_RELEASE);
+  *position = ring->head;
+  ring->head += size;
+  __atomic_store_n (&ring->shared->head[ring->lane][0], ring->head,
+                    __ATOMIC_RELEASE);
+  return TRUE;
+} // loudbus_ring_put
+
+/**
+ * Find the record of n bytes at a position in the other side's lane.
+ * Returns NULL (setting errorp) if there's no such record.  The
+ * caller holds the lock.
+ */
+static LouDBusRecord *
+loudbus_ring_find (LouDBusRing *ring, guint64 position, gsize n,
+                   GError **errorp)
+{
+  LouDBusRecord *record;        // The record we find
+  guint64 tail;                 // The tail
+  guint64 head;                 // The head
+  int lane;                     // The lane we read from
+
+  lane = 1 - ring->lane;
+  tail = ring->shared->tail[lane][0];
+  head = __atomic_load_n (&ring->shared->head[lane][0], __ATOMIC_ACQUIRE);
+  if (((position & 15) != 0)
+      || (position - tail >= head - tail)
+      || ((position & (ring->capacity - 1)) + LOUDBUS_RECORD_SIZE (n)
+          > ring->capacity))
+    {
+      g_set_error (errorp, G_IO_ERROR, G_IO_ERROR_INVALID_DATA,
+                   "ring position %" G_GUINT64_FORMAT " is out of range",
+                   position);
+      return NULL;
+    } // if the position is bad
+  record = loudbus_ring_record (ring, lane, position);
+  if ((__atomic_load_n (&record->state, __ATOMIC_ACQUIRE)
+       != LOUDBUS_RECORD_FULL)
+      || (record->length != n))
+    {
+      g_set_error (errorp, G_IO_ERROR, G_IO_ERROR_INVALID_DATA,
+                   "no record of %" G_GSIZE_FORMAT " bytes at ring "
+                   "position %" G_GUINT64_FORMAT, n, position);
+      return NULL;
+    } // if there's no such record
+  return record;
+} // loudbus_ring_find
+
+/**
+ * Mark a record in the other side's lane done, and give back the
+ * space of the records at the front of the lane that are done.  The
+ * caller holds the lock.
+ */
+static void
+loudbus_ring_pass (LouDBusRing *ring, LouDBusRecord *record)
+{
+  guint64 *tailp;               // Where we publish the tail
+  guint64 tail;                 // The tail
+  guint64 head;                 // The head
+  guint64 size;                 // The size of one record
+  guint32 state;                // The state of one record
+  int lane;                     // The lane we read from
+
+  __atomic_store_n (&record->state, LOUDBUS_RECORD_DONE, __ATOMIC_RELEASE);
+
+  lane = 1 - ring->lane;
+  tailp = &ring->shared->tail[lane][0];
+  tail = *tailp;
+  head = __atomic_load_n (&ring->shared->head[lane][0], __ATOMIC_ACQUIRE);
+
+  // Move the tail past the records at the front that are done.
+  while (tail != head)
+    {
+      record = loudbus_ring_record (ring, lane, tail);
+      state = __atomic_load_n (&record->state, __ATOMIC_ACQUIRE);
+      if (state == LOUDBUS_RECORD_DONE)
+        size = LOUDBUS_RECORD_SIZE (record->length);
+      else if (state == LOUDBUS_RECORD_SKIP)
+        size = sizeof (LouDBusRecord) + record->length;
+      else
+        break;
+      if ((size > head - tail) || ((size & 15) != 0))
+        break;
+      record->state = LOUDBUS_RECORD_FREE;
+      tail += size;
+    } // while there are records to look at
+  __atomic_store_n (tailp, tail, __ATOMIC_RELEASE);
+} // loudbus_ring_pass
+
+/**
+ * Copy the n bytes of the record at a position in the other side's
+ * lane, and give the space back.  Returns a floating "ay", or NULL
+ * (setting errorp) if there's no such record.  The caller holds the
+ * lock.
+ */
+static GVariant *
+loudbus_ring_take (LouDBusRing *ring, guint64 position, gsize n,
+                   GError **errorp)
+{
+  LouDBusRecord *record;        // The record we take
+  guchar *bytes;                // A copy of the bytes
+
+  record = loudbus_ring_find (ring, position, n, errorp);
+  if (record == NULL)
+    return NULL;
+  bytes = g_malloc (MAX (n, 1));
+  memcpy (bytes, record + 1, n);
+  loudbus_ring_pass (ring, record);
+  return g_variant_new_from_data (G_VARIANT_TYPE_BYTESTRING, bytes, n,
+                                  TRUE, g_free, bytes);
+} // loudbus_ring_take
+
+/**
+ * Give back the record of n bytes at a position in our lane, whose
+ * call was never sent.  The caller holds the lock.
+ */
+static void
+loudbus_ring_give_back (LouDBusRing *ring, guint64 position, gsize n)
+{
+  LouDBusRecord *record;        // The record we give back
+  guint64 tail;                 // How far the consumer has read
+
+  tail = __atomic_load_n (&ring->shared->tail[ring->lane][0],
+                          __ATOMIC_ACQUIRE);
+  if (((position & 15) != 0)
+      || (position - tail >= ring->head - tail))
+    return;
+  record = loudbus_ring_record (ring, ring->lane, position);
+  if ((__atomic_load_n (&record->state, __ATOMIC_ACQUIRE)
+       != LOUDBUS_RECORD_FULL)
+      || (record->length != n))
+    return;
+
+  // The consumer never passes a free record, so we can pull the head
+  // back over the newest one.  Older ones wait for the consumer.
+  if (position + LOUDBUS_RECORD_SIZE (n) == ring->head)
+    {
+      __atomic_store_n (&record->state, LOUDBUS_RECORD_FREE,
+                        __ATOMIC_RELEASE);
+      ring->head = position;
+      __atomic_store_n (&ring->shared->head[ring->lane][0], ring->head,
+                        __ATOMIC_RELEASE);
+    } // if it's the newest record
+  else
+    __atomic_store_n (&record->state, LOUDBUS_RECORD_DONE,
+                      __ATOMIC_RELEASE);
+} // loudbus_ring_give_back
+
+/**
+ * Read a little-endian number of len bytes.
+ */
+static guint64
+loudbus_ring_get_le (const guchar *data, int len)
+{
+  guint64 value = 0;    // The number
+  int i;                // Counter variable
+
+  for (i = len - 1; i >= 0; i--)
+    value = (value << 8) | data[i];
+  return value;
+} // loudbus_ring_get_le
+
+/**
+ * Write a little-endian number into len bytes.
+ */
+static void
+loudbus_ring_set_le (guchar *data, int len, guint64 value)
+{
+  int i;                // Counter variable
+
+  for (i = 0; i < len; i++)
+    {
+      data[i] = value & 0xff;
+      value >>= 8;
+    } // for each byte
+} // loudbus_ring_set_le
+
+/**
+ * Determine whether a byte array is a ring frame.
+ */
+static gboolean
+loudbus_ring_frame_p (const guchar *data, gsize n)
+{
+  return (n == LOUDBUS_FRAME_HEADER + LOUDBUS_RING_PAYLOAD)
+         && (data[0] == 'L') && (data[1] == 'Z')
+         && (data[2] == LOUDBUS_FRAME_RING) && (data[3] == 0);
+} // loudbus_ring_frame_p
+
+/**
+ * Frame a byte array, putting it in the ring if there is one, it's
+ * big enough, and it fits.  Otherwise, it goes in the frame (see
+ * loudbus_frame_encode).  Returns a floating "ay".
+ */
+static GVariant *
+loudbus_ring_encode (LouDBusRing *ring, GVariant *bytes, gsize threshold)
+{
+  const guchar *data;           // The bytes
+  gsize n;                      // How many there are
+  guint64 position;             // Where they went in the ring
+  guchar *frame;                // The frame we're building
+  gboolean put;                 // Did they go in the ring?
+
+  data = g_variant_get_fixed_array (bytes, &n, sizeof (guchar));
+  if ((ring == NULL) || (n < LOUDBUS_RING_THRESHOLD))
+    return loudbus_frame_encode (bytes, threshold);
+
+  g_mutex_lock (&ring->lock);
+  put = loudbus_ring_put (ring, data, n, &position);
+  g_mutex_unlock (&ring->lock);
+  if (! put)
+    return loudbus_frame_encode (bytes, threshold);
+
+  frame = g_malloc0 (LOUDBUS_FRAME_HEADER + LOUDBUS_RING_PAYLOAD);
+  frame[0] = 'L';
+  frame[1] = 'Z';
+  frame[2] = LOUDBUS_FRAME_RING;
+  loudbus_ring_set_le (frame + 4, 4, n);
+  loudbus_ring_set_le (frame + LOUDBUS_FRAME_HEADER, 4, ring->id);
+  loudbus_ring_set_le (frame + LOUDBUS_FRAME_HEADER + 8, 8, position);
+  return g_variant_new_from_data (G_VARIANT_TYPE_BYTESTRING, frame,
+                                  LOUDBUS_FRAME_HEADER
+                                    + LOUDBUS_RING_PAYLOAD,
+                                  TRUE, g_free, frame);
+} // loudbus_ring_encode
+
+/**
+ * Get the byte array in a frame, taking it from the ring if that's
+ * where it is.  Returns a floating "ay", or NULL (setting errorp) if
+ * the frame is invalid.
+ */
+static GVariant *
+loudbus_ring_decode (LouDBusRing *ring, GVariant *framed, GError **errorp)
+{
+  const guchar *data;           // The frame
+  gsize n;                      // Its size
+  GVariant *bytes;              // The bytes in the ring
+
+  data = g_variant_get_fixed_array (framed, &n, sizeof (guchar));
+  if (! loudbus_ring_frame_p (data, n))
+    return loudbus_frame_decode (framed, errorp);
+
+  if ((ring == NULL)
+      || (loudbus_ring_get_le (data + LOUDBUS_FRAME_HEADER, 4) != ring->id))
+    {
+      g_set_error (errorp, G_IO_ERROR, G_IO_ERROR_INVALID_DATA,
+                   "frame refers to ring %u, which we don't have",
+                   (guint) loudbus_ring_get_le (data + LOUDBUS_FRAME_HEADER,
+                                                4));
+      return NULL;
+    } // if it's the wrong ring
+  g_mutex_lock (&ring->lock);
+  bytes = loudbus_ring_take (ring,
+                             loudbus_ring_get_le (data + LOUDBUS_FRAME_HEADER
+                                                    + 8, 8),
+                             loudbus_ring_get_le (data + 4, 4),
+                             errorp);
+  g_mutex_unlock (&ring->lock);
+  return bytes;
+} // loudbus_ring_decode
+
+
+// +---------------------+--------------------------------------------
+// | Shared-Memory Rings |
+// +---------------------+
+
+/**
+ * Make a new ring, with lanes of capacity bytes (a power of two), for
+ * a client.  Returns NULL (setting errorp) if we can't.
+ */
+LouDBusRing *
+loudbus_ring_new (gsize capacity, GError **errorp)
+{
+  LouDBusRing *ring;            // The ring we return
+  gsize size;                   // The size of the whole ring
+  int fd;                       // The memfd
+  int dup;                      // Another descriptor for it
+
+  if ((capacity < LOUDBUS_RING_MIN) || (capacity > LOUDBUS_RING_MAX)
+      || ((capacity & (capacity - 1)) != 0))
+    {
+      g_set_error (errorp, G_IO_ERROR, G_IO_ERROR_INVALID_ARGUMENT,
+                   "ring capacity must be a power of two from %d to %d",
+                   LOUDBUS_RING_MIN, LOUDBUS_RING_MAX);
+      return NULL;
+    } // if the capacity is bad
+
+  size = LOUDBUS_RING_HEADER + 2 * capacity;
+  fd = memfd_create ("loudbus-ring", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+  if ((fd < 0) || (ftruncate (fd, size) < 0)
+      || (fcntl (fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_SEAL)
+          < 0))
+    {
+      g_set_error (errorp, G_IO_ERROR, g_io_error_from_errno (errno),
+                   "could not make the ring: %s", g_strerror (errno));
+      if (fd >= 0)
+        close (fd);
+      return NULL;
+    } // if we could not make the memfd
+
+  // loudbus_ring_map closes the descriptor it gets, and we need one
+  // to hand to the service.
+  dup = fcntl (fd, F_DUPFD_CLOEXEC, 0);
+  ring = loudbus_ring_map (fd, errorp);
+  if (ring == NULL)
+    {
+      if (dup >= 0)
+        close (dup);
+      return NULL;
+    } // if (ring == NULL)
+  ring->fd = dup;
+  ring->lane = LOUDBUS_RING_CLIENT;
+  ring->shared->magic = LOUDBUS_RING_MAGIC;
+  ring->shared->version = LOUDBUS_RING_VERSION;
+  ring->shared->capacity = capacity;
+  return ring;
+} // loudbus_ring_new
+
+/**
+ * Map a ring that a client sent, for a service, which calls the ring
+ * id.  Takes over fd.  Returns NULL (setting errorp) if fd doesn't
+ * hold a ring, or the client could shrink it.
+ */
+LouDBusRing *
+loudbus_ring_attach (int fd, guint32 id, GError **errorp)
+{
+  LouDBusRing *ring;            // The ring we return
+  int seals;                    // The seals on the memfd
+
+  seals = fcntl (fd, F_GET_SEALS);
+  if ((seals < 0) || ((seals & F_SEAL_SHRINK) == 0))
+    {
+      g_set_error (errorp, G_IO_ERROR, G_IO_ERROR_PERMISSION_DENIED,
+                   "the ring is not sealed against shrinking");
+      close (fd);
+      return NULL;
+    } // if the client could shrink the ring
+
+  ring = loudbus_ring_map (fd, errorp);
+  if (ring == NULL)
+    return NULL;
+  if ((ring->shared->magic != LOUDBUS_RING_MAGIC)
+      || (ring->shared->version != LOUDBUS_RING_VERSION)
+      || (ring->shared->capacity != ring->capacity)
+      || (ring->capacity < LOUDBUS_RING_MIN)
+      || ((ring->capacity & (ring->capacity - 1)) != 0))
+    {
+      g_set_error (errorp, G_IO_ERROR, G_IO_ERROR_INVALID_DATA,
+                   "not a louDBus ring");
+      loudbus_ring_unref (ring);
+      return NULL;
+    } // if it's not a ring
+  ring->lane = LOUDBUS_RING_SERVICE;
+  ring->id = id;
+  return ring;
+} // loudbus_ring_attach
+
+/**
+ * Take the descriptor that a client hands to the service.  The caller
+ * closes it.
+ */
+int
+loudbus_ring_steal_fd (LouDBusRing *ring)
+{
+  int fd = ring->fd;    // The descriptor
+
+  ring->fd = -1;
+  return fd;
+} // loudbus_ring_steal_fd
+
+/**
+ * Record the service's number for a client's ring.
+ */
+void
+loudbus_ring_set_id (LouDBusRing *ring, guint32 id)
+{
+  ring->id = id;
+} // loudbus_ring_set_id
+
+/**
+ * Get the service's number for a ring.
+ */
+guint32
+loudbus_ring_id (LouDBusRing *ring)
+{
+  return ring->id;
+} // loudbus_ring_id
+
+/**
+ * Add a reference to a ring.
+ */
+LouDBusRing *
+loudbus_ring_ref (LouDBusRing *ring)
+{
+  g_atomic_int_inc (&ring->refcount);
+  return ring;
+} // loudbus_ring_ref
+
+/**
+ * Drop a reference to a ring, unmapping it when no one uses it.
+ */
+void
+loudbus_ring_unref (LouDBusRing *ring)
+{
+  if (! g_atomic_int_dec_and_test (&ring->refcount))
+    return;
+  munmap (ring->map, ring->size);
+  if (ring->fd >= 0)
+    close (ring->fd);
+  g_mutex_clear (&ring->lock);
+  g_free (ring);
+} // loudbus_ring_unref
+
+/**
+ * Encode (or decode) each top-level byte array in a tuple, as
+ * loudbus_frame_tuple does, except that large arrays go through the
+ * ring (which may be NULL, for none).  When encoding, arrays that go
+ * in their frames are compressed if they have at least threshold
+ * bytes.  Returns a new reference to the converted tuple, or NULL
+ * (setting errorp) if some frame is invalid.
+ */
+GVariant *
+loudbus_ring_tuple (LouDBusRing *ring, GVariant *tuple, gboolean encode,
+                    gsize threshold, GError **errorp)
+{
+  GVariant **children;          // The members of the new tuple
+  GVariant *child;              // One member of the old tuple
+  GVariant *result;             // The new tuple
+  gsize n;                      // The number of members
+  gsize i;                      // Counter variable
+
+  n = g_variant_n_children (tuple);
+  children = g_new (GVariant *, MAX (n, 1));
+  for (i = 0; i < n; i++)
+    {
+      child = g_variant_get_child_value (tuple, i);
+      if (! g_variant_is_of_type (child, G_VARIANT_TYPE_BYTESTRING))
+        children[i] = child;
+      else
+        {
+          children[i] = encode
+                        ? loudbus_ring_encode (ring, child, threshold)
+                        : loudbus_ring_decode (ring, child, errorp);
+          g_variant_unref (child);
+          if (children[i] == NULL)
+            {
+              while (i > 0)
+                g_variant_unref (children[--i]);
+              g_free (children);
+              // Don't leave the other records in the lane.
+              loudbus_ring_tuple_discard (ring, tuple);
+              return NULL;
+            } // if we could not decode the frame
+          g_variant_ref_sink (children[i]);
+        } // if it's a byte array
+    } // for each member
+
+  result = g_variant_ref_sink (g_variant_new_tuple (children, n));
+  for (i = 0; i < n; i++)
+    g_variant_unref (children[i]);
+  g_free (children);
+  return result;
+} // loudbus_ring_tuple
+
+/**
+ * Find the number of the ring that the byte arrays in a tuple refer
+ * to, so that a service can tell which ring to decode them with.
+ * Returns FALSE if none of them are in a ring.
+ */
+gboolean
+loudbus_ring_tuple_id (GVariant *tuple, guint32 *id)
+{
+  GVariant *child;              // One member of the tuple
+  const guchar *data;           // Its bytes
+  gsize n;                      // How many there are
+  gsize i;                      // Counter variable
+  gboolean found = FALSE;       // Have we found a ring frame?
+
+  for (i = 0; (! found) && (i < g_variant_n_children (tuple)); i++)
+    {
+      child = g_variant_get_child_value (tuple, i);
+      if (g_variant_is_of_type (child, G_VARIANT_TYPE_BYTESTRING))
+        {
+          data = g_variant_get_fixed_array (child, &n, sizeof (guchar));
+          if (loudbus_ring_frame_p (data, n))
+            {
+              *id = loudbus_ring_get_le (data + LOUDBUS_FRAME_HEADER, 4);
+              found = TRUE;
+            } // if it's a ring frame
+        } // if it's a byte array
+      g_variant_unref (child);
+    } // for each member
+
+  return found;
+} // loudbus_ring_tuple_id
+
+/**
+ * Give back the records in our lane that the frames in a tuple refer
+ * to, for a call that we encoded with loudbus_ring_tuple but are not
+ * going to send.  (ring may be NULL, for none.)
+ */
+void
+loudbus_ring_tuple_release (LouDBusRing *ring, GVariant *tuple)
+{
+  GVariant *child;              // One member of the tuple
+  const guchar *data;           // Its bytes
+  gsize n;                      // How many there are
+  gsize i;                      // Counter variable
+
+  if ((ring == NULL) || (tuple == NULL))
+    return;
+  g_mutex_lock (&ring->lock);
+  for (i = 0; i < g_variant_n_children (tuple); i++)
+    {
+      child = g_variant_get_child_value (tuple, i);
+      if (g_variant_is_of_type (child, G_VARIANT_TYPE_BYTESTRING))
+        {
+          data = g_variant_get_fixed_array (child, &n, sizeof (guchar));
+          if (loudbus_ring_frame_p (data, n)
+              && (loudbus_ring_get_le (data + LOUDBUS_FRAME_HEADER, 4)
+                  == ring->id))
+            loudbus_ring_give_back
+              (ring,
+               loudbus_ring_get_le (data + LOUDBUS_FRAME_HEADER + 8, 8),
+               loudbus_ring_get_le (data + 4, 4));
+        } // if it's a byte array
+      g_variant_unref (child);
+    } // for each member
+  g_mutex_unlock (&ring->lock);
+} // loudbus_ring_tuple_release
+
+/**
+ * Give back the records in the other side's lane that the frames in
+ * a tuple refer to, without copying them, for a reply that we are
+ * dropping.  (ring may be NULL, for none.)
+ */
+void
+loudbus_ring_tuple_discard (LouDBusRing *ring, GVariant *tuple)
+{
+  GVariant *child;              // One member of the tuple
+  LouDBusRecord *record;        // The record one of them refers to
+  const guchar *data;           // Its bytes
+  gsize n;                      // How many there are
+  gsize i;                      // Counter variable
+
+  if ((ring == NULL) || (tuple == NULL))
+    return;
+  g_mutex_lock (&ring->lock);
+  for (i = 0; i < g_variant_n_children (tuple); i++)
+    {
+      child = g_variant_get_child_value (tuple, i);
+      if (g_variant_is_of_type (child, G_VARIANT_TYPE_BYTESTRING))
+        {
+          data = g_variant_get_fixed_array (child, &n, sizeof (guchar));
+          if (loudbus_ring_frame_p (data, n)
+              && (loudbus_ring_get_le (data + LOUDBUS_FRAME_HEADER, 4)
+                  == ring->id))
+            {
+              record = loudbus_ring_find
+                         (ring,
+                          loudbus_ring_get_le (data + LOUDBUS_FRAME_HEADER
+                                                 + 8, 8),
+                          loudbus_ring_get_le (data + 4, 4),
+                          NULL);
+              if (record != NULL)
+                loudbus_ring_pass (ring, record);
+            } // if it's a frame in this ring
+        } // if it's a byte array
+      g_variant_unref (child);
+    } // for each member
+  g_mutex_unlock (&ring->lock);
+} // loudbus_ring_tuple_discard
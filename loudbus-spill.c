@@ -0,0 +1,391 @@
+/**
+ * loudbus-spill.c
+ *   Spilled replies for A D-Bus Client for Racket.  Very large byte
+ *   arrays go to an unlinked temporary file and come back to Racket as
+ *   a read-only mapping of that file, rather than as a copy on the
+ *   heap.  We also enforce a limit on the size of replies.
+ *
+ * Copyright (c) 2012-15 Zarni Htet, Alexandra Greenberg, Mark Lewis,
+ * Evan Manuella, Samuel A. Rebelsky, Hart Russell, Mani Tiwaree,
+ * and Christine Tran.  All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the Lesser GNU General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+// +-------+----------------------------------------------------------
+// | Notes |
+// +-------+
+
+/*
+
+* GDBus reads each message whole, so a reply is on the heap once no
+  matter what we do.  What we can avoid is the second copy, in a
+  Racket byte string.  Once the bytes are in the file, the reply can
+  go, and the kernel can page the mapping out when memory is tight.
+
+* We prefer a file in the temporary directory, which is usually on
+  disk, and fall back to a memfd (which lives in memory, but can be
+  swapped) where there is one.  Either way, the file has no name once
+  we've opened it, so it disappears when the mapping does.
+
+* The limit on replies applies only to our own calls.  The session
+  connection is shared with the rest of the process, so we check
+  replies on it as each of our calls finishes, which means a big
+  reply is on the heap until then.  On the private connections that
+  we open ourselves, a filter sees each message just after GDBus
+  reads it, and replaces a reply that's too big with an error, so the
+  big body is freed before it gets to the scheduler or the caller.
+
+ */
+
+
+// +---------+--------------------------------------------------------
+// | Headers |
+// +---------+
+
+#define _GNU_SOURCE     // For memfd_create
+
+#include <errno.h>      // For errno
+#include <sys/mman.h>   // For mmap and munmap
+#include <unistd.h>     // For write and close
+
+#include <glib.h>       // For various glib stuff.
+#include <glib/gstdio.h> // For g_unlink
+#include <gio/gio.h>    // For the GDBus functions.
+
+#include "loudbus-core.h"
+
+
+// +--------+---------------------------------------------------------
+// | Macros |
+// +--------+
+
+/**
+ * Byte arrays at least this large are spilled, unless told otherwise.
+ * By default, we never spill.
+ */
+#define LOUDBUS_SPILL_THRESHOLD 0
+
+/**
+ * Identifies a LouDBusSpill.
+ */
+#define LOUDBUS_SPILL_SIGNATURE 0x5b111e
+
+/**
+ * The key under which we mark connections that have our filter.
+ */
+#define LOUDBUS_SPILL_FILTER_KEY "loudbus-reply-filter"
+
+
+// +-------+----------------------------------------------------------
+// | Types |
+// +-------+
+
+/**
+ * A byte array in a mapped file.
+ */
+struct LouDBusSpill
+  {
+    int signature;              // Identifies spills
+    guchar *data;               // The mapping
+    gsize size;                 // Its size
+  };
+
+
+// +---------+--------------------------------------------------------
+// | Globals |
+// +---------+
+
+/**
+ * The size at which we spill byte arrays (0 for never), and the
+ * largest reply we accept (0 for no limit).
+ */
+static gsize loudbus_spill_threshold_bytes = LOUDBUS_SPILL_THRESHOLD;
+static gsize loudbus_reply_limit = 0;
+
+/**
+ * Protects the settings and the marks on connections.
+ */
+static GMutex loudbus_spill_lock;
+
+
+// +-----------------+------------------------------------------------
+// | Local Utilities |
+// +-----------------+
+
+/**
+ * Open a file with no name to spill into.  Returns -1 (setting
+ * errorp) if we can't.
+ */
+static int
+loudbus_spill_open (GError **errorp)
+{
+  gchar *name;          // The name of the temporary file
+  int fd;               // The file
+
+  fd = g_file_open_tmp ("loudbus-XXXXXX", &name, errorp);
+  if (fd >= 0)
+    {
+      g_unlink (name);
+      g_free (name);
+      return fd;
+    } // if we have a temporary file
+
+#ifdef MFD_CLOEXEC
+  fd = memfd_create ("loudbus-reply", MFD_CLOEXEC);
+  if (fd >= 0)
+    g_clear_error (errorp);
+#endif
+
+  return fd;
+} // loudbus_spill_open
+
+/**
+ * Write all of a buffer to a file.
+ */
+static gboolean
+loudbus_spill_write (int fd, const guchar *data, gsize size,
+                     GError **errorp)
+{
+  gssize written;       // The bytes written in one step
+
+  while (size > 0)
+    {
+      written = write (fd, data, MIN (size, G_MAXSSIZE));
+      if ((written < 0) && (errno == EINTR))
+        continue;
+      if (written < 0)
+        {
+          g_set_error (errorp, G_IO_ERROR, g_io_error_from_errno (errno),
+                       "could not spill reply: %s", g_strerror (errno));
+          return FALSE;
+        } // if the write failed
+      if (written == 0)
+        {
+          g_set_error (errorp, G_IO_ERROR, G_IO_ERROR_FAILED,
+                       "could not spill reply: short write");
+          return FALSE;
+        } // if the write made no progress
+      data += written;
+      size -= written;
+    } // while there's more to write
+
+  return TRUE;
+} // loudbus_spill_write
+
+/**
+ * Replace replies that are too big with errors.  Runs on the GDBus
+ * worker thread, as each message arrives.
+ */
+static GDBusMessage *
+loudbus_spill_filter (GDBusConnection *connection, GDBusMessage *message,
+                      gboolean incoming, gpointer data)
+{
+  gsize limit;                  // The largest reply we accept
+  GVariant *body;               // The body of the reply
+  GDBusMessage *error;          // The error that replaces it
+  guint32 ring;                 // The ring the reply refers to, if any
+
+  g_mutex_lock (&loudbus_spill_lock);
+  limit = loudbus_reply_limit;
+  g_mutex_unlock (&loudbus_spill_lock);
+  if ((! incoming) || (limit == 0)
+      || (g_dbus_message_get_message_type (message)
+          != G_DBUS_MESSAGE_TYPE_METHOD_RETURN))
+    return message;
+  body = g_dbus_message_get_body (message);
+  if ((body == NULL) || (g_variant_get_size (body) <= limit))
+    return message;
+
+  // A reply that refers to records in a ring goes through, so that
+  // the call that made it can give them back (see
+  // loudbus_spill_check_reply).
+  if (loudbus_ring_tuple_id (body, &ring))
+    return message;
+
+  error = g_dbus_message_new ();
+  g_dbus_message_set_message_type (error, G_DBUS_MESSAGE_TYPE_ERROR);
+  g_dbus_message_set_flags (error, G_DBUS_MESSAGE_FLAGS_NO_REPLY_EXPECTED);
+  g_dbus_message_set_reply_serial (error,
+                                   g_dbus_message_get_reply_serial (message));
+  g_dbus_message_set_sender (error, g_dbus_message_get_sender (message));
+  g_dbus_message_set_destination (error,
+                                  g_dbus_message_get_destination (message));
+  g_dbus_message_set_error_name (error,
+                                 "org.freedesktop.DBus.Error.LimitsExceeded");
+  g_dbus_message_set_body (error,
+                           g_variant_new ("(s)", "reply exceeds the limit"));
+  g_object_unref (message);
+  return error;
+} // loudbus_spill_filter
+
+
+// +-----------------+------------------------------------------------
+// | Spilled Replies |
+// +-----------------+
+
+/**
+ * Set the size at which byte arrays get spilled (0 for never), and
+ * the largest reply to accept (0 for no limit).  Negative values
+ * leave a setting alone.
+ */
+void
+loudbus_spill_configure (gssize threshold, gssize limit)
+{
+  g_mutex_lock (&loudbus_spill_lock);
+  if (threshold >= 0)
+    loudbus_spill_threshold_bytes = threshold;
+  if (limit >= 0)
+    loudbus_reply_limit = limit;
+  g_mutex_unlock (&loudbus_spill_lock);
+} // loudbus_spill_configure
+
+/**
+ * Get the size at which byte arrays get spilled, or 0 if they don't.
+ */
+gsize
+loudbus_spill_threshold (void)
+{
+  gsize threshold;      // The threshold
+
+  g_mutex_lock (&loudbus_spill_lock);
+  threshold = loudbus_spill_threshold_bytes;
+  g_mutex_unlock (&loudbus_spill_lock);
+  return threshold;
+} // loudbus_spill_threshold
+
+/**
+ * Check the reply to one of our calls against the limit on replies.
+ * Returns the reply if it's small enough.  Otherwise, gives back the
+ * records in ring (which may be NULL) that the reply refers to,
+ * releases the reply, and returns NULL (setting errorp).
+ */
+GVariant *
+loudbus_spill_check_reply (GVariant *reply, LouDBusRing *ring,
+                           GError **errorp)
+{
+  gsize limit;          // The largest reply we accept
+
+  g_mutex_lock (&loudbus_spill_lock);
+  limit = loudbus_reply_limit;
+  g_mutex_unlock (&loudbus_spill_lock);
+  if ((reply == NULL) || (limit == 0) || (g_variant_get_size (reply) <= limit))
+    return reply;
+  loudbus_ring_tuple_discard (ring, reply);
+  g_variant_unref (reply);
+  g_set_error (errorp, G_DBUS_ERROR, G_DBUS_ERROR_LIMITS_EXCEEDED,
+               "reply exceeds the limit");
+  return NULL;
+} // loudbus_spill_check_reply
+
+/**
+ * Make sure that a connection enforces the limit on replies as they
+ * arrive.  Only for connections that we open ourselves, since the
+ * filter sees every reply on the connection.
+ */
+void
+loudbus_spill_watch (GDBusConnection *connection)
+{
+  g_mutex_lock (&loudbus_spill_lock);
+  if (g_object_get_data (G_OBJECT (connection),
+                         LOUDBUS_SPILL_FILTER_KEY) == NULL)
+    {
+      g_dbus_connection_add_filter (connection, loudbus_spill_filter,
+                                    NULL, NULL);
+      g_object_set_data (G_OBJECT (connection), LOUDBUS_SPILL_FILTER_KEY,
+                         GSIZE_TO_POINTER (1));
+    } // if the connection has no filter
+  g_mutex_unlock (&loudbus_spill_lock);
+} // loudbus_spill_watch
+
+/**
+ * Spill a byte array into a mapped file.  Returns NULL (setting
+ * errorp) if we can't.  The caller releases the result with
+ * loudbus_spill_free.
+ */
+LouDBusSpill *
+loudbus_spill_new (GVariant *bytes, GError **errorp)
+{
+  LouDBusSpill *spill;  // The spilled bytes
+  const guchar *data;   // The bytes
+  gsize size;           // How many there are
+  gpointer map;         // The mapping
+  int fd;               // The file we spill into
+
+  data = g_variant_get_fixed_array (bytes, &size, sizeof (guchar));
+  if (size == 0)
+    {
+      g_set_error (errorp, G_IO_ERROR, G_IO_ERROR_INVALID_ARGUMENT,
+                   "cannot map an empty array");
+      return NULL;
+    } // if there's nothing to spill
+
+  fd = loudbus_spill_open (errorp);
+  if (fd < 0)
+    return NULL;
+  if (! loudbus_spill_write (fd, data, size, errorp))
+    {
+      close (fd);
+      return NULL;
+    } // if we could not write the file
+
+  // The mapping keeps the file alive, so we don't need the descriptor.
+  map = mmap (NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+  close (fd);
+  if (map == MAP_FAILED)
+    {
+      g_set_error (errorp, G_IO_ERROR, g_io_error_from_errno (errno),
+                   "could not map spilled reply: %s", g_strerror (errno));
+      return NULL;
+    } // if we could not map the file
+
+  spill = g_new (LouDBusSpill, 1);
+  spill->signature = LOUDBUS_SPILL_SIGNATURE;
+  spill->data = map;
+  spill->size = size;
+  return spill;
+} // loudbus_spill_new
+
+/**
+ * Release a spilled byte array, unmapping its file.
+ */
+void
+loudbus_spill_free (LouDBusSpill *spill)
+{
+  if (! loudbus_spill_validate (spill))
+    return;
+  spill->signature = 0;
+  munmap (spill->data, spill->size);
+  g_free (spill);
+} // loudbus_spill_free
+
+/**
+ * Determine whether spill is a live spilled byte array.
+ */
+int
+loudbus_spill_validate (LouDBusSpill *spill)
+{
+  return (spill != NULL) && (spill->signature == LOUDBUS_SPILL_SIGNATURE);
+} // loudbus_spill_validate
+
+/**
+ * Get the bytes of a spilled array.  They belong to the spill.
+ */
+const guchar *
+loudbus_spill_data (LouDBusSpill *spill, gsize *size)
+{
+  *size = spill->size;
+  return spill->data;
+} // loudbus_spill_data
@@ -0,0 +1,316 @@
+/**
+ * loudbus-trace.c
+ *   A recorder of the calls and events in the core of A D-Bus Client
+ *   for Racket, for timelines.  It keeps what happens off the Racket
+ *   threads (asynchronous calls waiting and on the wire, and signals
+ *   that arrive on the worker) as Chrome trace events, which
+ *   unsafe.rkt merges with the events of the Racket threads.
+ *
+ * Copyright (c) 2012-15 Zarni Htet, Alexandra Greenberg, Mark Lewis,
+ * Evan Manuella, Samuel A. Rebelsky, Hart Russell, Mani Tiwaree,
+ * and Christine Tran.  All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the Lesser GNU General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+// +-------+----------------------------------------------------------
+// | Notes |
+// +-------+
+
+/*
+
+* Times come from loudbus_trace_now, which reads CLOCK_MONOTONIC, as
+  loudbus_timing_start does, so the spans that the Racket side builds
+  from the phases of calls line up with ours.  Chrome wants
+  microseconds.
+
+* Each track (a connection to the bus, or the queue of calls that
+  haven't gone out yet) becomes a thread of the trace.  Asynchronous
+  calls overlap, so they are async events ("b" and "e"), keyed by the
+  sequence number of the ticket, with the time in the queue and the
+  time on the wire nested inside.
+
+* We keep at most LOUDBUS_TRACE_LIMIT events and count the rest, so
+  that a trace left on doesn't eat all of memory.
+
+ */
+
+
+// +---------+--------------------------------------------------------
+// | Headers |
+// +---------+
+
+#include <time.h>       // For clock_gettime
+
+#include <glib.h>       // For various glib stuff.
+
+#include "loudbus-core.h"
+
+
+// +--------+---------------------------------------------------------
+// | Macros |
+// +--------+
+
+/**
+ * The most events we keep.
+ */
+#define LOUDBUS_TRACE_LIMIT 1000000
+
+
+// +-------+----------------------------------------------------------
+// | Types |
+// +-------+
+
+/**
+ * One event.  The strings are interned.
+ */
+struct LouDBusTraceEvent
+  {
+    gchar phase;                // The Chrome phase ('b', 'e', or 'i')
+    const gchar *category;      // The category
+    const gchar *name;          // The name
+    guint track;                // The track (an index in the tracks)
+    gint64 ts;                  // When, in nanoseconds
+    guint64 id;                 // Pairs 'b' and 'e' events
+  };
+typedef struct LouDBusTraceEvent LouDBusTraceEvent;
+
+
+// +---------+--------------------------------------------------------
+// | Globals |
+// +---------+
+
+/**
+ * Are we tracing?  The rest is protected by loudbus_trace_lock.
+ */
+static gint loudbus_trace_on = FALSE;
+static GMutex loudbus_trace_lock;
+
+/**
+ * The events, the names of the tracks (interned), and the number of
+ * events we dropped.
+ */
+static GArray *loudbus_trace_events = NULL;
+static GPtrArray *loudbus_trace_tracks = NULL;
+static guint64 loudbus_trace_dropped = 0;
+
+
+// +-----------------+------------------------------------------------
+// | Local Utilities |
+// +-----------------+
+
+/**
+ * Find the index of a track, adding it if it's new.  The caller holds
+ * the lock.
+ */
+static guint
+loudbus_trace_track (const gchar *track)
+{
+  guint i;              // Counter variable
+
+  track = g_intern_string (track);
+  for (i = 0; i < loudbus_trace_tracks->len; i++)
+    if (g_ptr_array_index (loudbus_trace_tracks, i) == track)
+      return i;
+  g_ptr_array_add (loudbus_trace_tracks, (gpointer) track);
+  return i;
+} // loudbus_trace_track
+
+/**
+ * Add an event.  The caller holds the lock.
+ */
+static void
+loudbus_trace_add (gchar phase, guint track, const gchar *category,
+                   const gchar *name, guint64 id, gint64 ts)
+{
+  LouDBusTraceEvent event;      // The event
+
+  if (loudbus_trace_events->len >= LOUDBUS_TRACE_LIMIT)
+    {
+      loudbus_trace_dropped++;
+      return;
+    } // if we have too many
+  event.phase = phase;
+  event.category = g_intern_string (category);
+  event.name = g_intern_string (name);
+  event.track = track;
+  event.ts = ts;
+  event.id = id;
+  g_array_append_val (loudbus_trace_events, event);
+} // loudbus_trace_add
+
+/**
+ * Append a string to a JSON document, quoted.
+ */
+static void
+loudbus_trace_quote (GString *json, const gchar *str)
+{
+  g_string_append_c (json, '"');
+  for ( ; *str != '\0'; str++)
+    {
+      if ((*str == '"') || (*str == '\\'))
+        g_string_append_c (json, '\\');
+      if ((guchar) *str < 0x20)
+        g_string_append_printf (json, "\\u%04x", (guchar) *str);
+      else
+        g_string_append_c (json, *str);
+    } // for each character
+  g_string_append_c (json, '"');
+} // loudbus_trace_quote
+
+
+// +--------------+---------------------------------------------------
+// | Call Tracing |
+// +--------------+
+
+/**
+ * The time, in nanoseconds, on the clock the trace uses.
+ */
+gint64
+loudbus_trace_now (void)
+{
+  struct timespec now;  // The time
+
+  clock_gettime (CLOCK_MONOTONIC, &now);
+  return (gint64) now.tv_sec * G_GINT64_CONSTANT (1000000000) + now.tv_nsec;
+} // loudbus_trace_now
+
+/**
+ * Start or stop tracing.  Starting forgets the old events.
+ */
+void
+loudbus_trace_enable (gboolean on)
+{
+  g_mutex_lock (&loudbus_trace_lock);
+  if (on)
+    {
+      if (loudbus_trace_events == NULL)
+        {
+          loudbus_trace_events = g_array_new (FALSE, FALSE,
+                                              sizeof (LouDBusTraceEvent));
+          loudbus_trace_tracks = g_ptr_array_new ();
+        } // if we've never traced
+      g_array_set_size (loudbus_trace_events, 0);
+      g_ptr_array_set_size (loudbus_trace_tracks, 0);
+      loudbus_trace_dropped = 0;
+    } // if (on)
+  g_atomic_int_set (&loudbus_trace_on, on);
+  g_mutex_unlock (&loudbus_trace_lock);
+} // loudbus_trace_enable
+
+/**
+ * Are we tracing?
+ */
+gboolean
+loudbus_trace_enabled (void)
+{
+  return g_atomic_int_get (&loudbus_trace_on);
+} // loudbus_trace_enabled
+
+/**
+ * Record the start (phase 'b') or end (phase 'e') of something that
+ * overlaps other things on its track, as an async event with the
+ * given id.  Events with the same category and id nest, so record
+ * them in the order they nest in.
+ */
+void
+loudbus_trace_async (const gchar *track, const gchar *category,
+                     const gchar *name, guint64 id, gchar phase,
+                     gint64 ts)
+{
+  if (! loudbus_trace_enabled ())
+    return;
+  g_mutex_lock (&loudbus_trace_lock);
+  loudbus_trace_add (phase, loudbus_trace_track (track), category, name,
+                     id, ts);
+  g_mutex_unlock (&loudbus_trace_lock);
+} // loudbus_trace_async
+
+/**
+ * Record something that happened at one time, such as a signal.
+ */
+void
+loudbus_trace_instant (const gchar *track, const gchar *category,
+                       const gchar *name, gint64 ts)
+{
+  if (! loudbus_trace_enabled ())
+    return;
+  g_mutex_lock (&loudbus_trace_lock);
+  loudbus_trace_add ('i', loudbus_trace_track (track), category, name, 0,
+                     ts);
+  g_mutex_unlock (&loudbus_trace_lock);
+} // loudbus_trace_instant
+
+/**
+ * Get the events recorded since tracing started, as Chrome trace
+ * events (JSON objects separated by commas, without the surrounding
+ * array) for process pid, with the names of the tracks.  Returns a
+ * string that the caller frees.
+ */
+gchar *
+loudbus_trace_json (int pid)
+{
+  GString *json;                // The events
+  LouDBusTraceEvent *event;     // One event
+  guint i;                      // Counter variable
+
+  json = g_string_new ("");
+  g_mutex_lock (&loudbus_trace_lock);
+  if (loudbus_trace_events == NULL)
+    {
+      g_mutex_unlock (&loudbus_trace_lock);
+      return g_string_free (json, FALSE);
+    } // if we've never traced
+
+  g_string_append_printf (json,
+                          "{\"ph\":\"M\",\"name\":\"process_name\","
+                          "\"pid\":%d,\"tid\":0,"
+                          "\"args\":{\"name\":\"louDBus core\"}}", pid);
+  for (i = 0; i < loudbus_trace_tracks->len; i++)
+    {
+      g_string_append_printf (json,
+                              ",\n{\"ph\":\"M\",\"name\":\"thread_name\","
+                              "\"pid\":%d,\"tid\":%u,\"args\":{\"name\":",
+                              pid, i + 1);
+      loudbus_trace_quote (json, g_ptr_array_index (loudbus_trace_tracks, i));
+      g_string_append (json, "}}");
+    } // for each track
+  for (i = 0; i < loudbus_trace_events->len; i++)
+    {
+      event = &g_array_index (loudbus_trace_events, LouDBusTraceEvent, i);
+      g_string_append_printf (json, ",\n{\"ph\":\"%c\",\"cat\":",
+                              event->phase);
+      loudbus_trace_quote (json, event->category);
+      g_string_append (json, ",\"name\":");
+      loudbus_trace_quote (json, event->name);
+      g_string_append_printf (json, ",\"pid\":%d,\"tid\":%u,\"ts\":%.3f",
+                              pid, event->track + 1, event->ts / 1e3);
+      if (event->phase == 'i')
+        g_string_append (json, ",\"s\":\"t\"");
+      else
+        g_string_append_printf (json, ",\"id\":%" G_GUINT64_FORMAT,
+                                event->id);
+      g_string_append_c (json, '}');
+    } // for each event
+  if (loudbus_trace_dropped > 0)
+    g_string_append_printf (json,
+                            ",\n{\"ph\":\"M\",\"name\":\"process_labels\","
+                            "\"pid\":%d,\"tid\":0,\"args\":{\"labels\":"
+                            "\"%" G_GUINT64_FORMAT " events dropped\"}}",
+                            pid, loudbus_trace_dropped);
+  g_mutex_unlock (&loudbus_trace_lock);
+
+  return g_string_free (json, FALSE);
+} // loudbus_trace_json
@@ -0,0 +1,515 @@
+/**
+ * loudbus-wire.c
+ *   A direct encoder for the parameters of calls in A D-Bus Client for
+ *   Racket.  Rather than building a GVariant for each argument and
+ *   letting a builder put them together, it writes the serialized form
+ *   of the whole tuple into one reusable buffer, which GLib then takes
+ *   as a GVariant without converting anything.
+ *
+ * Copyright (c) 2012-15 Zarni Htet, Alexandra Greenberg, Mark Lewis,
+ * Evan Manuella, Samuel A. Rebelsky, Hart Russell, Mani Tiwaree,
+ * and Christine Tran.  All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the Lesser GNU General Public License as published
+ * by the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+// +-------+----------------------------------------------------------
+// | Notes |
+// +-------+
+
+/*
+
+* GDBus only sends GVariants, so we write what GVariant itself keeps
+  in memory (its serialized form, in host byte order), not the D-Bus
+  wire format.  GLib turns that into a message as it would any other
+  GVariant.
+
+* The rules, from the GVariant paper: every value starts at a
+  multiple of its alignment (1 for b, y, s, o, and g; 2 for n and q;
+  4 for i, u, and h; 8 for x, t, d, and v; the largest alignment of
+  the members for tuples and arrays).  Fixed-size values are their
+  bytes.  Strings end with a NUL.  An array of fixed-size elements
+  is the elements, one after another; an array of variable-size
+  elements is followed by the offset of the end of each element.  A
+  tuple is followed by the offset of the end of each variable-size
+  member but the last, in reverse order; a tuple of fixed-size
+  members is padded to its alignment (and the empty tuple is one
+  zero byte).  Offsets are little-endian, and as wide as they must be
+  (1, 2, 4, or 8 bytes) for the container, offsets included.
+
+* We only write arrays that are members of the tuple, not arrays
+  inside arrays.  Anything more complicated is built as a GVariant
+  by the caller and copied in with loudbus_wire_add_value.
+
+* We hand GLib our bytes as untrusted, so a mistake here shows up as
+  wrong values (which the 'check mode of loudbus-wire-config! finds)
+  rather than as a crash.
+
+ */
+
+
+// +---------+--------------------------------------------------------
+// | Headers |
+// +---------+
+
+#include <string.h>     // For strlen
+
+#include <glib.h>       // For various glib stuff.
+
+#include "loudbus-core.h"
+
+
+// +-------+----------------------------------------------------------
+// | Types |
+// +-------+
+
+struct LouDBusWire
+  {
+    GByteArray *data;           // The tuple we're writing
+    GString *type;              // The type of the tuple
+    GArray *ends;               // Where the variable members end
+    GArray *elements;           // Where the elements of the array end
+    gchar **members;            // The types of the members (borrowed)
+    int nmembers;               // How many members there are
+    int member;                 // The member we're writing
+    int align;                  // The alignment of the tuple
+    gsize fixed;                // Its size, if fixed, or 0
+    gboolean open;              // Are we writing an array?
+    gsize array;                // If so, where it starts
+    gboolean failed;            // Did something not match the type?
+  };
+
+
+// +-----------------+------------------------------------------------
+// | Local Utilities |
+// +-----------------+
+
+/**
+ * Find the alignment and fixed size (0 for variable-size values) of
+ * the complete type at the start of type.  Returns the rest of the
+ * type, or NULL if the type is not one we know.
+ */
+static const gchar *
+loudbus_wire_info (const gchar *type, int *align, gsize *fixed)
+{
+  int malign;           // The alignment of a member
+  gsize mfixed;         // The fixed size of a member
+  gsize size;           // The size of the fixed members so far
+  gboolean variable;    // Does a member have variable size?
+  gchar close;          // The end of a tuple or dictionary entry
+
+  switch (*type)
+    {
+      case 'b':
+      case 'y':
+        *align = 1;
+        *fixed = 1;
+        return type + 1;
+      case 'n':
+      case 'q':
+        *align = 2;
+        *fixed = 2;
+        return type + 1;
+      case 'i':
+      case 'u':
+      case 'h':
+        *align = 4;
+        *fixed = 4;
+        return type + 1;
+      case 'x':
+      case 't':
+      case 'd':
+        *align = 8;
+        *fixed = 8;
+        return type + 1;
+      case 's':
+      case 'o':
+      case 'g':
+        *align = 1;
+        *fixed = 0;
+        return type + 1;
+      case 'v':
+        *align = 8;
+        *fixed = 0;
+        return type + 1;
+      case 'a':
+      case 'm':
+        type = loudbus_wire_info (type + 1, align, &mfixed);
+        *fixed = 0;
+        return type;
+      case '(':
+      case '{':
+        close = (*type == '(') ? ')' : '}';
+        *align = 1;
+        size = 0;
+        variable = FALSE;
+        for (type++; (type != NULL) && (*type != close); )
+          {
+            type = loudbus_wire_info (type, &malign, &mfixed);
+            if (malign > *align)
+              *align = malign;
+            size = (size + malign - 1) & ~((gsize) malign - 1);
+            if (mfixed == 0)
+              variable = TRUE;
+            size += mfixed;
+          } // for each member
+        if ((type == NULL) || variable)
+          *fixed = 0;
+        else if (size == 0)
+          *fixed = 1;
+        else
+          *fixed = (size + *align - 1) & ~((gsize) *align - 1);
+        return (type == NULL) ? NULL : type + 1;
+      default:
+        return NULL;
+    } // switch
+} // loudbus_wire_info
+
+/**
+ * Pad the data with zeros to a multiple of align.
+ */
+static void
+loudbus_wire_pad (LouDBusWire *wire, int align)
+{
+  static const guint8 zeros[8] = { 0 };
+  gsize pad;            // How much padding we need
+
+  pad = (align - (wire->data->len % align)) % align;
+  if (pad > 0)
+    g_byte_array_append (wire->data, zeros, pad);
+} // loudbus_wire_pad
+
+/**
+ * Write the framing offsets of a container that starts at start:
+ * ends, as offsets from start, in reverse order if reverse is set.
+ */
+static void
+loudbus_wire_frame (LouDBusWire *wire, gsize start, GArray *ends,
+                    gboolean reverse)
+{
+  gsize body;           // The size of the container without offsets
+  guint n;              // The number of offsets
+  guint size;           // The size of one offset
+  guint64 offset;       // One offset
+  guint8 bytes[8];      // One offset, little-endian
+  guint i;              // Counter variable
+  guint b;              // Counter variable
+
+  body = wire->data->len - start;
+  n = ends->len;
+  if (n == 0)
+    return;
+  if (body + n <= G_MAXUINT8)
+    size = 1;
+  else if (body + 2 * (gsize) n <= G_MAXUINT16)
+    size = 2;
+  else if (body + 4 * (guint64) n <= G_MAXUINT32)
+    size = 4;
+  else
+    size = 8;
+
+  for (i = 0; i < n; i++)
+    {
+      offset = g_array_index (ends, gsize, reverse ? n - 1 - i : i) - start;
+      for (b = 0; b < size; b++)
+        bytes[b] = (guint8) (offset >> (8 * b));
+      g_byte_array_append (wire->data, bytes, size);
+    } // for each offset
+} // loudbus_wire_frame
+
+/**
+ * The type of the next value to write (an element, if an array is
+ * open, or a member), or NULL if there should be no more.
+ */
+static const gchar *
+loudbus_wire_next (LouDBusWire *wire)
+{
+  if (wire->failed || (wire->member >= wire->nmembers))
+    return NULL;
+  if (wire->open)
+    return wire->members[wire->member] + 1;
+  return wire->members[wire->member];
+} // loudbus_wire_next
+
+/**
+ * Note that we've finished writing a value of the given type: record
+ * where it ends, if it has variable size, and move on to the next
+ * member unless it's an element of an open array.
+ */
+static void
+loudbus_wire_done (LouDBusWire *wire, const gchar *type)
+{
+  int align;            // The alignment of the value
+  gsize fixed;          // Its fixed size
+  gsize end;            // Where it ends
+
+  loudbus_wire_info (type, &align, &fixed);
+  end = wire->data->len;
+  if (wire->open)
+    {
+      if (fixed == 0)
+        g_array_append_val (wire->elements, end);
+      return;
+    } // if it's an element
+  if ((fixed == 0) && (wire->member < wire->nmembers - 1))
+    g_array_append_val (wire->ends, end);
+  wire->member++;
+} // loudbus_wire_done
+
+
+// +-----------------+------------------------------------------------
+// | Direct Encoding |
+// +-----------------+
+
+/**
+ * Create an encoder, which the caller reuses for call after call and
+ * frees with loudbus_wire_free.
+ */
+LouDBusWire *
+loudbus_wire_new (void)
+{
+  LouDBusWire *wire;    // The encoder
+
+  wire = g_new0 (LouDBusWire, 1);
+  wire->data = g_byte_array_new ();
+  wire->type = g_string_new ("");
+  wire->ends = g_array_new (FALSE, FALSE, sizeof (gsize));
+  wire->elements = g_array_new (FALSE, FALSE, sizeof (gsize));
+  return wire;
+} // loudbus_wire_new
+
+/**
+ * Free an encoder.
+ */
+void
+loudbus_wire_free (LouDBusWire *wire)
+{
+  g_byte_array_unref (wire->data);
+  g_string_free (wire->type, TRUE);
+  g_array_unref (wire->ends);
+  g_array_unref (wire->elements);
+  g_free (wire);
+} // loudbus_wire_free
+
+/**
+ * Start a tuple whose members have the n given types.  The types
+ * must stay put until loudbus_wire_end.
+ */
+void
+loudbus_wire_begin (LouDBusWire *wire, gchar **types, int n)
+{
+  int i;                // Counter variable
+
+  g_byte_array_set_size (wire->data, 0);
+  g_array_set_size (wire->ends, 0);
+  wire->members = types;
+  wire->nmembers = n;
+  wire->member = 0;
+  wire->open = FALSE;
+  wire->failed = FALSE;
+
+  g_string_assign (wire->type, "(");
+  for (i = 0; i < n; i++)
+    g_string_append (wire->type, types[i]);
+  g_string_append_c (wire->type, ')');
+  if (loudbus_wire_info (wire->type->str, &wire->align, &wire->fixed)
+      == NULL)
+    wire->failed = TRUE;
+} // loudbus_wire_begin
+
+/**
+ * Write the next value, which has a fixed-size type (b, y, n, q, i,
+ * u, h, x, t, or d), from value, which holds one of that type (a
+ * gboolean for b).
+ */
+void
+loudbus_wire_add_fixed (LouDBusWire *wire, gconstpointer value)
+{
+  const gchar *type;    // The type of the value
+  int align;            // Its alignment
+  gsize fixed;          // Its size
+  guint8 b;             // A boolean, as a byte
+
+  type = loudbus_wire_next (wire);
+  if ((type == NULL) || (loudbus_wire_info (type, &align, &fixed) == NULL)
+      || (fixed == 0) || (fixed > 8) || (type[0] == '('))
+    {
+      wire->failed = TRUE;
+      return;
+    } // if it's not a basic fixed-size type
+
+  loudbus_wire_pad (wire, align);
+  if (type[0] == 'b')
+    {
+      b = *((const gboolean *) value) ? 1 : 0;
+      g_byte_array_append (wire->data, &b, 1);
+    } // if it's a boolean
+  else
+    g_byte_array_append (wire->data, value, fixed);
+  loudbus_wire_done (wire, type);
+} // loudbus_wire_add_fixed
+
+/**
+ * Write the next value, which is a string (s).  Fails if str is not
+ * valid UTF-8, as GVariant would.
+ */
+void
+loudbus_wire_add_string (LouDBusWire *wire, const gchar *str)
+{
+  const gchar *type;    // The type of the value
+  gsize len;            // The length of the string
+
+  type = loudbus_wire_next (wire);
+  if ((type == NULL) || (type[0] != 's'))
+    {
+      wire->failed = TRUE;
+      return;
+    } // if it's not a string
+  len = strlen (str);
+  if (! g_utf8_validate (str, len, NULL))
+    {
+      wire->failed = TRUE;
+      return;
+    } // if it's not UTF-8
+  g_byte_array_append (wire->data, (const guint8 *) str, len + 1);
+  loudbus_wire_done (wire, type);
+} // loudbus_wire_add_string
+
+/**
+ * Write the next member, which is an array of fixed-size elements,
+ * all at once from the n elements in data.  (Not booleans, which
+ * GVariant keeps as bytes, but callers keep as gbooleans.)
+ */
+void
+loudbus_wire_add_fixed_array (LouDBusWire *wire, gconstpointer data,
+                              gsize n)
+{
+  const gchar *type;    // The type of the array
+  int align;            // The alignment of an element
+  gsize fixed;          // The size of an element
+
+  type = loudbus_wire_next (wire);
+  if ((type == NULL) || wire->open || (type[0] != 'a') || (type[1] == 'b')
+      || (loudbus_wire_info (type + 1, &align, &fixed) == NULL)
+      || (fixed == 0) || (type[1] == '(') || (type[1] == '{'))
+    {
+      wire->failed = TRUE;
+      return;
+    } // if it's not an array of basic fixed-size elements
+
+  loudbus_wire_pad (wire, align);
+  g_byte_array_append (wire->data, data, n * fixed);
+  loudbus_wire_done (wire, type);
+} // loudbus_wire_add_fixed_array
+
+/**
+ * Start writing the next member, which is an array, an element at a
+ * time.  Arrays don't nest.
+ */
+void
+loudbus_wire_open_array (LouDBusWire *wire)
+{
+  const gchar *type;    // The type of the array
+  int align;            // Its alignment
+  gsize fixed;          // Its fixed size (always 0)
+
+  type = loudbus_wire_next (wire);
+  if ((type == NULL) || wire->open || (type[0] != 'a'))
+    {
+      wire->failed = TRUE;
+      return;
+    } // if it's not an array
+
+  loudbus_wire_info (type, &align, &fixed);
+  loudbus_wire_pad (wire, align);
+  wire->array = wire->data->len;
+  g_array_set_size (wire->elements, 0);
+  wire->open = TRUE;
+} // loudbus_wire_open_array
+
+/**
+ * Finish the array we're writing.
+ */
+void
+loudbus_wire_close_array (LouDBusWire *wire)
+{
+  if (wire->failed || (! wire->open))
+    {
+      wire->failed = TRUE;
+      return;
+    } // if there's no array
+  loudbus_wire_frame (wire, wire->array, wire->elements, FALSE);
+  wire->open = FALSE;
+  loudbus_wire_done (wire, wire->members[wire->member]);
+} // loudbus_wire_close_array
+
+/**
+ * Write the next value, of any type, by copying the serialized form
+ * of a GVariant, which must have the same type.
+ */
+void
+loudbus_wire_add_value (LouDBusWire *wire, GVariant *value)
+{
+  const gchar *type;    // The type of the next value
+  const gchar *vtype;   // The type of the value we have
+  const gchar *end;     // The end of type
+  int align;            // Its alignment
+  gsize fixed;          // Its fixed size
+  gsize size;           // Its serialized size
+
+  type = loudbus_wire_next (wire);
+  vtype = g_variant_get_type_string (value);
+  end = (type == NULL) ? NULL : loudbus_wire_info (type, &align, &fixed);
+  if ((end == NULL) || (strlen (vtype) != (gsize) (end - type))
+      || (strncmp (type, vtype, end - type) != 0))
+    {
+      wire->failed = TRUE;
+      return;
+    } // if it has the wrong type
+
+  size = g_variant_get_size (value);
+  loudbus_wire_pad (wire, align);
+  g_byte_array_append (wire->data, g_variant_get_data (value), size);
+  loudbus_wire_done (wire, type);
+} // loudbus_wire_add_value
+
+/**
+ * Finish the tuple.  Returns it as a floating GVariant, or NULL if
+ * the values didn't match the types, in which case the caller builds
+ * the tuple some other way.
+ */
+GVariant *
+loudbus_wire_end (LouDBusWire *wire)
+{
+  static const guint8 zero = 0;
+  GBytes *bytes;        // The tuple, for GLib
+  GVariant *result;     // The tuple, as a GVariant
+
+  if (wire->failed || wire->open || (wire->member != wire->nmembers))
+    return NULL;
+
+  if (wire->nmembers == 0)
+    g_byte_array_append (wire->data, &zero, 1);
+  else if (wire->fixed > 0)
+    loudbus_wire_pad (wire, wire->align);
+  else
+    loudbus_wire_frame (wire, 0, wire->ends, TRUE);
+
+  bytes = g_bytes_new (wire->data->data, wire->data->len);
+  result = g_variant_new_from_bytes (G_VARIANT_TYPE (wire->type->str),
+                                     bytes, FALSE);
+  g_bytes_unref (bytes);
+  return result;
+} // loudbus_wire_end
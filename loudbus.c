@@ -33,6 +33,10 @@
   It's hard to debug automatically annotated code, so we've done our
   best to annotate it manually.
 
+* This file is the glue between the louDBus core (loudbus-core.c),
+  which only depends on GLib, and the "Inside Racket" API of Racket
+  BC.  Racket CS uses the same core through the FFI; see loudbus-cs.rkt.
+
 * This implementation is incomplete.  We expect to add other methods
   (and support for other types) in the future.
 
@@ -45,7 +49,7 @@
 #include <stdlib.h>     // For malloc, random and such
 #include <stdio.h>      // We use fprintf for error messages during
                         // development.
-#include <time.h>       // For seeing our random number generator
+#include <string.h>     // For memcpy
 
 #include <glib.h>       // For various glib stuff.
 #include <gio/gio.h>    // For the GDBus functions.
@@ -53,45 +57,46 @@
 #include <escheme.h>    // For all the fun Scheme stuff
 #include <scheme.h>     // For more fun Scheme stuff
 
-
+#include "loudbus-core.h"       // Proxies, interfaces, and such
+
+
 // +--------+---------------------------------------------------------
 // | Macros |
 // +--------+
 
 #ifdef VERBOSE
-#define LOG(FORMAT, ARGS...) \
-  do { \
-    fprintf (stderr, "\t *** "); \
-    fprintf (stderr, FORMAT, ## ARGS); \
-    fprintf (stderr, "\n"); \
-  } while (0)
 #define SCHEME_LOG(MSG,OBJ) loudbus_log_scheme_object (MSG, OBJ)
 #else
-#define LOG(FORMAT, ARGS...) do { } while (0)
 #define SCHEME_LOG(MSG,OBJ) do { } while (0)
 #endif
 
-
-// +-------+----------------------------------------------------------
-// | Types |
-// +-------+
+/**
+ * The longest shape we compute for a variant (see scheme_object_shape).
+ * Deeper values skip the cache.
+ */
+#define LOUDBUS_SHAPE_MAX 32
 
 /**
- * The information we store for a proxy.  In addition to the main
- * proxy, we also need information on the proxy, so that we can
- * look up information.
+ * The most variant types we remember.
  */
-struct LouDBusProxy
-  {
-    int signature;              // Identifies this as a proxy
-    GDBusProxy *proxy;          // The real proxy
-    GDBusNodeInfo *ninfo;       // Information on the proxy
-    GDBusInterfaceInfo *iinfo;  // Information on the interace, used
-                                // to extract info about param. types
-  };
-typedef struct LouDBusProxy LouDBusProxy;
+#define LOUDBUS_VARIANT_TYPES_MAX 256
+
+/**
+ * The smallest argument (in bytes, for byte strings, or elements, for
+ * lists and vectors) that the memo of encoded arguments keeps, unless
+ * told otherwise.  Converting smaller ones is cheaper than finding them.
+ */
+#define LOUDBUS_MEMO_MIN 4096
+
+/**
+ * How we encode the parameters of calls (see loudbus-wire-config!):
+ * with a GVariant builder, directly, or both, comparing the results.
+ */
+#define LOUDBUS_WIRE_OFF 0
+#define LOUDBUS_WIRE_ON 1
+#define LOUDBUS_WIRE_CHECK 2
+
 
-
 // +---------+--------------------------------------------------------
 // | Globals |
 // +---------+
@@ -101,7 +106,66 @@ typedef struct LouDBusProxy LouDBusProxy;
  */
 static Scheme_Object *LOUDBUS_PROXY_TAG;
 
-
+/**
+ * The procedure that builds the values loudbus-try-call returns when
+ * a call fails.  Given the name of the error (a symbol) and its code.
+ */
+static Scheme_Object *LOUDBUS_ERROR_MAKER = NULL;
+
+/**
+ * A Scheme object to tag tickets for asynchronous calls.
+ */
+static Scheme_Object *LOUDBUS_TICKET_TAG = NULL;
+
+/**
+ * A Scheme object to tag byte arrays spilled to mapped files.
+ */
+static Scheme_Object *LOUDBUS_SPILL_TAG = NULL;
+
+/**
+ * The types we've inferred for variants, indexed by shape.
+ */
+static GHashTable *loudbus_variant_types = NULL;
+
+/**
+ * The catalogues of the interfaces we've been asked about, indexed by
+ * the digests of the interfaces (see loudbus_catalogue).
+ */
+static Scheme_Hash_Table *loudbus_catalogues = NULL;
+
+/**
+ * The procedure that hears where the time in sampled calls went (see
+ * loudbus-observe-calls!), or #f, and how often we sample.  We sample
+ * the call when the countdown reaches 0.
+ */
+static Scheme_Object *loudbus_call_observer = NULL;
+static int loudbus_observe_every = 1;
+static int loudbus_observe_countdown = 1;
+
+/**
+ * The memo of encoded arguments (see loudbus-memo-config!): a weak
+ * table from immutable Racket values to the GVariants we built for
+ * them, wrapped with LOUDBUS_MEMO_TAG.  It holds at most
+ * loudbus_memo_limit entries (0 turns it off) and only values of at
+ * least loudbus_memo_min bytes or elements.  loudbus_memo_count
+ * counts what we've added since we last started it over.  The table
+ * holds its values strongly, so the GVariant for a value that has
+ * been collected goes only when we start over.
+ */
+static Scheme_Object *LOUDBUS_MEMO_TAG = NULL;
+static Scheme_Bucket_Table *loudbus_memo = NULL;
+static int loudbus_memo_limit = 0;
+static int loudbus_memo_min = LOUDBUS_MEMO_MIN;
+static int loudbus_memo_count = 0;
+
+/**
+ * The direct encoder of parameters, which every call reuses, and the
+ * way we encode them (one of the LOUDBUS_WIRE modes).
+ */
+static LouDBusWire *loudbus_wire = NULL;
+static int loudbus_wire_mode = LOUDBUS_WIRE_OFF;
+
+
 // +--------------------------+---------------------------------------
 // | Selected Predeclarations |
 // +--------------------------+
@@ -110,19 +174,19 @@ static Scheme_Object *loudbus_call_with_closure (int argc,
                                                  Scheme_Object **argv, 
                                                  Scheme_Object *prim);
 
-static void loudbus_proxy_free (LouDBusProxy *proxy);
-
-static int g_dbus_method_info_num_formals (GDBusMethodInfo *method);
-
 static GVariant *scheme_object_to_parameter (Scheme_Object *obj, gchar *type);
 
 static LouDBusProxy *scheme_object_to_proxy (Scheme_Object *obj);
 
+static LouDBusTicket *scheme_object_to_ticket (Scheme_Object *obj);
+
+static Scheme_Object *scheme_make_spill (LouDBusSpill *spill);
+
 static char *scheme_object_to_string (Scheme_Object *scmval);
 
-static int loudbus_proxy_validate (LouDBusProxy *proxy);
+static gchar *scheme_object_to_arena_string (Scheme_Object *scmval);
+
 
-
 // +---------------------------------------+--------------------------
 // | Bridges Between LouDBusProxy and Racket |
 // +---------------------------------------+
@@ -139,6 +203,57 @@ loudbus_proxy_finalize (void *p, void *data)
   loudbus_proxy_free (proxy);
 } // loudbus_proxy_finalize
 
+/**
+ * Finalize a ticket.
+ */
+static void
+loudbus_ticket_finalize (void *p, void *data)
+{
+  LouDBusTicket *ticket;
+  ticket = scheme_object_to_ticket (p);
+  if (ticket != NULL)
+    loudbus_ticket_unref (ticket);
+} // loudbus_ticket_finalize
+
+/**
+ * Finalize a spilled byte array.
+ */
+static void
+loudbus_spill_finalize (void *p, void *data)
+{
+  loudbus_spill_free (SCHEME_CPTR_VAL ((Scheme_Object *) p));
+} // loudbus_spill_finalize
+
+/**
+ * Finalize an encoded argument from the memo.
+ */
+static void
+loudbus_memo_finalize (void *p, void *data)
+{
+  g_variant_unref (SCHEME_CPTR_VAL ((Scheme_Object *) p));
+} // loudbus_memo_finalize
+
+/**
+ * Determine whether the call behind a ticket has finished.  Used
+ * with scheme_block_until.
+ */
+static int
+loudbus_ticket_ready (Scheme_Object *data)
+{
+  loudbus_wake_drain ();
+  return loudbus_ticket_done (scheme_object_to_ticket (data));
+} // loudbus_ticket_ready
+
+/**
+ * Tell Racket what to wait for when it's waiting for a ticket.  Used
+ * with scheme_block_until.
+ */
+static void
+loudbus_ticket_needs_wakeup (Scheme_Object *data, void *fds)
+{
+  MZ_FD_SET (loudbus_wake_fd (), (fd_set *) scheme_get_fdset (fds, 0));
+} // loudbus_ticket_needs_wakeup
+
 
 // +-----------------+------------------------------------------------
 // | Local Utilities |
@@ -170,77 +285,21 @@ loudbus_log_scheme_object (gchar *msg, Scheme_Object *obj)
 } // loudbus_log_scheme_object
 
 /**
- * Get the signature used to identify LouDBusProxy objects.
- */
-static int
-loudbus_proxy_signature (void)
-{
-  static int signature = 0;     // The signature.
-
-  // Get a non-zero signature.
-  while (signature == 0)
-    {
-      signature = random ();
-    } // while (signature == 0)
-
-  return signature;
-} // loudbus_proxy_signature
-
-/**
- * Get information on the proxy.
+ * Signal a Scheme error that explains a GError, freeing the GError.
+ * (The GError may be NULL, in which case we don't know why.)
  */
-static GDBusNodeInfo *
-g_dbus_proxy_get_node_info (GDBusProxy *proxy)
+static void
+loudbus_signal_gerror (gchar *who, gchar *what, GError *error)
 {
-  GError *error;                // Error returned by various functions.
-  GVariant *response;           // The response from the proxy call.
-  GDBusNodeInfo *info;          // Information on the node.
-  const gchar *xml;             // XML code for the proxy interface.
-
-  // Get the introspection data
-  error = NULL;
-  response = 
-    g_dbus_proxy_call_sync (proxy, 
-                            "org.freedesktop.DBus.Introspectable.Introspect",
-                            NULL, 
-                            G_DBUS_CALL_FLAGS_NONE,
-                            -1,
-                            NULL,
-                            &error);
-  if (response == NULL)
-    {
-      return NULL;
-    } // if (response == NULL)
-
-  // Get the XML from the introspection data
-  g_variant_get (response, "(&s)", &xml);
+  gchar message[256];   // A copy of the message, since we free error
 
-  // Build an object that lets us explore the introspection data.
-  error = NULL;
-  info = g_dbus_node_info_new_for_xml (xml, &error);
-  g_variant_unref (response);
-  if (info == NULL)
-    {
-      return NULL;
-    } // if (info == NULL)
-
-  // And return that object
-  return info;
-} // g_dbus_proxy_get_node_info
+  if (error == NULL)
+    scheme_signal_error ("%s: %s for an unknown reason.", who, what);
 
-/**
- * Determine the length of a null-terminated array of pointers.
- */
-static int
-parray_len (gpointer *arr)
-{
-  int i;                // Index into the array
-  if (arr == NULL)
-    return 0;
-  for (i = 0; arr[i] != NULL; i++)
-    ;
-  return i;
-} // parray_len
+  g_strlcpy (message, error->message, sizeof (message));
+  g_error_free (error);
+  scheme_signal_error ("%s: %s because %s", who, what, message);
+} // loudbus_signal_gerror
 
 /**
  * Register a scheme function.  Provides a slightly more concise interface
@@ -271,121 +330,6 @@ score_it_all (gchar *str)
 } // score_it_all
 
 
-// +-----------------+------------------------------------------------
-// | Proxy Functions |
-// +-----------------+
-
-/**
- * Free one of the allocated proxies.
- */
-void
-loudbus_proxy_free (LouDBusProxy *proxy)
-{
-  // Sanity check 1.  Make sure that it's not NULL.
-  if (proxy == NULL)
-    return;
-
-  // Sanity check 2.  Make sure that it's really an LouDBusProxy.
-  if (! loudbus_proxy_validate (proxy))
-    return;
- 
-  // Clear the signature (so that we don't identify this as a
-  // LouDBusProxy in the future).
-  proxy->signature = 0;
-
-  // Clear the proxy.
-  if (proxy->proxy != NULL)
-    {
-      g_object_unref (proxy->proxy);
-      proxy->proxy = NULL;
-    } // if (proxy->proxy != NULL)
-
-  // Clear the node information.
-  if (proxy->ninfo != NULL)
-    {
-      g_dbus_node_info_unref (proxy->ninfo);
-      proxy->ninfo = NULL;
-    } // if (proxy->ninfo != NULL)
-
-  // Clear the interface information
-  proxy->iinfo = NULL;  // Part of the node info, so not freed separately.
-
-  // And free the enclosing structure
-  g_free (proxy);
-} // loudbus_proxy_free
-
-LouDBusProxy *
-loudbus_proxy_new (gchar *service, gchar *object, gchar *interface, 
-                   GError **errorp)
-{
-  LouDBusProxy *proxy;         // The proxy we're creating
-
-  // Allocate space for the struct.
-  proxy = g_malloc0 (sizeof (LouDBusProxy));
-  if (proxy == NULL)
-    {
-      LOG ("loudbus_proxy_new: Could not allocate proxy.");
-      return NULL;
-    } // if (proxy == NULL)
-
-  LOG ("Creating proxy for (%s,%s,%s)", service, object, interface);
-  proxy->proxy = g_dbus_proxy_new_for_bus_sync (G_BUS_TYPE_SESSION,
-                                                G_DBUS_PROXY_FLAGS_NONE,
-                                                NULL,
-                                                service,
-                                                object,
-                                                interface,
-                                                NULL,
-                                                errorp);
-  if (proxy->proxy == NULL)
-    {
-      LOG ("loudbus_proxy_new: Could not build proxy.");
-      g_free (proxy);
-      return NULL;
-    } // if we failed to create the proxy.
-
-  // Get the node information
-  proxy->ninfo = g_dbus_proxy_get_node_info (proxy->proxy);
-  if (proxy->ninfo == NULL)
-    {
-      LOG ("loudbus_proxy_new: Could not get node info.");
-      g_object_unref (proxy->proxy);
-      g_free (proxy);
-      return NULL;
-    } // if we failed to get node information
-
-  // Get the interface information
-  proxy->iinfo = g_dbus_node_info_lookup_interface(proxy->ninfo, interface);
-  if (proxy->iinfo == NULL)
-    {
-      LOG ("loudbus_proxy_new: Could not get interface info.");
-      g_object_unref (proxy->proxy);
-      g_dbus_node_info_unref (proxy->ninfo);
-      g_free (proxy);
-      return NULL;
-    } // if we failed to get interface information
-
-  // We will be looking stuff up in the interface, so build a cache
-  g_dbus_interface_info_cache_build (proxy->iinfo);
-
-  // Set the signature
-  proxy->signature = loudbus_proxy_signature ();
-
-  // And we seem to be done
-  return proxy;
-} // loudbus_proxy_new
-
-int
-loudbus_proxy_validate (LouDBusProxy *proxy)
-{
-  // Sanity check.  We don't want segfaults.
-  if (proxy == NULL)
-    return 0;
-
-  // Things are only proxies if they contain the magic signature.
-  return (proxy->signature == loudbus_proxy_signature ());
-} // loudbus_proxy_validate
-
 
 // +-----------------+------------------------------------------------
 // | Type Conversion |
@@ -408,6 +352,8 @@ dbus_signature_to_string (gchar *signature)
               return "list/vector of strings";
             case 'y':
               return "bytes";
+            case '{':
+              return "hash";
             default:
               return signature;
           } // inner switch
@@ -417,11 +363,86 @@ dbus_signature_to_string (gchar *signature)
         return "string";
       case 'y':
         return "byte";
+      case 'v':
+        return "number, string, bytes, boolean, list, vector, or hash";
       default:
         return signature;
     } // switch
 } // dbus_signature_to_string
 
+/**
+ * Convert one cell of a flat array to a Scheme object.
+ */
+static Scheme_Object *
+scheme_make_flat_cell (LouDBusFlat *flat, const gchar *types, int c, 
+                       gsize r)
+{
+  const guchar *data;   // The data the strings point into
+  const gsize *span;    // The place of a string in that data
+  gsize size;           // The size of the data
+
+  switch (types[c])
+    {
+      case 'i':
+        return scheme_make_integer 
+                 (((const gint32 *) loudbus_flat_column (flat, c))[r]);
+      case 'd':
+        return scheme_make_double 
+                 (((const gdouble *) loudbus_flat_column (flat, c))[r]);
+      default:
+        data = loudbus_flat_data (flat, &size);
+        span = (const gsize *) loudbus_flat_column (flat, c) + 2*r;
+        return scheme_make_sized_utf8_string ((char *) data + span[0], 
+                                              span[1]);
+    } // switch
+} // scheme_make_flat_cell
+
+/**
+ * Convert a flat array to a list (of lists, if the elements are
+ * structs).  The hard work has already been done on the pool; we
+ * just build the objects.
+ */
+static Scheme_Object *
+scheme_make_flat_list (LouDBusFlat *flat)
+{
+  const gchar *types;           // The types of the columns
+  gboolean tuple;               // Are the elements structs?
+  int width;                    // The number of columns
+  gsize r;                      // One row
+  int c;                        // One column
+  Scheme_Object *lst = NULL;    // The list we build
+  Scheme_Object *row = NULL;    // One element, as a list
+  Scheme_Object *sval = NULL;   // One value
+
+  MZ_GC_DECL_REG (3);
+  MZ_GC_VAR_IN_REG (0, lst);
+  MZ_GC_VAR_IN_REG (1, row);
+  MZ_GC_VAR_IN_REG (2, sval);
+  MZ_GC_REG ();
+
+  types = loudbus_flat_types (flat, &tuple);
+  width = strlen (types);
+  lst = scheme_null;
+  for (r = loudbus_flat_rows (flat); r-- > 0; )
+    {
+      if (! tuple)
+        row = scheme_make_flat_cell (flat, types, 0, r);
+      else
+        {
+          row = scheme_null;
+          for (c = width - 1; c >= 0; c--)
+            {
+              sval = scheme_make_flat_cell (flat, types, c, r);
+              row = scheme_make_pair (sval, row);
+            } // for each column
+        } // if the elements are structs
+      lst = scheme_make_pair (row, lst);
+    } // for each row
+
+  MZ_GC_UNREG ();
+  return lst;
+} // scheme_make_flat_list
+
 /**
  * Convert a GVariant to a Scheme object.  Returns NULL if there's a
  * problem.
@@ -436,6 +457,8 @@ g_variant_to_scheme_object (GVariant *gv)
   Scheme_Object *lst = NULL;    // A list that we build as a result
   Scheme_Object *sval = NULL;   // One value
   Scheme_Object *result = NULL; // One result to return.
+  GVariant *child;              // One child of a tuple or array
+  LouDBusFlat *flat;            // A large array, decoded in parallel
 
   // Special case: We'll treat NULL as void.
   if (gv == NULL)
@@ -473,26 +496,51 @@ g_variant_to_scheme_object (GVariant *gv)
   if (g_variant_type_equal (type, G_VARIANT_TYPE_STRING))
     {
       // We don't refer to any Scheme objects across allocating calls,
-      // so no need for GC code.
+      // so no need for GC code.  D-Bus strings are always UTF-8,
+      // whatever the locale, and scheme_make_flat_cell decodes the
+      // strings of large arrays the same way.
       const gchar *str;
-      str = g_variant_get_string (gv, NULL);
-      result = scheme_make_locale_string (str);
+      gsize len;
+      str = g_variant_get_string (gv, &len);
+      result = scheme_make_sized_utf8_string ((char *) str, len);
       return result;
     } // if it's a string
 
   // ** Handle some special cases **
 
-  // We treat arrays of bytes as bytestrings
+  // We treat arrays of bytes as bytestrings, unless they're so big
+  // that we map them from a file instead.
   if (g_strcmp0 (typestring, "ay") == 0)
     {
       gsize size;
       guchar *data;
+      gsize threshold;
+      LouDBusSpill *spill;
       data = (guchar *) g_variant_get_fixed_array (gv, &size, sizeof (guchar));
+      threshold = loudbus_spill_threshold ();
+      if ((threshold > 0) && (size >= threshold))
+        {
+          spill = loudbus_spill_new (gv, NULL);
+          if (spill != NULL)
+            return scheme_make_spill (spill);
+        } // if the array is big enough to spill
       return scheme_make_sized_byte_string ((char *) data, size, 1);
     } // if it's an array of bytes
 
   // ** Handle the compound types ** 
 
+  // Large arrays of simple things get decoded on the pool.
+  if (g_variant_type_is_array (type))
+    {
+      flat = loudbus_flat_decode (gv);
+      if (flat != NULL)
+        {
+          result = scheme_make_flat_list (flat);
+          loudbus_flat_unref (flat);
+          return result;
+        } // if we decoded the array
+    } // if it's an array
+
   // Tuple or Array
   if ( (g_variant_type_is_tuple (type))
        || (g_variant_type_is_array (type)) )
@@ -513,7 +561,9 @@ g_variant_to_scheme_object (GVariant *gv)
       // Step through the items, right to left, adding them to the list.
       for (i = len-1; i >= 0; i--)
         {
-          sval = g_variant_to_scheme_object (g_variant_get_child_value (gv, i));
+          child = g_variant_get_child_value (gv, i);
+          sval = g_variant_to_scheme_object (child);
+          g_variant_unref (child);
           lst = scheme_make_pair (sval, lst);
         } // for
 
@@ -536,82 +586,336 @@ g_variant_to_scheme_object (GVariant *gv)
 } // g_variant_to_scheme_object
 
 /**
- * Convert a Scheme list or vector to a GVariant that represents an array.
+ * Convert a Scheme number to a double.  Returns 0 if it cannot.
  */
-static GVariant *
-scheme_object_to_array (Scheme_Object *lv, gchar *type)
+static int
+scheme_object_to_double (Scheme_Object *obj, double *d)
 {
-  Scheme_Object *sval;  // One element of the list/array
-  GVariant *gval;       // The converted element
-  GVariantBuilder *builder;
+  if (SCHEME_DBLP (obj))
+    *d = SCHEME_DBL_VAL (obj);
+  else if (SCHEME_FLTP (obj))
+    *d = (double) SCHEME_FLT_VAL (obj);
+  else if (SCHEME_INTP (obj))
+    *d = (double) SCHEME_INT_VAL (obj);
+  else if (SCHEME_RATIONALP (obj))
+    *d = (double) scheme_rational_to_double (obj);
+  else
+    return 0;
+  return 1;
+} // scheme_object_to_double
 
-  // Special case: The empty list gives the empty array.
-  if (SCHEME_NULLP (lv))
+/**
+ * Convert a Scheme number to a 32-bit integer.  Returns 0 if it cannot.
+ */
+static int
+scheme_object_to_int32 (Scheme_Object *obj, gint32 *i)
+{
+  if (SCHEME_INTP (obj))
+    *i = (int) SCHEME_INT_VAL (obj);
+  else if (SCHEME_DBLP (obj))
+    *i = (int) SCHEME_DBL_VAL (obj);
+  else if (SCHEME_FLTP (obj))
+    *i = (int) SCHEME_FLT_VAL (obj);
+  else if (SCHEME_RATIONALP (obj))
+    *i = (int) scheme_rational_to_double (obj);
+  else
+    return 0;
+  return 1;
+} // scheme_object_to_int32
+
+/**
+ * Convert one Scheme object to a fixed-size D-Bus value of the given
+ * type, storing the value at dest.  Returns 0 if it cannot.
+ */
+static int
+scheme_object_to_fixed_element (Scheme_Object *obj, gchar type, 
+                                gpointer dest)
+{
+  switch (type)
     {
-      // Note: For individual objects, D-Bus type signatures are acceptable
-      // as GVariant type strings.
-      builder = g_variant_builder_new ((GVariantType *) type);
-      if (builder == NULL)
-        return NULL;
-      return g_variant_builder_end (builder);
-    } // if it's null
+      case 'd':
+        return scheme_object_to_double (obj, (double *) dest);
+      case 'i':
+        return scheme_object_to_int32 (obj, (gint32 *) dest);
+      case 'u':
+        if (! SCHEME_INTP (obj))
+          return 0;
+        *((guint32 *) dest) = (guint32) SCHEME_INT_VAL (obj);
+        return 1;
+      case 'x':
+        return SCHEME_EXACT_INTEGERP (obj)
+               && scheme_get_long_long_val (obj, (long long *) dest);
+      case 'y':
+        if ((! SCHEME_INTP (obj)) 
+            || (SCHEME_INT_VAL (obj) < 0) 
+            || (SCHEME_INT_VAL (obj) > 255))
+          return 0;
+        *((guchar *) dest) = (guchar) SCHEME_INT_VAL (obj);
+        return 1;
+      default:
+        return 0;
+    } // switch
+} // scheme_object_to_fixed_element
 
-  // A list, or so we think.
-  if (SCHEME_PAIRP (lv))
+/**
+ * Convert a Scheme list or vector to a buffer in the scratch arena that
+ * holds an array of fixed-size values of the given type (e.g., "ai" or
+ * "ad"), setting *lenp and *elsizep.  Returns NULL if it cannot convert.
+ */
+static guchar *
+scheme_object_to_fixed_buffer (Scheme_Object *lv, gchar *type,
+                               int *lenp, gsize *elsizep)
+{
+  Scheme_Object *sval;  // One element of the list/vector
+  gsize elsize;         // The size of one element
+  guchar *buf;          // The elements, in D-Bus form
+  int len;              // The number of elements
+  int i;                // Counter variable
+
+  // Figure out how big each element is.
+  switch (type[1])
     {
-      builder = g_variant_builder_new ((GVariantType *) type);
-      if (builder == NULL)
+      case 'd':
+        elsize = sizeof (double);
+        break;
+      case 'i':
+        elsize = sizeof (gint32);
+        break;
+      case 'u':
+        elsize = sizeof (guint32);
+        break;
+      case 'x':
+        elsize = sizeof (gint64);
+        break;
+      case 'y':
+        elsize = sizeof (guchar);
+        break;
+      default:
         return NULL;
-      // Follow the cons cells through the list
-      while (SCHEME_PAIRP (lv))
+    } // switch
+
+  // Figure out how many elements there are.
+  if (SCHEME_VECTORP (lv))
+    len = SCHEME_VEC_SIZE (lv);
+  else
+    len = scheme_proper_list_length (lv);
+  if (len < 0)
+    return NULL;
+
+  // Fill in the buffer
+  buf = loudbus_arena_alloc (&loudbus_scratch, len * elsize);
+  for (i = 0; i < len; i++)
+    {
+      if (SCHEME_VECTORP (lv))
+        sval = SCHEME_VEC_ELS (lv)[i];
+      else
         {
           sval = SCHEME_CAR (lv);
-          gval = scheme_object_to_parameter (sval, type+1);
-          if (gval == NULL)
-            {
-              g_variant_builder_unref (builder);
-              return NULL;
-            } // if (gval == NULL)
-          g_variant_builder_add_value (builder, gval);
           lv = SCHEME_CDR (lv);
-        } // while
-
-      // We've reached the end.  Was it really a list?
-      if (! SCHEME_NULLP (lv))
-        {
-          g_variant_builder_unref (builder);
-          return NULL;
-        } // If the list does not end in null, so it's not a list.
+        } // if it's a list
+      if (! scheme_object_to_fixed_element (sval, type[1], buf + i*elsize))
+        return NULL;
+    } // for each element
 
-      // We've hit the null at the end of the list.
-      return g_variant_builder_end (builder);
-    } // if it's a list
+  *lenp = len;
+  *elsizep = elsize;
+  return buf;
+} // scheme_object_to_fixed_buffer
 
-  // A vector
-  else if (SCHEME_VECTORP (lv))
-    {
-      int len = SCHEME_VEC_SIZE (lv);
-      int i;
+/**
+ * Convert a Scheme list or vector to a GVariant that represents an array
+ * of fixed-size values (e.g., "ai" or "ad").  We fill a buffer in the
+ * scratch arena and let GLib copy it, rather than building a GVariant
+ * for each element.  Returns NULL if it cannot convert.
+ */
+static GVariant *
+scheme_object_to_fixed_array (Scheme_Object *lv, gchar *type)
+{
+  guchar *buf;          // The elements, in D-Bus form
+  int len;              // The number of elements
+  gsize elsize;         // The size of one element
 
-      LOG ("scheme_object_to_array: Handling a vector of length %d", len);
+  buf = scheme_object_to_fixed_buffer (lv, type, &len, &elsize);
+  if (buf == NULL)
+    return NULL;
+  return g_variant_new_fixed_array ((GVariantType *) (type + 1),
+                                    buf, len, elsize);
+} // scheme_object_to_fixed_array
 
-      builder = g_variant_builder_new (G_VARIANT_TYPE_ARRAY);
-      if (builder == NULL)
-        return NULL;
+/**
+ * Step through the entries of a hash table.  Start with pos = -1; each
+ * call fills in key and val and returns the position to pass next
+ * time, or -1 when there are no more entries.
+ */
+static intptr_t
+scheme_hash_iterate (Scheme_Object *hash, intptr_t pos,
+                     Scheme_Object **key, Scheme_Object **val)
+{
+  Scheme_Hash_Table *table;     // A mutable hash table
 
-      for (i = 0; i < len; i++)
+  if (SCHEME_HASHTP (hash))
+    {
+      table = (Scheme_Hash_Table *) hash;
+      for (pos++; pos < table->size; pos++)
         {
-          sval = SCHEME_VEC_ELS(lv)[i];
+          if (table->vals[pos] != NULL)
+            {
+              *key = table->keys[pos];
+              *val = table->vals[pos];
+              return pos;
+            } // if there's an entry at pos
+        } // for each slot
+      return -1;
+    } // if it's a mutable hash table
+
+  if (SCHEME_HASHTRP (hash))
+    {
+      pos = scheme_hash_tree_next ((Scheme_Hash_Tree *) hash, pos);
+      if (pos >= 0)
+        scheme_hash_tree_index ((Scheme_Hash_Tree *) hash, pos, key, val);
+      return pos;
+    } // if it's an immutable hash table
+
+  return -1;
+} // scheme_hash_iterate
+
+/**
+ * Convert a Scheme hash table to a GVariant that represents a
+ * dictionary (e.g., "a{sv}").  Returns NULL if it cannot convert.
+ */
+static GVariant *
+scheme_object_to_dict (Scheme_Object *hash, gchar *type)
+{
+  Scheme_Object *key = NULL;    // One key
+  Scheme_Object *val = NULL;    // Its value
+  GVariant *gkey;               // The converted key
+  GVariant *gval;               // The converted value
+  const gchar *end;             // The end of the type
+  gchar *keytype;               // The type of the keys
+  gchar *valtype;               // The type of the values
+  intptr_t pos;                 // Where we are in the table
+  GVariantBuilder builder;      // Something to let us build dictionaries
+
+  if ((! SCHEME_HASHTP (hash)) && (! SCHEME_HASHTRP (hash)))
+    return NULL;
+  if (! g_variant_type_string_scan (type + 1, NULL, &end))
+    return NULL;
+
+  // type is "a{kv}", so the key is one character and the value is the
+  // rest, up to the closing brace.
+  keytype = loudbus_arena_strndup (&loudbus_scratch, type + 2, 1);
+  valtype = loudbus_arena_strndup (&loudbus_scratch, type + 3,
+                                   (end - 1) - (type + 3));
+
+  MZ_GC_DECL_REG (3);
+  MZ_GC_VAR_IN_REG (0, hash);
+  MZ_GC_VAR_IN_REG (1, key);
+  MZ_GC_VAR_IN_REG (2, val);
+  MZ_GC_REG ();
+
+  g_variant_builder_init (&builder, (GVariantType *) type);
+  for (pos = scheme_hash_iterate (hash, -1, &key, &val);
+       pos >= 0;
+       pos = scheme_hash_iterate (hash, pos, &key, &val))
+    {
+      gkey = scheme_object_to_parameter (key, keytype);
+      gval = (gkey == NULL) ? NULL : scheme_object_to_parameter (val, valtype);
+      if (gval == NULL)
+        {
+          if (gkey != NULL)
+            g_variant_unref (g_variant_ref_sink (gkey));
+          g_variant_builder_clear (&builder);
+          MZ_GC_UNREG ();
+          return NULL;
+        } // if we could not convert the entry
+      g_variant_builder_add_value (&builder,
+                                   g_variant_new_dict_entry (gkey, gval));
+    } // for each entry
+
+  MZ_GC_UNREG ();
+  return g_variant_builder_end (&builder);
+} // scheme_object_to_dict
+
+/**
+ * Convert a Scheme list or vector to a GVariant that represents an array.
+ */
+static GVariant *
+scheme_object_to_array (Scheme_Object *lv, gchar *type)
+{
+  Scheme_Object *sval;  // One element of the list/array
+  GVariant *gval;       // The converted element
+  GVariantBuilder builder;
+                        // Something to let us build arrays
+
+  // Arrays of fixed-size values skip the per-element GVariants.
+  if ((strchr ("diuxy", type[1]) != NULL) && (type[2] == '\0'))
+    return scheme_object_to_fixed_array (lv, type);
+
+  // Dictionaries come from hash tables.
+  if (type[1] == '{')
+    return scheme_object_to_dict (lv, type);
+
+  // Special case: The empty list gives the empty array.
+  if (SCHEME_NULLP (lv))
+    {
+      // Note: For individual objects, D-Bus type signatures are acceptable
+      // as GVariant type strings.
+      g_variant_builder_init (&builder, (GVariantType *) type);
+      return g_variant_builder_end (&builder);
+    } // if it's null
+
+  // A list, or so we think.
+  if (SCHEME_PAIRP (lv))
+    {
+      g_variant_builder_init (&builder, (GVariantType *) type);
+      // Follow the cons cells through the list
+      while (SCHEME_PAIRP (lv))
+        {
+          sval = SCHEME_CAR (lv);
+          gval = scheme_object_to_parameter (sval, type+1);
+          if (gval == NULL)
+            {
+              g_variant_builder_clear (&builder);
+              return NULL;
+            } // if (gval == NULL)
+          g_variant_builder_add_value (&builder, gval);
+          lv = SCHEME_CDR (lv);
+        } // while
+
+      // We've reached the end.  Was it really a list?
+      if (! SCHEME_NULLP (lv))
+        {
+          g_variant_builder_clear (&builder);
+          return NULL;
+        } // If the list does not end in null, so it's not a list.
+
+      // We've hit the null at the end of the list.
+      return g_variant_builder_end (&builder);
+    } // if it's a list
+
+  // A vector
+  else if (SCHEME_VECTORP (lv))
+    {
+      int len = SCHEME_VEC_SIZE (lv);
+      int i;
+
+      LOG ("scheme_object_to_array: Handling a vector of length %d", len);
+
+      g_variant_builder_init (&builder, (GVariantType *) type);
+
+      for (i = 0; i < len; i++)
+        {
+          sval = SCHEME_VEC_ELS(lv)[i];
           gval = scheme_object_to_parameter (sval, type + 1);
           if (gval == NULL)
             {
-              g_variant_builder_unref (builder);
+              g_variant_builder_clear (&builder);
               return NULL;
             } // if we could not convert the object
-          g_variant_builder_add_value (builder, gval);
+          g_variant_builder_add_value (&builder, gval);
         } // for each index
 
-      return g_variant_builder_end (builder);
+      return g_variant_builder_end (&builder);
     } // if it's a vector
 
   // Can only convert lists and vectors.
@@ -619,6 +923,331 @@ scheme_object_to_array (Scheme_Object *lv, gchar *type)
     return NULL;
 } // scheme_object_to_array
 
+/**
+ * The code for a Scheme value that needs no container type: 'i', 'x',
+ * 'd', 's', 'y' (for byte strings, which become "ay"), or 'b'.
+ * Returns 0 for anything else.
+ */
+static gchar
+scheme_object_scalar_code (Scheme_Object *obj)
+{
+  long long ll;         // A temporary integer
+
+  if (SCHEME_INTP (obj))
+    return ((SCHEME_INT_VAL (obj) >= G_MININT32)
+            && (SCHEME_INT_VAL (obj) <= G_MAXINT32)) ? 'i' : 'x';
+  else if (SCHEME_BIGNUMP (obj))
+    return scheme_get_long_long_val (obj, &ll) ? 'x' : 0;
+  else if (SCHEME_DBLP (obj))
+    return 'd';
+  else if (SCHEME_CHAR_STRINGP (obj) || SCHEME_SYMBOLP (obj))
+    return 's';
+  else if (SCHEME_BYTE_STRINGP (obj))
+    return 'y';
+  else if (SCHEME_BOOLP (obj))
+    return 'b';
+  else
+    return 0;
+} // scheme_object_scalar_code
+
+/**
+ * The code for a key of a dictionary: 's' or 'i'.  Returns 0 for
+ * keys we can't send.
+ */
+static gchar
+scheme_object_key_code (Scheme_Object *obj)
+{
+  gchar code = scheme_object_scalar_code (obj);
+  return ((code == 's') || (code == 'i')) ? code : 0;
+} // scheme_object_key_code
+
+/**
+ * Write the shape of a Scheme value into shape, starting at n.  The
+ * shape is the code of the value, followed (for containers) by the
+ * shape of the first element: 'a' for a non-empty list or vector,
+ * 'e' for an empty one, 'h' plus the code of the first key for a
+ * non-empty hash table, and 'H' for an empty one.  Looking only at
+ * first elements keeps this quick.  Returns the length of the shape,
+ * or -1 if the value has none (or it's too deep).
+ */
+static int
+scheme_object_shape (Scheme_Object *obj, gchar *shape, int n)
+{
+  Scheme_Object *key;   // The first key of a hash table
+  Scheme_Object *val;   // Its value
+  gchar code;           // The code for the value
+
+  if (n >= LOUDBUS_SHAPE_MAX - 2)
+    return -1;
+
+  if ((code = scheme_object_scalar_code (obj)) != 0)
+    {
+      shape[n] = code;
+      return n + 1;
+    } // if it's a scalar
+  else if (SCHEME_NULLP (obj)
+           || (SCHEME_VECTORP (obj) && (SCHEME_VEC_SIZE (obj) == 0)))
+    {
+      shape[n] = 'e';
+      return n + 1;
+    } // if it's an empty list or vector
+  else if (SCHEME_PAIRP (obj))
+    {
+      shape[n] = 'a';
+      return scheme_object_shape (SCHEME_CAR (obj), shape, n + 1);
+    } // if it's a list
+  else if (SCHEME_VECTORP (obj))
+    {
+      shape[n] = 'a';
+      return scheme_object_shape (SCHEME_VEC_ELS (obj)[0], shape, n + 1);
+    } // if it's a vector
+  else if (SCHEME_HASHTP (obj) || SCHEME_HASHTRP (obj))
+    {
+      if (scheme_hash_iterate (obj, -1, &key, &val) < 0)
+        {
+          shape[n] = 'H';
+          return n + 1;
+        } // if the table is empty
+      if ((code = scheme_object_key_code (key)) == 0)
+        return -1;
+      shape[n] = 'h';
+      shape[n + 1] = code;
+      return n + 2;
+    } // if it's a hash table
+  else
+    return -1;
+} // scheme_object_shape
+
+/**
+ * Convert a shape to the type of variant it suggests.  The caller
+ * frees the result.
+ */
+static gchar *
+loudbus_shape_to_type (const gchar *shape)
+{
+  GString *type;        // The type we build
+
+  type = g_string_new (NULL);
+  for ( ; *shape == 'a'; shape++)
+    g_string_append_c (type, 'a');
+  switch (*shape)
+    {
+      case 'y':
+        g_string_append (type, "ay");
+        break;
+      case 'e':
+        g_string_append (type, "av");
+        break;
+      case 'H':
+        g_string_append (type, "a{sv}");
+        break;
+      case 'h':
+        g_string_append_printf (type, "a{%cv}", shape[1]);
+        break;
+      default:
+        g_string_append_c (type, *shape);
+        break;
+    } // switch
+  return g_string_free (type, FALSE);
+} // loudbus_shape_to_type
+
+/**
+ * Determine whether a Scheme value really has the given type.  Unlike
+ * conversion, which happily truncates reals to integers, this only
+ * accepts the values that inference would give that type.
+ */
+static int
+scheme_object_fits_type (Scheme_Object *obj, const gchar *type)
+{
+  Scheme_Object *key = NULL;    // A key of a hash table
+  Scheme_Object *val = NULL;    // Its value
+  intptr_t pos;                 // Where we are in the table
+  int len;                      // The length of a list or vector
+  int i;                        // Counter variable
+
+  switch (type[0])
+    {
+      case 'i':
+      case 'x':
+      case 'd':
+      case 's':
+      case 'b':
+        return scheme_object_scalar_code (obj) == type[0];
+      case 'v':
+        return 1;
+      case 'a':
+        if (type[1] == 'y')
+          return SCHEME_BYTE_STRINGP (obj);
+        if (type[1] == '{')
+          {
+            if ((! SCHEME_HASHTP (obj)) && (! SCHEME_HASHTRP (obj)))
+              return 0;
+            for (pos = scheme_hash_iterate (obj, -1, &key, &val);
+                 pos >= 0;
+                 pos = scheme_hash_iterate (obj, pos, &key, &val))
+              if (scheme_object_key_code (key) != type[2])
+                return 0;
+            return 1;
+          } // if it's a dictionary
+        if (SCHEME_VECTORP (obj))
+          {
+            len = SCHEME_VEC_SIZE (obj);
+            for (i = 0; i < len; i++)
+              if (! scheme_object_fits_type (SCHEME_VEC_ELS (obj)[i],
+                                             type + 1))
+                return 0;
+            return 1;
+          } // if it's a vector
+        for ( ; SCHEME_PAIRP (obj); obj = SCHEME_CDR (obj))
+          if (! scheme_object_fits_type (SCHEME_CAR (obj), type + 1))
+            return 0;
+        return SCHEME_NULLP (obj);
+      default:
+        return 0;
+    } // switch
+} // scheme_object_fits_type
+
+/**
+ * Infer the type of a variant by looking at every part of a Scheme
+ * value.  Lists and vectors whose elements differ in type become "av".
+ * Returns NULL if the value has no type.  The result lives in the
+ * scratch arena.
+ */
+static gchar *
+scheme_object_infer_type (Scheme_Object *obj)
+{
+  Scheme_Object *key = NULL;    // A key of a hash table
+  Scheme_Object *val = NULL;    // Its value
+  Scheme_Object *elt;           // An element of a list or vector
+  gchar *first = NULL;          // The type of the first element
+  gchar *type;                  // The type of another element
+  gboolean mixed = FALSE;       // Do the elements differ?
+  gchar code = 0;               // The code for the keys
+  gchar shape[3];               // The shape of a scalar
+  intptr_t pos;                 // Where we are in the table
+  int i;                        // Counter variable
+
+  if (SCHEME_PAIRP (obj) || SCHEME_VECTORP (obj))
+    {
+      for (i = 0; ; i++)
+        {
+          if (SCHEME_VECTORP (obj))
+            {
+              if (i >= SCHEME_VEC_SIZE (obj))
+                break;
+              elt = SCHEME_VEC_ELS (obj)[i];
+            } // if it's a vector
+          else
+            {
+              if (! SCHEME_PAIRP (obj))
+                break;
+              elt = SCHEME_CAR (obj);
+              obj = SCHEME_CDR (obj);
+            } // if it's a list
+          if ((type = scheme_object_infer_type (elt)) == NULL)
+            return NULL;
+          if (first == NULL)
+            first = type;
+          else if (strcmp (first, type) != 0)
+            mixed = TRUE;
+        } // for each element
+      if ((! SCHEME_VECTORP (obj)) && (! SCHEME_NULLP (obj)))
+        return NULL;
+      if ((first == NULL) || mixed)
+        return "av";
+      type = loudbus_arena_alloc (&loudbus_scratch, strlen (first) + 2);
+      type[0] = 'a';
+      strcpy (type + 1, first);
+      return type;
+    } // if it's a list or vector
+
+  if (SCHEME_HASHTP (obj) || SCHEME_HASHTRP (obj))
+    {
+      for (pos = scheme_hash_iterate (obj, -1, &key, &val);
+           pos >= 0;
+           pos = scheme_hash_iterate (obj, pos, &key, &val))
+        {
+          if ((code != 0) && (scheme_object_key_code (key) != code))
+            return NULL;
+          if ((code = scheme_object_key_code (key)) == 0)
+            return NULL;
+        } // for each entry
+      return (code == 'i') ? "a{iv}" : "a{sv}";
+    } // if it's a hash table
+
+  // Everything else is a scalar or the empty list, whose shapes are
+  // their types.
+  if (scheme_object_shape (obj, shape, 0) != 1)
+    return NULL;
+  switch (shape[0])
+    {
+      case 'y':
+        return "ay";
+      case 'e':
+        return "av";
+      default:
+        type = loudbus_arena_alloc (&loudbus_scratch, 2);
+        type[0] = shape[0];
+        type[1] = '\0';
+        return type;
+    } // switch
+} // scheme_object_infer_type
+
+/**
+ * Get the type for a Scheme value sent as a variant.  We look up the
+ * type suggested by the shape of the value, which is quick, and only
+ * fall back to looking at the whole value when the value doesn't
+ * really have that type (e.g., a list whose elements differ).
+ * Returns NULL if the value has no type.
+ */
+static gchar *
+scheme_object_variant_type (Scheme_Object *obj)
+{
+  gchar shape[LOUDBUS_SHAPE_MAX];       // The shape of the value
+  gchar *type = NULL;                   // Its type
+  int len;                              // The length of the shape
+
+  len = scheme_object_shape (obj, shape, 0);
+  if (len > 0)
+    {
+      shape[len] = '\0';
+      if (loudbus_variant_types == NULL)
+        loudbus_variant_types = g_hash_table_new_full (g_str_hash,
+                                                       g_str_equal,
+                                                       g_free, g_free);
+      type = g_hash_table_lookup (loudbus_variant_types, shape);
+      if ((type == NULL)
+          && (g_hash_table_size (loudbus_variant_types)
+              < LOUDBUS_VARIANT_TYPES_MAX))
+        {
+          type = loudbus_shape_to_type (shape);
+          g_hash_table_insert (loudbus_variant_types, g_strdup (shape),
+                               type);
+        } // if we haven't seen the shape
+    } // if the value has a shape
+
+  if ((type != NULL) && scheme_object_fits_type (obj, type))
+    return type;
+  return scheme_object_infer_type (obj);
+} // scheme_object_variant_type
+
+/**
+ * Convert a Scheme value to a variant, inferring its type.  Returns
+ * NULL if it cannot convert.
+ */
+static GVariant *
+scheme_object_to_variant (Scheme_Object *obj)
+{
+  gchar *type;          // The type of the value
+  GVariant *gval;       // The value
+
+  if ((type = scheme_object_variant_type (obj)) == NULL)
+    return NULL;
+  if ((gval = scheme_object_to_parameter (obj, type)) == NULL)
+    return NULL;
+  return g_variant_new_variant (gval);
+} // scheme_object_to_variant
+
 /**
  * Convert a Scheme object to a GVariant that will serve as one of
  * the parameters of a call go g_dbus_proxy_call_....  Returns NULL
@@ -628,6 +1257,9 @@ static GVariant *
 scheme_object_to_parameter (Scheme_Object *obj, gchar *type)
 {
   gchar *str;           // A temporary string
+  double d;             // A temporary double
+  gint32 i;             // A temporary integer
+  long long ll;         // A temporary long integer
 
   // Special case: Array of bytes
   if (g_strcmp0 (type, "ay") == 0) 
@@ -650,50 +1282,87 @@ scheme_object_to_parameter (Scheme_Object *obj, gchar *type)
 
       // Doubles
       case 'd':
-        if (SCHEME_DBLP (obj))
-          return g_variant_new ("d", SCHEME_DBL_VAL (obj));
-        else if (SCHEME_FLTP (obj))
-          return g_variant_new ("d", (double) SCHEME_FLT_VAL (obj));
-        else if (SCHEME_INTP (obj))
-          return g_variant_new ("d", (double) SCHEME_INT_VAL (obj));
-        else if (SCHEME_RATIONALP (obj))
-          return g_variant_new ("d", (double) scheme_rational_to_double (obj));
+        if (scheme_object_to_double (obj, &d))
+          return g_variant_new_double (d);
         else
           return NULL;
 
       // 32 bit integers
       case 'i':
-        if (SCHEME_INTP (obj))
-          return g_variant_new ("i", (int) SCHEME_INT_VAL (obj));
-        else if (SCHEME_DBLP (obj))
-          return g_variant_new ("i", (int) SCHEME_DBL_VAL (obj));
-        else if (SCHEME_FLTP (obj))
-          return g_variant_new ("i", (int) SCHEME_FLT_VAL (obj));
-        else if (SCHEME_RATIONALP (obj))
-          return g_variant_new ("i", (int) scheme_rational_to_double (obj));
+        if (scheme_object_to_int32 (obj, &i))
+          return g_variant_new_int32 (i);
         else 
           return NULL;
 
       // Strings
       case 's':
-        str = scheme_object_to_string (obj);
+        str = scheme_object_to_arena_string (obj);
         if (str == NULL)
           return NULL;
-        return g_variant_new ("s", str);
+        return g_variant_new_string (str);
 
       // 32 bit unsigned integers
       case 'u':
         if (SCHEME_INTP (obj))
-          return g_variant_new ("u", (unsigned int) SCHEME_INT_VAL (obj));
+          return g_variant_new_uint32 ((unsigned int) SCHEME_INT_VAL (obj));
+        else
+          return NULL;
+
+      // Booleans
+      case 'b':
+        if (SCHEME_BOOLP (obj))
+          return g_variant_new_boolean (SCHEME_TRUEP (obj));
+        else
+          return NULL;
+
+      // 64 bit integers
+      case 'x':
+        if (SCHEME_EXACT_INTEGERP (obj)
+            && scheme_get_long_long_val (obj, &ll))
+          return g_variant_new_int64 (ll);
         else
           return NULL;
 
+      // Variants, whose types we infer
+      case 'v':
+        return scheme_object_to_variant (obj);
+
       // Everything else is currently unsupported
       default:
         return NULL;
     } // switch
 } // scheme_object_to_parameter
 
+/**
+ * Wrap a proxy as a Scheme object, arranging for the proxy to be freed
+ * when the Scheme object is collected.
+ */
+static Scheme_Object *
+scheme_make_proxy (LouDBusProxy *proxy)
+{
+  Scheme_Object *result = NULL; // The proxy wrapped as a Scheme object
+
+  MZ_GC_DECL_REG (1);
+  MZ_GC_VAR_IN_REG (0, result);
+  MZ_GC_REG ();
+
+  // Wrap the proxy into a Scheme type
+  result = scheme_make_cptr (proxy, LOUDBUS_PROXY_TAG);
+
+  // Log info during development
+  LOG ("scheme_make_proxy: Built proxy %p, Scheme object %p", proxy, result);
+
+  // Find out information on what we just built.
+  SCHEME_LOG ("result is", result);
+  SCHEME_LOG ("result type is", SCHEME_CPTR_TYPE (result));
+  
+  // Register the finalizer
+  scheme_register_finalizer (result, loudbus_proxy_finalize, NULL, NULL, NULL);
+
+  MZ_GC_UNREG ();
+  return result;
+} // scheme_make_proxy
+
 /**
  * Convert a Scheme object representing an LouDBusProxy to the proxy.
  * Returns NULL if it cannot convert.
@@ -742,6 +1411,105 @@ scheme_object_to_proxy (Scheme_Object *obj)
   return proxy;
 } // scheme_object_to_proxy
 
+/**
+ * Wrap a ticket as a Scheme object, arranging for our reference to be
+ * dropped when the Scheme object is collected.
+ */
+static Scheme_Object *
+scheme_make_ticket (LouDBusTicket *ticket)
+{
+  Scheme_Object *result = NULL; // The ticket wrapped as a Scheme object
+
+  MZ_GC_DECL_REG (1);
+  MZ_GC_VAR_IN_REG (0, result);
+  MZ_GC_REG ();
+
+  result = scheme_make_cptr (ticket, LOUDBUS_TICKET_TAG);
+  scheme_register_finalizer (result, loudbus_ticket_finalize, 
+                             NULL, NULL, NULL);
+
+  MZ_GC_UNREG ();
+  return result;
+} // scheme_make_ticket
+
+/**
+ * Convert a Scheme object representing a ticket to the ticket.
+ * Returns NULL if it cannot convert.
+ */
+static LouDBusTicket *
+scheme_object_to_ticket (Scheme_Object *obj)
+{
+  LouDBusTicket *ticket;
+
+  if (! SCHEME_CPTRP (obj))
+    return NULL;
+  ticket = SCHEME_CPTR_VAL (obj);
+  if (! loudbus_ticket_validate (ticket))
+    return NULL;
+  return ticket;
+} // scheme_object_to_ticket
+
+/**
+ * Wrap a spilled byte array as a Scheme object, which releases the
+ * mapping when it's collected.
+ */
+static Scheme_Object *
+scheme_make_spill (LouDBusSpill *spill)
+{
+  Scheme_Object *result = NULL; // The spill wrapped as a Scheme object
+
+  MZ_GC_DECL_REG (1);
+  MZ_GC_VAR_IN_REG (0, result);
+  MZ_GC_REG ();
+
+  result = scheme_make_cptr (spill, LOUDBUS_SPILL_TAG);
+  scheme_register_finalizer (result, loudbus_spill_finalize, 
+                             NULL, NULL, NULL);
+
+  MZ_GC_UNREG ();
+  return result;
+} // scheme_make_spill
+
+/**
+ * Convert a Scheme object representing a spilled byte array to the
+ * spill.  Returns NULL if it cannot convert.
+ */
+static LouDBusSpill *
+scheme_object_to_spill (Scheme_Object *obj)
+{
+  LouDBusSpill *spill;
+
+  if (! SCHEME_CPTRP (obj))
+    return NULL;
+  spill = SCHEME_CPTR_VAL (obj);
+  if (! loudbus_spill_validate (spill))
+    return NULL;
+  return spill;
+} // scheme_object_to_spill
+
+/**
+ * Convert a Scheme symbol ('interactive, 'normal, or 'bulk) to a
+ * priority class.  #f gives -1, which means "the proxy's class".
+ * Returns 0 if it cannot convert.
+ */
+static int
+scheme_object_to_priority (Scheme_Object *obj, int *priority)
+{
+  if (SCHEME_FALSEP (obj))
+    *priority = -1;
+  else if (! SCHEME_SYMBOLP (obj))
+    return 0;
+  else if (strcmp (SCHEME_SYM_VAL (obj), "interactive") == 0)
+    *priority = LOUDBUS_PRIORITY_INTERACTIVE;
+  else if (strcmp (SCHEME_SYM_VAL (obj), "normal") == 0)
+    *priority = LOUDBUS_PRIORITY_NORMAL;
+  else if (strcmp (SCHEME_SYM_VAL (obj), "bulk") == 0)
+    *priority = LOUDBUS_PRIORITY_BULK;
+  else
+    return 0;
+  return 1;
+} // scheme_object_to_priority
+
 /**
  * Given some kind of Scheme string value, convert it to a C string
  * If scmval is not a string value, returns NULL.
@@ -781,23 +1549,214 @@ scheme_object_to_string (Scheme_Object *scmval)
   return str;
 } // scheme_object_to_string
 
+/**
+ * Given some kind of Scheme string value, get a UTF-8 C string.  Char
+ * strings are encoded into the scratch arena; byte strings and symbols
+ * are used in place.  If scmval is not a string value, returns NULL.
+ */
+static gchar *
+scheme_object_to_arena_string (Scheme_Object *scmval)
+{
+  gchar *str;           // The string we build
+  intptr_t len;         // Its length in bytes
+
+  // Char strings need encoding, which we do without Scheme allocation.
+  if (SCHEME_CHAR_STRINGP (scmval))
+    {
+      len = scheme_utf8_encode (SCHEME_CHAR_STR_VAL (scmval), 0,
+                                SCHEME_CHAR_STRLEN_VAL (scmval),
+                                NULL, 0, 0);
+      str = loudbus_arena_alloc (&loudbus_scratch, len + 1);
+      scheme_utf8_encode (SCHEME_CHAR_STR_VAL (scmval), 0,
+                          SCHEME_CHAR_STRLEN_VAL (scmval),
+                          (unsigned char *) str, 0, 0);
+      str[len] = '\0';
+      return str;
+    } // if it's a char string
+
+  // Byte strings and symbols already have a C form.
+  else if (SCHEME_BYTE_STRINGP (scmval))
+    return SCHEME_BYTE_STR_VAL (scmval);
+  else if (SCHEME_SYMBOLP (scmval))
+    return SCHEME_SYM_VAL (scmval);
+
+  // Everything else is not a string
+  else
+    return NULL;
+} // scheme_object_to_arena_string
+
+/**
+ * Given some kind of Scheme string value, get a copy of it as a UTF-8
+ * C string in the scratch arena.  Unlike scheme_object_to_arena_string,
+ * which uses byte strings and symbols in place, the copy stays put
+ * while Scheme allocates (and the collector moves things), so it can
+ * name a method for the whole of a call.  If scmval is not a string
+ * value, returns NULL.
+ */
+static gchar *
+scheme_object_to_arena_name (Scheme_Object *scmval)
+{
+  gchar *str;           // The string
+
+  str = scheme_object_to_arena_string (scmval);
+  if ((str != NULL) && (! SCHEME_CHAR_STRINGP (scmval)))
+    str = loudbus_arena_strndup (&loudbus_scratch, str, strlen (str));
+  return str;
+} // scheme_object_to_arena_name
+
+/**
+ * Determine whether a Scheme value is one that the memo of encoded
+ * arguments may keep: a big enough immutable byte string, or a big
+ * enough immutable vector or list of numbers, booleans, symbols, and
+ * immutable strings, which can never change under us.
+ */
+static int
+scheme_object_memoizable (Scheme_Object *obj)
+{
+  Scheme_Object *elt;   // One element
+  intptr_t n;           // The number of elements
+  intptr_t i;           // Counter variable
+
+  if (SCHEME_BYTE_STRINGP (obj))
+    return SCHEME_IMMUTABLEP (obj)
+           && (SCHEME_BYTE_STRLEN_VAL (obj) >= loudbus_memo_min);
+  if (SCHEME_VECTORP (obj))
+    {
+      if (! SCHEME_IMMUTABLEP (obj))
+        return 0;
+      n = SCHEME_VEC_SIZE (obj);
+    } // if it's a vector
+  else if (SCHEME_PAIRP (obj))
+    {
+      n = scheme_proper_list_length (obj);
+      if (n < 0)
+        return 0;
+    } // if it's a list
+  else
+    return 0;
+  if (n < loudbus_memo_min)
+    return 0;
+
+  for (i = 0; i < n; i++)
+    {
+      if (SCHEME_VECTORP (obj))
+        elt = SCHEME_VEC_ELS (obj)[i];
+      else
+        {
+          elt = SCHEME_CAR (obj);
+          obj = SCHEME_CDR (obj);
+        } // if it's a list
+      if (! (SCHEME_NUMBERP (elt) || SCHEME_BOOLP (elt)
+             || SCHEME_SYMBOLP (elt)
+             || ((SCHEME_CHAR_STRINGP (elt) || SCHEME_BYTE_STRINGP (elt))
+                 && SCHEME_IMMUTABLEP (elt))))
+        return 0;
+    } // for each element
+  return 1;
+} // scheme_object_memoizable
+
+/**
+ * Find the GVariant of the given type that the memo has for a Scheme
+ * object.  Returns NULL if the memo is off or doesn't have one.  The
+ * GVariant belongs to the memo.
+ */
+static GVariant *
+scheme_object_memo_lookup (Scheme_Object *obj, gchar *type)
+{
+  Scheme_Object *entry; // The memo's entry for obj
+
+  if ((loudbus_memo_limit == 0) || (type[0] != 'a'))
+    return NULL;
+  entry = scheme_lookup_in_table (loudbus_memo, (const char *) obj);
+  if ((entry != NULL)
+      && (g_strcmp0 (g_variant_get_type_string (SCHEME_CPTR_VAL (entry)),
+                     type) == 0))
+    return SCHEME_CPTR_VAL (entry);
+  return NULL;
+} // scheme_object_memo_lookup
+
+/**
+ * Convert a memoizable Scheme object to a GVariant for one of the
+ * parameters of a call, and remember it in the memo, which must be
+ * on.  The GVariant belongs to the memo.
+ */
+static GVariant *
+scheme_object_memo_add (Scheme_Object *obj, gchar *type)
+{
+  Scheme_Object *entry = NULL;  // The memo's entry for obj
+  GVariant *gval;               // The encoded value
+
+  gval = scheme_object_to_parameter (obj, type);
+  if (gval == NULL)
+    return NULL;
+  g_variant_ref_sink (gval);
+
+  MZ_GC_DECL_REG (2);
+  MZ_GC_VAR_IN_REG (0, obj);
+  MZ_GC_VAR_IN_REG (1, entry);
+  MZ_GC_REG ();
+
+  // Keep the table bounded by starting over when it fills up.
+  if (loudbus_memo_count >= loudbus_memo_limit)
+    {
+      loudbus_memo = scheme_make_bucket_table (loudbus_memo_limit,
+                                               SCHEME_hash_weak_ptr);
+      loudbus_memo_count = 0;
+    } // if the memo is full
+  entry = scheme_make_cptr (gval, LOUDBUS_MEMO_TAG);
+  scheme_register_finalizer (entry, loudbus_memo_finalize,
+                             NULL, NULL, NULL);
+  scheme_add_to_table (loudbus_memo, (const char *) obj, entry, 0);
+  loudbus_memo_count++;
+
+  MZ_GC_UNREG ();
+  return gval;
+} // scheme_object_memo_add
+
+/**
+ * Convert a Scheme object to a GVariant for one of the parameters of
+ * a call, as scheme_object_to_parameter does, but reuse the GVariant
+ * from the last time we saw the same (eq?) immutable value, if the
+ * memo is on.  We look in the memo before checking that the value is
+ * one it may keep, so a repeat costs a lookup rather than a walk over
+ * its elements.  The GVariant may not be floating, so callers add it
+ * to a builder (which takes a reference) rather than taking it over.
+ */
+static GVariant *
+scheme_object_to_memo_parameter (Scheme_Object *obj, gchar *type)
+{
+  GVariant *gval;       // The encoded value
+
+  if ((loudbus_memo_limit == 0) || (type[0] != 'a'))
+    return scheme_object_to_parameter (obj, type);
+  gval = scheme_object_memo_lookup (obj, type);
+  if (gval != NULL)
+    return gval;
+  if (! scheme_object_memoizable (obj))
+    return scheme_object_to_parameter (obj, type);
+  return scheme_object_memo_add (obj, type);
+} // scheme_object_to_memo_parameter
+
 /**
  * Convert an array of Scheme objects to a GVariant that serves as
- * the primary parameter to g_dbus_proxy_call.
+ * the primary parameter to g_dbus_proxy_call.  If we can't convert a
+ * parameter, we signal an error or, if errorp is non-NULL, set it and
+ * return NULL.
  */
 static GVariant *
 scheme_objects_to_parameter_tuple (gchar *fun,
                                    int arity,
                                    Scheme_Object **objects,
-                                   GDBusArgInfo *formals[])
+                                   gchar *formals[],
+                                   GError **errorp)
 {
   int i;                // Counter variable
-  GVariantBuilder *builder;
+  GVariantBuilder builder;
                         // Something to let us build tuples
   GVariant *result;     // The GVariant we build
   GVariant *actual;     // One actual
 
-  builder = g_variant_builder_new (G_VARIANT_TYPE_TUPLE);
+  g_variant_builder_init (&builder, G_VARIANT_TYPE_TUPLE);
 
   // Annotations for garbage collector.
   // Since we're converting Scheme_Object values to GVariants, it should
@@ -814,37 +1773,337 @@ scheme_objects_to_parameter_tuple (gchar *fun,
   // Process all the parameters
   for (i = 0; i < arity; i++)
     {
-      actual = scheme_object_to_parameter (objects[i], formals[i]->signature);
+      actual = scheme_object_to_memo_parameter (objects[i], formals[i]);
       // If we can't convert the parameter, we give up.
       if (actual == NULL)
         {
           // Early exit - Clean up for garbage collection
           MZ_GC_UNREG ();
           // Get rid of the builder
-          g_variant_builder_unref (builder);
-          // And return an arror message.
+          g_variant_builder_clear (&builder);
+          // Report the problem without unwinding, if we can
+          if (errorp != NULL)
+            {
+              g_set_error_literal (errorp, G_DBUS_ERROR, 
+                                   G_DBUS_ERROR_INVALID_ARGS,
+                                   "could not convert parameters");
+              return NULL;
+            } // if (errorp != NULL)
+          // Otherwise, return an arror message.
           scheme_wrong_type (fun, 
-                             dbus_signature_to_string (formals[i]->signature), 
+                             dbus_signature_to_string (formals[i]), 
                              i, 
                              arity, 
                              objects);
         } // If we could not convert
       // Otherwise, we add the value to the builder and go on
-      g_variant_builder_add_value (builder, actual);
+      g_variant_builder_add_value (&builder, actual);
     } // for
 
   // Clean up garbage collection info.
   MZ_GC_UNREG ();
   // And we're done.
-  result = g_variant_builder_end (builder);
+  result = g_variant_builder_end (&builder);
   return result;
 } // scheme_objects_to_parameter_tuple
 
+/**
+ * Convert an array of Scheme objects to the same tuple that
+ * scheme_objects_to_parameter_tuple builds, but write it directly with
+ * the wire encoder rather than building a GVariant for each value.
+ * Numbers, strings, byte strings, and arrays of them go straight in;
+ * everything else is converted as usual and copied in.  Returns NULL,
+ * without signalling an error, if anything doesn't convert, so that
+ * the caller can try again the usual way and report the problem.
+ */
+static GVariant *
+scheme_objects_to_wire_tuple (int arity,
+                              Scheme_Object **objects,
+                              gchar *formals[])
+{
+  Scheme_Object *obj = NULL;    // One actual
+  Scheme_Object *elt = NULL;    // One element of an actual
+  union
+    {
+      gboolean b;
+      gint32 i;
+      gint64 x;
+      double d;
+    } value;                    // A fixed-size value
+  GVariant *gval;               // A value converted the usual way
+                                // (or one the memo has)
+  gboolean memo;                // Does the memo have (or keep) it?
+  guchar *buf;                  // The elements of a fixed array
+  gsize elsize;                 // The size of one of them
+  gchar *type;                  // The type of one actual
+  gchar *str;                   // A string
+  int len;                      // The length of an array
+  int i;                        // Counter variable
+  int j;                        // Counter variable
+
+  MZ_GC_DECL_REG (3);
+  MZ_GC_VAR_IN_REG (0, objects);
+  MZ_GC_VAR_IN_REG (1, obj);
+  MZ_GC_VAR_IN_REG (2, elt);
+  MZ_GC_REG ();
+
+  loudbus_wire_begin (loudbus_wire, formals, arity);
+  for (i = 0; i < arity; i++)
+    {
+      obj = objects[i];
+      type = formals[i];
+
+      // Look for arrays in the memo before anything else, and walk
+      // their elements only if we don't find them.
+      gval = NULL;
+      memo = FALSE;
+      if ((loudbus_memo_limit > 0) && (type[0] == 'a')
+          && (! SCHEME_BYTE_STRINGP (obj)))
+        {
+          gval = scheme_object_memo_lookup (obj, type);
+          memo = (gval != NULL) || scheme_object_memoizable (obj);
+        } // if the memo might have it
+
+      // Values the memo has or keeps
+      if (memo)
+        {
+          if (gval == NULL)
+            gval = scheme_object_memo_add (obj, type);
+          if (gval == NULL)
+            break;
+          loudbus_wire_add_value (loudbus_wire, gval);
+        } // if the memo has it
+
+      // Booleans
+      else if ((g_strcmp0 (type, "b") == 0) && SCHEME_BOOLP (obj))
+        {
+          value.b = SCHEME_TRUEP (obj);
+          loudbus_wire_add_fixed (loudbus_wire, &value);
+        } // if it's a boolean
+
+      // Numbers
+      else if ((type[0] != '\0') && (strchr ("diux", type[0]) != NULL)
+               && (type[1] == '\0'))
+        {
+          if (! scheme_object_to_fixed_element (obj, type[0], &value))
+            break;
+          loudbus_wire_add_fixed (loudbus_wire, &value);
+        } // if it's a number
+
+      // Strings
+      else if (g_strcmp0 (type, "s") == 0)
+        {
+          str = scheme_object_to_arena_string (obj);
+          if (str == NULL)
+            break;
+          loudbus_wire_add_string (loudbus_wire, str);
+        } // if it's a string
+
+      // Byte strings
+      else if ((g_strcmp0 (type, "ay") == 0) && SCHEME_BYTE_STRINGP (obj))
+        loudbus_wire_add_fixed_array (loudbus_wire,
+                                      SCHEME_BYTE_STR_VAL (obj),
+                                      SCHEME_BYTE_STRLEN_VAL (obj));
+
+      // Anything else that isn't an array of numbers or strings, the
+      // usual way.  (We've already looked in the memo.)
+      else if ((type[0] != 'a') || (type[1] == '\0')
+               || (strchr ("diuxys", type[1]) == NULL) || (type[2] != '\0')
+               || ((! SCHEME_VECTORP (obj)) && (! SCHEME_PAIRP (obj))
+                   && (! SCHEME_NULLP (obj))))
+        {
+          gval = scheme_object_to_parameter (obj, type);
+          if (gval == NULL)
+            break;
+          g_variant_ref_sink (gval);
+          loudbus_wire_add_value (loudbus_wire, gval);
+          g_variant_unref (gval);
+        } // if it's something else
+
+      // Arrays of numbers
+      else if (type[1] != 's')
+        {
+          buf = scheme_object_to_fixed_buffer (obj, type, &len, &elsize);
+          if (buf == NULL)
+            break;
+          loudbus_wire_add_fixed_array (loudbus_wire, buf, len);
+        } // if it's an array of numbers
+
+      // Arrays of strings
+      else
+        {
+          len = SCHEME_VECTORP (obj)
+                ? SCHEME_VEC_SIZE (obj)
+                : scheme_proper_list_length (obj);
+          if (len < 0)
+            break;
+          loudbus_wire_open_array (loudbus_wire);
+          for (j = 0; j < len; j++)
+            {
+              if (SCHEME_VECTORP (obj))
+                elt = SCHEME_VEC_ELS (obj)[j];
+              else
+                {
+                  elt = SCHEME_CAR (obj);
+                  obj = SCHEME_CDR (obj);
+                } // if it's a list
+              str = scheme_object_to_arena_string (elt);
+              if (str == NULL)
+                break;
+              loudbus_wire_add_string (loudbus_wire, str);
+            } // for each element
+          if (j < len)
+            break;
+          loudbus_wire_close_array (loudbus_wire);
+        } // if it's an array of strings
+    } // for each actual
+
+  MZ_GC_UNREG ();
+  if (i < arity)
+    return NULL;
+  return loudbus_wire_end (loudbus_wire);
+} // scheme_objects_to_wire_tuple
+
 
 // +-----------------------+------------------------------------------
 // | Other Local Functions |
 // +-----------------------+
 
+/**
+ * Get the catalogue of the interface of a proxy: a vector of the names
+ * of its methods, as a list in the order declared; the same names, as
+ * a vector in alphabetical order; and a hash table of the results of
+ * loudbus-method-info, by method.  We build it the first time anyone
+ * asks about an interface and keep it, so loudbus-methods and the
+ * searches share one set of immutable strings rather than making new
+ * ones every time.
+ */
+static Scheme_Object *
+loudbus_catalogue (LouDBusProxy *proxy)
+{
+  LouDBusInterface *iface;              // The interface
+  Scheme_Object *key = NULL;            // The key for the catalogue
+  Scheme_Object *catalogue = NULL;      // The catalogue
+  Scheme_Object *byindex = NULL;        // The names, by index
+  Scheme_Object *names = NULL;          // The names, as a list
+  Scheme_Object *sorted = NULL;         // The names, sorted
+  Scheme_Object *val = NULL;            // One name
+  int m;                                // Counter variable for methods
+
+  MZ_GC_DECL_REG (6);
+  MZ_GC_VAR_IN_REG (0, key);
+  MZ_GC_VAR_IN_REG (1, catalogue);
+  MZ_GC_VAR_IN_REG (2, byindex);
+  MZ_GC_VAR_IN_REG (3, names);
+  MZ_GC_VAR_IN_REG (4, sorted);
+  MZ_GC_VAR_IN_REG (5, val);
+  MZ_GC_REG ();
+
+  iface = proxy->iface;
+  key = scheme_intern_symbol (iface->digest);
+  catalogue = scheme_hash_get (loudbus_catalogues, key);
+  if (catalogue != NULL)
+    {
+      MZ_GC_UNREG ();
+      return catalogue;
+    } // if we've seen the interface
+
+  byindex = scheme_make_vector (iface->nmethods, scheme_false);
+  for (m = 0; m < iface->nmethods; m++)
+    {
+      val = scheme_make_immutable_sized_utf8_string (iface->methods[m].name,
+                                                     -1);
+      SCHEME_VEC_ELS (byindex)[m] = val;
+    } // for each method
+
+  names = scheme_null;
+  for (m = iface->nmethods - 1; m >= 0; m--)
+    names = scheme_make_pair (SCHEME_VEC_ELS (byindex)[m], names);
+  sorted = scheme_make_vector (iface->nmethods, scheme_false);
+  for (m = 0; m < iface->nmethods; m++)
+    SCHEME_VEC_ELS (sorted)[m] = SCHEME_VEC_ELS (byindex)[iface->sorted[m]];
+
+  catalogue = scheme_make_vector (3, scheme_false);
+  SCHEME_VEC_ELS (catalogue)[0] = names;
+  SCHEME_VEC_ELS (catalogue)[1] = sorted;
+  val = (Scheme_Object *) scheme_make_hash_table (SCHEME_hash_ptr);
+  SCHEME_VEC_ELS (catalogue)[2] = val;
+  scheme_hash_set (loudbus_catalogues, key, catalogue);
+
+  MZ_GC_UNREG ();
+  return catalogue;
+} // loudbus_catalogue
+
+/**
+ * Convert the details of a method (see loudbus_interface_details) to
+ * the form that loudbus-method-info returns.
+ */
+static Scheme_Object *
+loudbus_details_to_scheme (Scheme_Object *name, GVariant *details)
+{
+  Scheme_Object *result = NULL;         // The result we're building
+  Scheme_Object *lists[3];              // The argument, output, and
+                                        // annotation lists
+  Scheme_Object *val = NULL;            // One value
+  Scheme_Object *val2 = NULL;           // Another value
+  GVariant *part;                       // One part of the details
+  const gchar *str;                     // One string in the details
+  const gchar *str2;                    // Another string
+  int i;                                // Counter variable for parts
+  int k;                                // Counter variable for entries
+
+  lists[0] = NULL;
+  lists[1] = NULL;
+  lists[2] = NULL;
+
+  MZ_GC_DECL_REG (7);
+  MZ_GC_VAR_IN_REG (0, name);
+  MZ_GC_VAR_IN_REG (1, result);
+  MZ_GC_VAR_IN_REG (2, lists[0]);
+  MZ_GC_VAR_IN_REG (3, lists[1]);
+  MZ_GC_VAR_IN_REG (4, lists[2]);
+  MZ_GC_VAR_IN_REG (5, val);
+  MZ_GC_VAR_IN_REG (6, val2);
+  MZ_GC_REG ();
+
+  // The parameters and return values are (name . signature) pairs.
+  for (i = 0; i < 2; i++)
+    {
+      lists[i] = scheme_null;
+      part = g_variant_get_child_value (details, i);
+      for (k = g_variant_n_children (part) - 1; k >= 0; k--)
+        {
+          g_variant_get_child (part, k, "(&s&s)", &str, &str2);
+          val = scheme_intern_symbol (str);
+          val2 = scheme_intern_symbol (str2);
+          val = scheme_make_pair (val, val2);
+          lists[i] = scheme_make_pair (val, lists[i]);
+        } // for each entry
+      g_variant_unref (part);
+    } // for the parameters and return values
+
+  // The annotations are strings.
+  lists[2] = scheme_null;
+  part = g_variant_get_child_value (details, 2);
+  for (k = g_variant_n_children (part) - 1; k >= 0; k--)
+    {
+      g_variant_get_child (part, k, "&s", &str);
+      val = scheme_make_immutable_sized_utf8_string ((char *) str, -1);
+      lists[2] = scheme_make_pair (val, lists[2]);
+    } // for each annotation
+  g_variant_unref (part);
+
+  result = scheme_make_pair (lists[2], scheme_null);
+  result = scheme_make_pair (lists[1], result);
+  result = scheme_make_pair (lists[0], result);
+  val = scheme_make_pair (name, scheme_null);
+  val = scheme_make_pair (scheme_intern_symbol ("name"), val);
+  result = scheme_make_pair (val, result);
+
+  MZ_GC_UNREG ();
+  return result;
+} // loudbus_details_to_scheme
+
 /**
  * Add one of the procedures that the proxy provides on the D-Bus.
  */
@@ -886,124 +2145,285 @@ loudbus_add_dbus_proc (Scheme_Env *env,
   // And add it to the environment.  
   scheme_add_global (external_name, proc, env);
 
-  // And update the GC info.
+  // And update the GC info.
+  MZ_GC_UNREG ();
+} // loudbus_add_dbus_proc
+
+/**
+ * Build the value that loudbus-try-call returns for an error, freeing
+ * the error.
+ */
+static Scheme_Object *
+scheme_make_loudbus_error (GError *error)
+{
+  Scheme_Object *args[2];       // The name and the code
+  Scheme_Object *result = NULL; // The value we build
+  const gchar *name;            // The name of the error
+
+  args[0] = NULL;
+  args[1] = NULL;
+  MZ_GC_DECL_REG (3);
+  MZ_GC_ARRAY_VAR_IN_REG (0, args, 2);
+  MZ_GC_REG ();
+
+  // The name is interned, as are symbols, so this doesn't allocate
+  // once we've seen an error.
+  name = loudbus_error_name (error);
+  args[0] = scheme_intern_exact_symbol (name, strlen (name));
+  args[1] = scheme_make_integer (error->code);
+  g_error_free (error);
+  result = scheme_apply (LOUDBUS_ERROR_MAKER, 2, args);
+
   MZ_GC_UNREG ();
-} // loudbus_add_dbus_proc
+  return result;
+} // scheme_make_loudbus_error
 
 /**
- * The kernel of the various mechanisms for calling D-Bus functions.
+ * Check the parameters of a call and convert them to a GVariant.  If
+ * errorp is NULL, we signal an error when something goes wrong.
+ * Otherwise, we set errorp and return NULL, which is much cheaper
+ * than unwinding.
  */
-static Scheme_Object *
-dbus_call_kernel (LouDBusProxy *proxy,
-                  gchar *dbus_name,
-                  gchar *external_name,
-                  int argc, 
-                  Scheme_Object **argv)
+static GVariant *
+dbus_call_actuals (LouDBusProxy *proxy,
+                   gchar *dbus_name,
+                   gchar *external_name,
+                   int argc, 
+                   Scheme_Object **argv,
+                   GError **errorp)
 {
-  GDBusMethodInfo *method;
+  LouDBusMethod *method;
                         // Information on the actual method
   int arity;            // The arity of that method
   GVariant *actuals;    // The actual parameters
-  GVariant *gresult;    // The result from the function call as a GVariant
-  Scheme_Object *sresult;   
-                        // That Scheme result as a Scheme object
-  GError *error;        // Possible error from call
+  GVariant *expected;   // The actual parameters, built the usual way
+  gchar *printed;       // A printed GVariant
+  gchar direct[256];    // The start of the actuals, printed
+  gchar usual[256];     // The start of the expected actuals, printed
+  GError *check_error;  // Why the usual way failed, when checking
 
   // Grab the method information.
-  method = g_dbus_interface_info_lookup_method (proxy->iinfo, dbus_name);
+  method = loudbus_interface_lookup_method (proxy->iface, dbus_name);
   if (method == NULL)
     {
-      scheme_signal_error ("no such method: %s", dbus_name);
+      if (errorp == NULL)
+        scheme_signal_error ("no such method: %s", dbus_name);
+      g_set_error_literal (errorp, G_DBUS_ERROR, 
+                           G_DBUS_ERROR_UNKNOWN_METHOD, "no such method");
+      return NULL;
     } // if the method is invalid
 
   // Get the arity
-  arity = g_dbus_method_info_num_formals (method);
+  arity = method->arity;
   if (arity != argc)
     {
-      scheme_signal_error ("%s expected %d params, received %d",
-                           external_name, arity, argc);
+      if (errorp == NULL)
+        scheme_signal_error ("%s expected %d params, received %d",
+                             external_name, arity, argc);
+      g_set_error_literal (errorp, G_DBUS_ERROR, 
+                           G_DBUS_ERROR_INVALID_ARGS, "wrong arity");
+      return NULL;
     } // if the arity is incorrect
 
-  // Build the actuals
+  // Build the actuals directly, if we can.
+  actuals = NULL;
+  if (loudbus_wire_mode != LOUDBUS_WIRE_OFF)
+    actuals = scheme_objects_to_wire_tuple (argc, argv, method->in_args);
+  if ((actuals != NULL) && (loudbus_wire_mode == LOUDBUS_WIRE_CHECK))
+    {
+      // actuals stays floating, for the caller.  We must not unwind
+      // while we hold it, so the usual way reports errors to us.
+      check_error = NULL;
+      expected = scheme_objects_to_parameter_tuple (external_name,
+                                                    argc,
+                                                    argv,
+                                                    method->in_args,
+                                                    &check_error);
+      if (expected != NULL)
+        g_variant_ref_sink (expected);
+      if ((expected == NULL) || (! g_variant_equal (actuals, expected)))
+        {
+          printed = g_variant_print (actuals, TRUE);
+          g_strlcpy (direct, printed, sizeof (direct));
+          g_free (printed);
+          if (expected == NULL)
+            {
+              g_strlcpy (usual, check_error->message, sizeof (usual));
+              g_error_free (check_error);
+            } // if the usual way failed
+          else
+            {
+              printed = g_variant_print (expected, TRUE);
+              g_strlcpy (usual, printed, sizeof (usual));
+              g_free (printed);
+              g_variant_unref (expected);
+            } // if the usual way gave something else
+          g_variant_unref (g_variant_ref_sink (actuals));
+          scheme_signal_error ("%s: the wire encoder gave %s, not %s",
+                               external_name, direct, usual);
+        } // if the encodings differ
+      g_variant_unref (expected);
+    } // if we're checking the wire encoder
+  if (actuals != NULL)
+    return actuals;
+
+  // Otherwise, build them the usual way.
   actuals = scheme_objects_to_parameter_tuple (external_name,
                                                argc,
                                                argv,
-                                               method->in_args);
-  if (actuals == NULL)
+                                               method->in_args,
+                                               errorp);
+  if ((actuals == NULL) && (errorp == NULL))
     {
       scheme_signal_error ("%s: could not convert parameters",
                            external_name);
     } // if (actuals == NULL)
 
+  return actuals;
+} // dbus_call_actuals
+
+/**
+ * Tell the call observer where the time in a sampled call went, and
+ * when each phase started.  The observer runs in the caller's
+ * continuation, so it can look at the caller's continuation marks.
+ * Returns result (the result of the call), which may have moved.
+ */
+static Scheme_Object *
+dbus_call_observe (gchar *external_name, Scheme_Object *result)
+{
+  LouDBusCallTimes times;       // Where the time went
+  gint64 starts[LOUDBUS_PHASES];
+                                // When each phase started
+  Scheme_Object *args[7];       // The arguments to the observer
+  int i;                        // Counter variable
+
+  loudbus_timing_sample_end (&times, starts);
+
+  for (i = 0; i < 7; i++)
+    args[i] = NULL;
+  MZ_GC_DECL_REG (5);
+  MZ_GC_VAR_IN_REG (0, result);
+  MZ_GC_ARRAY_VAR_IN_REG (1, args, 7);
+  MZ_GC_REG ();
+
+  args[0] = scheme_make_immutable_sized_utf8_string (external_name, -1);
+  args[1] = scheme_make_double (times.encode_ns / 1e6);
+  args[2] = scheme_make_double (times.wire_ns / 1e6);
+  args[3] = scheme_make_double (times.decode_ns / 1e6);
+  for (i = 0; i < LOUDBUS_PHASES; i++)
+    args[4 + i] = scheme_make_double (starts[i] / 1e6);
+  scheme_apply (loudbus_call_observer, 7, args);
+
+  MZ_GC_UNREG ();
+  return result;
+} // dbus_call_observe
+
+/**
+ * The kernel of the various mechanisms for calling D-Bus functions.
+ * Handles errors as dbus_call_actuals does.
+ */
+static Scheme_Object *
+dbus_call_kernel (LouDBusProxy *proxy,
+                  gchar *dbus_name,
+                  gchar *external_name,
+                  int argc, 
+                  Scheme_Object **argv,
+                  GError **errorp)
+{
+  GVariant *actuals;    // The actual parameters
+  GVariant *gresult;    // The result from the function call as a GVariant
+  Scheme_Object *sresult;   
+                        // That Scheme result as a Scheme object
+  GError *error;        // Possible error from call
+  gint64 start;         // When a phase started, if we're timing
+  gboolean sampled;     // Are we sampling this call for the observer?
+  gchar name[512];      // A copy of external_name, for after the
+                        // observer (an interface name and a method
+                        // name have at most 255 characters each)
+  gchar message[256];   // A copy of an error message, likewise
+
+  // Sample one call in every loudbus_observe_every, if someone is
+  // watching.  The observer is Racket code, so another thread may
+  // make a call (and reset the arena that external_name and
+  // dbus_name may be in) while it runs.  Afterwards, we use only
+  // our copy of the name.
+  sampled = (! SCHEME_FALSEP (loudbus_call_observer))
+            && (--loudbus_observe_countdown <= 0);
+  if (sampled)
+    {
+      loudbus_observe_countdown = loudbus_observe_every;
+      g_strlcpy (name, external_name, sizeof (name));
+      loudbus_timing_sample_begin ();
+    } // if (sampled)
+
+  // Build the actuals.  While we're sampling, we can't let an error
+  // unwind past us, so we report it only once the sample is over.
+  start = loudbus_timing_start ();
+  error = NULL;
+  actuals = dbus_call_actuals (proxy, dbus_name, external_name, 
+                               argc, argv, sampled ? &error : errorp);
+  if (actuals == NULL)
+    {
+      loudbus_timing_stop (LOUDBUS_PHASE_ENCODE, start);
+      if (! sampled)
+        return NULL;
+      dbus_call_observe (name, NULL);
+      if (errorp != NULL)
+        {
+          g_propagate_error (errorp, error);
+          return NULL;
+        } // if the caller wants the error
+      g_strlcpy (message, error->message, sizeof (message));
+      g_error_free (error);
+      scheme_signal_error ("%s: %s", name, message);
+    } // if (actuals == NULL)
+  loudbus_timing_stop (LOUDBUS_PHASE_ENCODE, start);
+
   // Call the function.
   error = NULL;
-  gresult = g_dbus_proxy_call_sync (proxy->proxy,
-                                    dbus_name,
-                                    actuals,
-                                    0,
-                                    -1,
-                                    NULL,
-                                    &error);
+  gresult = loudbus_proxy_call_sync (proxy, dbus_name, actuals, &error);
   if (gresult == NULL)
     {
-      if (error != NULL)
-        {
-          scheme_signal_error ("%s: call failed because %s", 
-                               external_name, error->message);
-        } // if (error != NULL)
-      else
+      // Failed calls take time, too.
+      if (sampled)
         {
-          scheme_signal_error ("%s: call failed for unknown reason", 
-                               external_name);
-        } // if something went wrong, but there's no error
+          dbus_call_observe (name, NULL);
+          external_name = name;
+        } // if (sampled)
+      if (errorp == NULL)
+        loudbus_signal_gerror (external_name, "call failed", error);
+      g_propagate_error (errorp, error);
+      return NULL;
     } // if (gresult == NULL)
 
   // Convert to Scheme form
+  start = loudbus_timing_start ();
   sresult = g_variant_to_scheme_object (gresult);
+  g_variant_unref (gresult);
+  loudbus_timing_stop (LOUDBUS_PHASE_DECODE, start);
   if (sresult == NULL)
     {
+      if (sampled)
+        {
+          dbus_call_observe (name, NULL);
+          external_name = name;
+        } // if (sampled)
       scheme_signal_error ("%s: could not convert return values", 
                            external_name);
     } // if (sresult == NULL)
 
+  // Release any temporary storage, before the observer can start
+  // another call that uses it.
+  loudbus_arena_reset (&loudbus_scratch);
+
+  // Report on the call.
+  if (sampled)
+    sresult = dbus_call_observe (name, sresult);
+
   // And we're done.
   return sresult;
 } // dbus_call_kernel
 
-/**
- * Get a count of the number of methods in an interface.
- */
-int
-g_dbus_interface_info_num_methods (GDBusInterfaceInfo *info)
-{
-  int m;        // Counter variable
-  // Special case: No methods
-  if (info->methods == NULL)
-    return 0;
-  // Normal case: Iterate until we find the NULL.
-  for (m = 0; info->methods[m] != NULL; m++)
-    ;
-  // And we're done.
-  return m;
-} // g_dbus_interface_info_num_methods
-
-/**
- * Get a count of the number of formal parameters to a method.
- */
-static int
-g_dbus_method_info_num_formals (GDBusMethodInfo *method)
-{
-  int i;        // Counter variable
-  // Special case?: No formals
-  if (method->in_args == NULL)
-    return 0;
-  // Normal case: Iterate until we find the NULL.
-  for (i = 0; method->in_args[i] != NULL; i++)
-    ;
-  // And we're done
-  return i;
-} // g_dbus_method_info_num_formals
-
 
 // +--------------------------+---------------------------------------
 // | Wrapped Scheme Functions |
@@ -1021,11 +2441,12 @@ loudbus_call (int argc, Scheme_Object **argv)
   LouDBusProxy *proxy;
   gchar *name;
 
-  // I don't think that I need to add annotations for garbage collection
-  // because scheme_object_to_string is the only allocating call, and we've
-  // dealt with all the other Scheme objects by the time we call it.
+  // Start with a fresh scratch arena.  (A previous call may have
+  // escaped with an error before cleaning up.)
+  loudbus_arena_reset (&loudbus_scratch);
+
   proxy = scheme_object_to_proxy (argv[0]);
-  name = scheme_object_to_string (argv[1]);
+  name = scheme_object_to_arena_name (argv[1]);
 
   // Sanity checks
   if (proxy == NULL)
@@ -1037,12 +2458,58 @@ loudbus_call (int argc, Scheme_Object **argv)
       scheme_wrong_type ("loudbus-call", "string", 1, argc, argv);
     } // if we could not get the name
 
-  // Permit the use of dashes
-  score_it_all (name);
+  // Permit the use of dashes.  (The name is our own copy.)
+  if (strchr (name, '-') != NULL)
+    score_it_all (name);
 
-  return dbus_call_kernel (proxy, name, name, argc-2, argv+2);
+  return dbus_call_kernel (proxy, name, name, argc-2, argv+2, NULL);
 } // loudbus_call
 
+/**
+ * Make a call, but return an error value (built by the procedure given
+ * to loudbus-init) rather than signalling an error when the call
+ * fails.  Parameters are the same as for loudbus_call.
+ */
+Scheme_Object *
+loudbus_try_call (int argc, Scheme_Object **argv)
+{
+  LouDBusProxy *proxy;          // The proxy
+  gchar *name;                  // The name of the method
+  Scheme_Object *result;        // The result of the call
+  GError *error = NULL;         // The reason the call failed
+
+  // Start with a fresh scratch arena.
+  loudbus_arena_reset (&loudbus_scratch);
+
+  proxy = scheme_object_to_proxy (argv[0]);
+  name = scheme_object_to_arena_name (argv[1]);
+
+  // Sanity checks.  These are mistakes in the program, rather than
+  // failed calls, so we still signal errors.
+  if (proxy == NULL)
+    {
+      scheme_wrong_type ("loudbus-try-call", "LouDBusProxy *", 0, argc, argv);
+    } // if we could not get the proxy
+  if (name == NULL)
+    {
+      scheme_wrong_type ("loudbus-try-call", "string", 1, argc, argv);
+    } // if we could not get the name
+  if (LOUDBUS_ERROR_MAKER == NULL)
+    {
+      scheme_signal_error ("loudbus-try-call: loudbus-init was not given "
+                           "a way to build errors");
+    } // if (LOUDBUS_ERROR_MAKER == NULL)
+
+  // Permit the use of dashes.
+  if (strchr (name, '-') != NULL)
+    score_it_all (name);
+
+  result = dbus_call_kernel (proxy, name, name, argc-2, argv+2, &error);
+  if (result == NULL)
+    return scheme_make_loudbus_error (error);
+  return result;
+} // loudbus_try_call
+
 /**
  * Call a function, using the proxy, function name, and external name
  * stored in prim.
@@ -1070,12 +2537,15 @@ loudbus_call_with_closure (int argc, Scheme_Object **argv, Scheme_Object *prim)
   MZ_GC_VAR_IN_REG (4, wrapped_external_name);
   MZ_GC_REG ();
 
+  // Start with a fresh scratch arena.
+  loudbus_arena_reset (&loudbus_scratch);
+
   // Extract information from the closure.
   wrapped_proxy = SCHEME_PRIM_CLOSURE_ELS (prim)[0];
   wrapped_dbus_name = SCHEME_PRIM_CLOSURE_ELS (prim)[1];
   wrapped_external_name = SCHEME_PRIM_CLOSURE_ELS (prim)[2];
-  dbus_name = scheme_object_to_string (wrapped_dbus_name);
-  external_name = scheme_object_to_string (wrapped_external_name);
+  dbus_name = scheme_object_to_arena_name (wrapped_dbus_name);
+  external_name = scheme_object_to_arena_name (wrapped_external_name);
   proxy = scheme_object_to_proxy (wrapped_proxy);
 
   // Sanity check
@@ -1089,12 +2559,335 @@ loudbus_call_with_closure (int argc, Scheme_Object **argv, Scheme_Object *prim)
   // And do the dirty work
   result = dbus_call_kernel (proxy, 
                              dbus_name, external_name, 
-                             argc, argv);
+                             argc, argv, NULL);
 
   MZ_GC_UNREG ();
   return result;
 } // loudbus_call_with_closure
 
+/**
+ * Change the settings of a connection, and report the settings now in
+ * effect.  Parameters are
+ *  0: The connection: a LouDBusProxy (for the connection it uses) or
+ *     a priority class (for its private connection)
+ *  1: The size of the socket's send buffer, in bytes
+ *  2: The size of the socket's receive buffer, in bytes
+ *  3: The size of the largest call to send, in bytes (0 for no limit)
+ * #f for a setting leaves it alone.  Returns a list of the three
+ * settings.
+ */
+static Scheme_Object *
+loudbus_connection_config (int argc, Scheme_Object **argv)
+{
+  GDBusConnection *connection;  // The connection
+  LouDBusProxy *proxy;          // The proxy, if we're given one
+  int priority;                 // The class, if we're given one
+  int settings[3];              // The new settings
+  int sndbuf;                   // The send buffer now
+  int rcvbuf;                   // The receive buffer now
+  gsize max_message;            // The limit on calls now
+  GError *error = NULL;         // A place to hold errors
+  Scheme_Object *result = NULL; // The settings, as a list
+  int i;                        // Counter variable
+
+  for (i = 0; i < 3; i++)
+    {
+      if (SCHEME_FALSEP (argv[i+1]))
+        settings[i] = -1;
+      else if (SCHEME_INTP (argv[i+1]) && (SCHEME_INT_VAL (argv[i+1]) >= 0)
+               && (SCHEME_INT_VAL (argv[i+1]) <= G_MAXINT))
+        settings[i] = SCHEME_INT_VAL (argv[i+1]);
+      else
+        scheme_wrong_type ("loudbus-connection-config!", 
+                           "non-negative integer or #f", i+1, argc, argv);
+    } // for each setting
+
+  // Find the connection.
+  proxy = scheme_object_to_proxy (argv[0]);
+  if (proxy != NULL)
+    connection = g_object_ref (g_dbus_proxy_get_connection (proxy->proxy));
+  else if (scheme_object_to_priority (argv[0], &priority) && (priority >= 0))
+    {
+      connection = loudbus_scheduler_lane (priority);
+      if (connection == NULL)
+        scheme_signal_error ("loudbus-connection-config!: "
+                             "the class has no private connection");
+    } // if we're given a class
+  else
+    scheme_wrong_type ("loudbus-connection-config!", 
+                       "LouDBusProxy * or priority class", 0, argc, argv);
+
+  if (! loudbus_connection_configure (connection, settings[0], settings[1],
+                                      settings[2], &error))
+    {
+      g_object_unref (connection);
+      loudbus_signal_gerror ("loudbus-connection-config!", 
+                             "Could not configure", error);
+    } // if the settings didn't take
+  loudbus_connection_settings (connection, &sndbuf, &rcvbuf, &max_message);
+  g_object_unref (connection);
+
+  MZ_GC_DECL_REG (1);
+  MZ_GC_VAR_IN_REG (0, result);
+  MZ_GC_REG ();
+  result = scheme_make_pair (scheme_make_integer_value_from_unsigned 
+                               (max_message),
+                             scheme_null);
+  result = scheme_make_pair (scheme_make_integer (rcvbuf), result);
+  result = scheme_make_pair (scheme_make_integer (sndbuf), result);
+  MZ_GC_UNREG ();
+
+  return result;
+} // loudbus_connection_config
+
+/**
+ * Start checking the health of a service.  Parameters are
+ *  0: The name of the service
+ *  1: How often to ping it, in milliseconds
+ *  2: How long to wait for an answer, in milliseconds
+ */
+static Scheme_Object *
+loudbus_health_start (int argc, Scheme_Object **argv)
+{
+  gchar *service;               // The name of the service
+  GError *error = NULL;         // A place to hold errors
+  int i;                        // Counter variable
+
+  loudbus_arena_reset (&loudbus_scratch);
+  service = scheme_object_to_arena_string (argv[0]);
+  if (service == NULL)
+    scheme_wrong_type ("loudbus-health-start!", "string", 0, argc, argv);
+  for (i = 1; i < 3; i++)
+    if ((! SCHEME_INTP (argv[i])) || (SCHEME_INT_VAL (argv[i]) < 1)
+        || (SCHEME_INT_VAL (argv[i]) > G_MAXINT))
+      scheme_wrong_type ("loudbus-health-start!", "positive integer",
+                         i, argc, argv);
+
+  if (! loudbus_probe_start (service, SCHEME_INT_VAL (argv[1]),
+                             SCHEME_INT_VAL (argv[2]), &error))
+    loudbus_signal_gerror ("loudbus-health-start!", "Could not connect",
+                           error);
+  loudbus_arena_reset (&loudbus_scratch);
+
+  return scheme_void;
+} // loudbus_health_start
+
+/**
+ * Get what we've learned about the health of a service, as an
+ * association list, or #f if we aren't checking the service.
+ * Parameters are
+ *  0: The name of the service
+ */
+static Scheme_Object *
+loudbus_health_stats (int argc, Scheme_Object **argv)
+{
+  gchar *service;               // The name of the service
+  LouDBusProbeStats stats;      // What we've learned
+  Scheme_Object *result = NULL; // The stats, as an association list
+  Scheme_Object *val = NULL;    // One statistic
+
+  loudbus_arena_reset (&loudbus_scratch);
+  service = scheme_object_to_arena_string (argv[0]);
+  if (service == NULL)
+    scheme_wrong_type ("loudbus-health-stats", "string", 0, argc, argv);
+  if (! loudbus_probe_stats (service, &stats))
+    return scheme_false;
+
+  MZ_GC_DECL_REG (2);
+  MZ_GC_VAR_IN_REG (0, result);
+  MZ_GC_VAR_IN_REG (1, val);
+  MZ_GC_REG ();
+
+  // Build the list from the end.
+  result = scheme_null;
+  val = stats.degraded ? scheme_true : scheme_false;
+  val = scheme_make_pair (scheme_intern_symbol ("degraded"), val);
+  result = scheme_make_pair (val, result);
+  val = scheme_make_integer_value_from_unsigned (stats.failures);
+  val = scheme_make_pair (scheme_intern_symbol ("failures"), val);
+  result = scheme_make_pair (val, result);
+  val = scheme_make_integer_value_from_unsigned (stats.pings);
+  val = scheme_make_pair (scheme_intern_symbol ("pings"), val);
+  result = scheme_make_pair (val, result);
+  val = scheme_make_double (stats.last_ms);
+  val = scheme_make_pair (scheme_intern_symbol ("last"), val);
+  result = scheme_make_pair (val, result);
+  val = scheme_make_double (stats.baseline_ms);
+  val = scheme_make_pair (scheme_intern_symbol ("baseline"), val);
+  result = scheme_make_pair (val, result);
+  val = scheme_make_double (stats.latency_ms);
+  val = scheme_make_pair (scheme_intern_symbol ("latency"), val);
+  result = scheme_make_pair (val, result);
+
+  MZ_GC_UNREG ();
+  return result;
+} // loudbus_health_stats
+
+/**
+ * Stop checking the health of a service.  Parameters are
+ *  0: The name of the service
+ */
+static Scheme_Object *
+loudbus_health_stop (int argc, Scheme_Object **argv)
+{
+  gchar *service;               // The name of the service
+
+  loudbus_arena_reset (&loudbus_scratch);
+  service = scheme_object_to_arena_string (argv[0]);
+  if (service == NULL)
+    scheme_wrong_type ("loudbus-health-stop!", "string", 0, argc, argv);
+  loudbus_probe_stop (service);
+
+  return scheme_void;
+} // loudbus_health_stop
+
+/**
+ * Forget which services, objects, and methods were missing.
+ * Parameters are
+ *  0: (optional) The name of the service (all services if omitted)
+ */
+static Scheme_Object *
+loudbus_negative_cache_clear (int argc, Scheme_Object **argv)
+{
+  gchar *service = NULL;        // The name of the service
+
+  loudbus_arena_reset (&loudbus_scratch);
+  if (argc > 0)
+    {
+      service = scheme_object_to_arena_string (argv[0]);
+      if (service == NULL)
+        scheme_wrong_type ("loudbus-negative-cache-clear!", "string", 
+                           0, argc, argv);
+    } // if we're given a service
+  loudbus_missing_forget (service);
+
+  return scheme_void;
+} // loudbus_negative_cache_clear
+
+/**
+ * Set the number of threads that help decode large arrays.
+ * Parameters are
+ *  0: The number of threads (0 to decode on Racket's thread alone)
+ */
+static Scheme_Object *
+loudbus_decode_threads (int argc, Scheme_Object **argv)
+{
+  if (! SCHEME_INTP (argv[0]) || (SCHEME_INT_VAL (argv[0]) < 0)
+      || (SCHEME_INT_VAL (argv[0]) > G_MAXINT))
+    scheme_wrong_type ("loudbus-decode-threads!", 
+                       "non-negative integer", 0, argc, argv);
+  loudbus_flat_set_threads (SCHEME_INT_VAL (argv[0]));
+
+  return scheme_void;
+} // loudbus_decode_threads
+
+/**
+ * Set how long we remember that things are missing.  Parameters are
+ *  0: The time, in milliseconds (0 to stop remembering)
+ */
+static Scheme_Object *
+loudbus_negative_cache_ttl (int argc, Scheme_Object **argv)
+{
+  if (! SCHEME_INTP (argv[0]) || (SCHEME_INT_VAL (argv[0]) < 0)
+      || (SCHEME_INT_VAL (argv[0]) > G_MAXINT))
+    scheme_wrong_type ("loudbus-negative-cache-ttl!", 
+                       "non-negative integer", 0, argc, argv);
+  loudbus_missing_set_ttl (SCHEME_INT_VAL (argv[0]));
+
+  return scheme_void;
+} // loudbus_negative_cache_ttl
+
+/**
+ * Get where the time in calls has gone since timing started, as an
+ * association list.  Times are in milliseconds.
+ */
+static Scheme_Object *
+loudbus_timing (int argc, Scheme_Object **argv)
+{
+  LouDBusCallTimes times;       // Where the time went
+  Scheme_Object *result = NULL; // The times, as an association list
+  Scheme_Object *val = NULL;    // One time
+
+  loudbus_timing_get (&times);
+
+  MZ_GC_DECL_REG (2);
+  MZ_GC_VAR_IN_REG (0, result);
+  MZ_GC_VAR_IN_REG (1, val);
+  MZ_GC_REG ();
+
+  // Build the list from the end.
+  result = scheme_null;
+  val = scheme_make_double (times.decode_ns / 1e6);
+  val = scheme_make_pair (scheme_intern_symbol ("decode"), val);
+  result = scheme_make_pair (val, result);
+  val = scheme_make_double (times.wire_ns / 1e6);
+  val = scheme_make_pair (scheme_intern_symbol ("wire"), val);
+  result = scheme_make_pair (val, result);
+  val = scheme_make_double (times.encode_ns / 1e6);
+  val = scheme_make_pair (scheme_intern_symbol ("encode"), val);
+  result = scheme_make_pair (val, result);
+  val = scheme_make_integer_value_from_unsigned (times.calls);
+  val = scheme_make_pair (scheme_intern_symbol ("calls"), val);
+  result = scheme_make_pair (val, result);
+
+  MZ_GC_UNREG ();
+  return result;
+} // loudbus_timing
+
+/**
+ * Start or stop timing calls, forgetting the old times.  Parameters are
+ *  0: #t to start, #f to stop
+ */
+static Scheme_Object *
+loudbus_timing_set (int argc, Scheme_Object **argv)
+{
+  loudbus_timing_enable (SCHEME_TRUEP (argv[0]));
+  return scheme_void;
+} // loudbus_timing_set
+
+/**
+ * The time, in milliseconds, on the clock that the core traces with.
+ */
+static Scheme_Object *
+loudbus_trace_clock (int argc, Scheme_Object **argv)
+{
+  return scheme_make_double (loudbus_trace_now () / 1e6);
+} // loudbus_trace_clock
+
+/**
+ * Start or stop recording what the core does off the Racket threads,
+ * forgetting the old events.  Parameters are
+ *  0: #t to start, #f to stop
+ */
+static Scheme_Object *
+loudbus_trace_core (int argc, Scheme_Object **argv)
+{
+  loudbus_trace_enable (SCHEME_TRUEP (argv[0]));
+  return scheme_void;
+} // loudbus_trace_core
+
+/**
+ * Get what the core recorded, as Chrome trace events (JSON objects
+ * separated by commas).  Parameters are
+ *  0: The process id to give the events
+ */
+static Scheme_Object *
+loudbus_trace_events (int argc, Scheme_Object **argv)
+{
+  gchar *json;                  // The events
+  Scheme_Object *result;        // The events, as a Racket string
+
+  if ((! SCHEME_INTP (argv[0])) || (SCHEME_INT_VAL (argv[0]) < 0)
+      || (SCHEME_INT_VAL (argv[0]) > G_MAXINT))
+    scheme_wrong_type ("loudbus-trace-events", "natural number",
+                       0, argc, argv);
+
+  json = loudbus_trace_json (SCHEME_INT_VAL (argv[0]));
+  result = scheme_make_utf8_string (json);
+  g_free (json);
+  return result;
+} // loudbus_trace_events
+
 /**
  * Import all of the methods from a LouDBusProxy.
  */
@@ -1102,7 +2895,7 @@ Scheme_Object *
 loudbus_import (int argc, Scheme_Object **argv)
 {
   Scheme_Env *env = NULL;       // The environment
-  GDBusMethodInfo *method;      // Information on one method
+  LouDBusMethod *method;        // Information on one method
   LouDBusProxy *proxy;            // The proxy
   int m;                        // Counter variable for methods
   int n;                        // The total number of methods
@@ -1146,11 +2939,11 @@ loudbus_import (int argc, Scheme_Object **argv)
   env = scheme_get_env (scheme_current_config ());
 
   // Process the methods
-  n = g_dbus_interface_info_num_methods (proxy->iinfo);
+  n = proxy->iface->nmethods;
   for (m = 0; m < n; m++)
     {
-      method = proxy->iinfo->methods[m];
-      arity = g_dbus_method_info_num_formals (method);
+      method = &proxy->iface->methods[m];
+      arity = method->arity;
       external_name = g_strdup_printf ("%s%s", prefix, method->name);
       if (external_name != NULL)
         {
@@ -1176,7 +2969,8 @@ loudbus_import (int argc, Scheme_Object **argv)
 
 /**
  * Initialize the louDBus library by getting the appropriate Scheme_Object to
- * name pointers.
+ * name pointers.  The optional second parameter is the procedure that
+ * builds the error values for loudbus-try-call.
  */
 Scheme_Object *
 loudbus_init (int argc, Scheme_Object **argv)
@@ -1187,20 +2981,132 @@ loudbus_init (int argc, Scheme_Object **argv)
   size = sizeof (*LOUDBUS_PROXY_TAG);
   LOG ("loudbus_init: I think that the size of LOUDBUS_PROXY_TAG is %d.\n", size);
   scheme_register_static (LOUDBUS_PROXY_TAG, size);
+  if (argc > 1)
+    {
+      if (LOUDBUS_ERROR_MAKER == NULL)
+        MZ_REGISTER_STATIC (LOUDBUS_ERROR_MAKER);
+      LOUDBUS_ERROR_MAKER = argv[1];
+    } // if we have a way to build errors
+  return scheme_void;
+} // loudbus_init
+
+/**
+ * Determine whether a value is a spilled byte array.
+ */
+static Scheme_Object *
+loudbus_mapped_bytes_p (int argc, Scheme_Object **argv)
+{
+  return (scheme_object_to_spill (argv[0]) != NULL) 
+         ? scheme_true : scheme_false;
+} // loudbus_mapped_bytes_p
+
+/**
+ * Get the length of a spilled byte array.
+ */
+static Scheme_Object *
+loudbus_mapped_bytes_length (int argc, Scheme_Object **argv)
+{
+  LouDBusSpill *spill;  // The spilled array
+  gsize size;           // Its size
+
+  spill = scheme_object_to_spill (argv[0]);
+  if (spill == NULL)
+    scheme_wrong_type ("loudbus-mapped-bytes-length", "mapped bytes", 
+                       0, argc, argv);
+  loudbus_spill_data (spill, &size);
+
+  return scheme_make_integer_value_from_unsigned (size);
+} // loudbus_mapped_bytes_length
+
+/**
+ * Copy part of a spilled byte array into a byte string.  Parameters are
+ *  0: The spilled array
+ *  1: The index of the first byte to copy
+ *  2: (optional) The index after the last byte to copy (the end of the
+ *     array if omitted)
+ */
+static Scheme_Object *
+loudbus_mapped_subbytes (int argc, Scheme_Object **argv)
+{
+  LouDBusSpill *spill;  // The spilled array
+  const guchar *data;   // Its bytes
+  gsize size;           // Its size
+  uintptr_t start;      // The first byte to copy
+  uintptr_t end;        // One past the last byte to copy
+
+  spill = scheme_object_to_spill (argv[0]);
+  if (spill == NULL)
+    scheme_wrong_type ("loudbus-mapped-subbytes", "mapped bytes", 
+                       0, argc, argv);
+  data = loudbus_spill_data (spill, &size);
+  end = size;
+  if ((! scheme_get_unsigned_int_val (argv[1], &start)) || (start > size))
+    scheme_wrong_type ("loudbus-mapped-subbytes", "index in range", 
+                       1, argc, argv);
+  if ((argc > 2) 
+      && ((! scheme_get_unsigned_int_val (argv[2], &end)) 
+          || (end < start) || (end > size)))
+    scheme_wrong_type ("loudbus-mapped-subbytes", "index in range", 
+                       2, argc, argv);
+
+  return scheme_make_sized_byte_string ((char *) data + start, 
+                                        end - start, 1);
+} // loudbus_mapped_subbytes
+
+/**
+ * Turn the memo of encoded arguments on or off.  While it's on, a
+ * big immutable byte string, vector, or list that is passed again
+ * (as the same eq? value) reuses the D-Bus value built for it the
+ * first time, rather than being converted again.  Parameters are
+ *  0: The most values to remember (0 to turn the memo off, #f to
+ *     leave it alone)
+ *  1: The smallest value to remember, in bytes for byte strings and
+ *     elements for vectors and lists (#f to leave it alone)
+ */
+static Scheme_Object *
+loudbus_memo_config (int argc, Scheme_Object **argv)
+{
+  int settings[2];      // The new settings
+  int i;                // Counter variable
+
+  for (i = 0; i < 2; i++)
+    {
+      if (SCHEME_FALSEP (argv[i]))
+        settings[i] = -1;
+      else if (SCHEME_INTP (argv[i]) && (SCHEME_INT_VAL (argv[i]) >= 0)
+               && (SCHEME_INT_VAL (argv[i]) <= G_MAXINT))
+        settings[i] = SCHEME_INT_VAL (argv[i]);
+      else
+        scheme_wrong_type ("loudbus-memo-config!",
+                           "non-negative integer or #f", i, argc, argv);
+    } // for each setting
+
+  if (settings[1] >= 0)
+    loudbus_memo_min = settings[1];
+  if (settings[0] >= 0)
+    {
+      // Start over, so the old entries (and their GVariants) can go.
+      loudbus_memo_limit = settings[0];
+      loudbus_memo_count = 0;
+      loudbus_memo = (settings[0] == 0)
+                     ? NULL
+                     : scheme_make_bucket_table (settings[0],
+                                                 SCHEME_hash_weak_ptr);
+    } // if we have a new limit
+
   return scheme_void;
-} // loudbus_init
+} // loudbus_memo_config
 
 /**
  * Get information on one method (annotations, parameters, return
- * values, etc).
+ * values, etc).  The first request for an interface introspects once
+ * for all of its methods, and we keep each result in the catalogue of
+ * the interface, so later requests cost a hash lookup.
  *
  * TODO:
- *   1. Add missing documentation (see ????)
- *   2. Check to make sure that the second parameter is a string.  (Also
- *      do other error checking.  See below.)
- *   3. Make sure that you get annotations for parameters and return
+ *   1. Make sure that you get annotations for parameters and return
  *      values (if they exist).
- *   4. Add tags for the other parts of the record (if they aren't
+ *   2. Add tags for the other parts of the record (if they aren't
  *      there already).  For example, something like
  *      '((name gimp_image_new)
  *        (annotations "...")
@@ -1209,108 +3115,181 @@ loudbus_init (int argc, Scheme_Object **argv)
  *      If you'd prefer, input and output could also have their own
  *      tags.
  *        (inputs ((name width) (type integer) (annotations "width of image")))
- *   5. Add a function to louDBus/unsafe that pretty prints this.  
+ *   3. Add a function to louDBus/unsafe that pretty prints this.  
  *      (If you'd prefer, you can add it to this file.  But you can't
  *      use printf to pretty print.)
- *   6. Add information for the garbage collector.  (Yup, you'll need to
- *      read really bad documentation on this.  But try.)
  */
 static Scheme_Object *
 loudbus_method_info (int argc, Scheme_Object **argv)
 {
-  Scheme_Object *val, *val2;            // ????
   Scheme_Object *result = NULL;         // The result we're building
-  Scheme_Object *arglist = NULL;        // The list of arguments
-  Scheme_Object *outarglist = NULL;     // The list of return values
-  Scheme_Object *annolist = NULL;       // The list of annotations   
+  Scheme_Object *catalogue = NULL;      // The catalogue of the interface
   Scheme_Object *name = NULL;           // The method's name
-  Scheme_Object *parampair = NULL;      // ????
-  Scheme_Object *outparampair = NULL;   // ????
-  GDBusMethodInfo *method;              // Information on one method
-  GDBusAnnotationInfo *anno;            // Information on the annotations
-  GDBusArgInfo *args, *outargs;         // Information on the arguments
   LouDBusProxy *proxy;                  // The proxy
+  LouDBusMethod *method;                // The method
+  GVariant *details;                    // What the core knows about it
+  GError *error = NULL;                 // Why it doesn't know
   gchar *methodName;                    // The method name
-  int m;                                // Counter variable for methods
 
   // Get the proxy
   proxy = scheme_object_to_proxy (argv[0]);
   if (proxy == NULL)
     {
-      scheme_wrong_type ("loudbus-methods", "LouDBusProxy *", 0, argc, argv);
+      scheme_wrong_type ("loudbus-method-info", "LouDBusProxy *", 
+                         0, argc, argv);
     } // if proxy == NULL
-
-  //Get the method name.  WHAT IF WE CAN'T CONVERT TO A STRING????
   methodName = scheme_object_to_string (argv[1]);
+  if (methodName == NULL)
+    {
+      scheme_wrong_type ("loudbus-method-info", "string", 1, argc, argv);
+    } // if methodName == NULL
+
+  MZ_GC_DECL_REG (4);
+  MZ_GC_VAR_IN_REG (0, argv);
+  MZ_GC_VAR_IN_REG (1, result);
+  MZ_GC_VAR_IN_REG (2, catalogue);
+  MZ_GC_VAR_IN_REG (3, name);
+  MZ_GC_REG ();
 
   // Permit the use of dashes in method names by converting them back
   // to underscores (which is what we use over DBus).
+  methodName = g_strdup (methodName);
   score_it_all (methodName);
+  name = scheme_intern_symbol (methodName);
 
-  //Get the method struct.  WHAT IF THE METHOD DOESN'T EXIST????
-  method = g_dbus_interface_info_lookup_method (proxy->iinfo, methodName);
-
-  // Build the list for arguments.
-  arglist = scheme_null;
-  for (m = parray_len ((gpointer *) method->in_args) - 1; m >= 0; m--)
+  catalogue = loudbus_catalogue (proxy);
+  result = scheme_hash_get ((Scheme_Hash_Table *) 
+                              SCHEME_VEC_ELS (catalogue)[2], 
+                            name);
+  if (result != NULL)
     {
-      args = method->in_args[m]; //Go through the arguments.
-      val = scheme_make_symbol (args->name);
-      val2 = scheme_make_symbol (args->signature);
-      parampair = scheme_make_pair (val, val2);
-      arglist = scheme_make_pair (parampair, arglist);
-    } // for each argument
- 
-  //Build list for output.
-  outarglist = scheme_null;
-  for (m = parray_len ((gpointer *) method->out_args) - 1; m >= 0; m--)
-    {
-      outargs = method->out_args[m];
-      val = scheme_make_symbol (outargs->name);
-      val2 = scheme_make_symbol (outargs->signature);
-      outparampair = scheme_make_pair (val, val2);
-      outarglist =  scheme_make_pair (outparampair, outarglist);
-    } // for each output formals
-
-  // Build list of annotations
-  annolist = scheme_null;
-  for (m = parray_len ((gpointer *) method->annotations) - 1; m >= 0; m--)
-    {
-      anno = method->annotations[m]; //Go through the annotations.
-      val = scheme_make_locale_string (anno->value);
-      annolist = scheme_make_pair (val, annolist);
-    } // for each annotation
+      g_free (methodName);
+      MZ_GC_UNREG ();
+      return result;
+    } // if we've answered before
 
-  // Create the name entry
-  name = scheme_null;
-  name = scheme_make_pair (scheme_make_symbol(methodName), name);
-  name = scheme_make_pair (scheme_make_symbol("name"), name);
+  method = loudbus_interface_lookup_method (proxy->iface, methodName);
+  g_free (methodName);
+  if (method == NULL)
+    {
+      MZ_GC_UNREG ();
+      scheme_signal_error ("loudbus-method-info: no such method: %s",
+                           SCHEME_SYM_VAL (name));
+    } // if (method == NULL)
+  details = loudbus_interface_details (proxy->iface, proxy->proxy, method,
+                                       &error);
+  if (details == NULL)
+    {
+      MZ_GC_UNREG ();
+      loudbus_signal_gerror ("loudbus-method-info", 
+                             "Could not get information", error);
+    } // if (details == NULL)
 
-  result = scheme_null;
-  result = scheme_make_pair (annolist, result);
-  result = scheme_make_pair (outarglist, result);
-  result = scheme_make_pair (arglist, result);
-  result = scheme_make_pair (name, result);
+  result = loudbus_details_to_scheme (name, details);
+  scheme_hash_set ((Scheme_Hash_Table *) SCHEME_VEC_ELS (catalogue)[2],
+                   name, result);
 
   // And we're done.
+  MZ_GC_UNREG ();
   return result;
 } // loudbus_method_info
 
 /**
- * Get all of the methods from a louDBus Proxy.
+ * Find the methods of a proxy whose names start with a prefix, in
+ * alphabetical order.  Parameters are
+ *  0: The LouDBusProxy
+ *  1: The prefix (a string or symbol, in which dashes stand for
+ *     underscores)
  */
-Scheme_Object *
-loudbus_methods (int argc, Scheme_Object **argv)
+static Scheme_Object *
+loudbus_method_complete (int argc, Scheme_Object **argv)
 {
-  Scheme_Object *result = NULL; // The result we're building
-  Scheme_Object *val = NULL;    // One method in the result
-  GDBusMethodInfo *method;      // Information on one method
-  LouDBusProxy *proxy;            // The proxy
-  int m;                        // Counter variable for methods
+  Scheme_Object *result = NULL;         // The result we're building
+  Scheme_Object *sorted = NULL;         // The names, in order
+  LouDBusProxy *proxy;                  // The proxy
+  gchar *prefix;                        // The prefix
+  int first;                            // The position of the first match
+  int n;                                // The number of matches
+
+  proxy = scheme_object_to_proxy (argv[0]);
+  if (proxy == NULL)
+    scheme_wrong_type ("loudbus-method-complete", "LouDBusProxy *", 
+                       0, argc, argv);
+  prefix = scheme_object_to_string (argv[1]);
+  if (prefix == NULL)
+    scheme_wrong_type ("loudbus-method-complete", "string", 1, argc, argv);
+  prefix = g_strdup (prefix);
+  score_it_all (prefix);
+  n = loudbus_interface_complete (proxy->iface, prefix, &first);
+  g_free (prefix);
 
   MZ_GC_DECL_REG (2);
   MZ_GC_VAR_IN_REG (0, result);
-  MZ_GC_VAR_IN_REG (1, val);
+  MZ_GC_VAR_IN_REG (1, sorted);
+  MZ_GC_REG ();
+
+  sorted = SCHEME_VEC_ELS (loudbus_catalogue (proxy))[1];
+  result = scheme_null;
+  while (n-- > 0)
+    result = scheme_make_pair (SCHEME_VEC_ELS (sorted)[first + n], result);
+
+  MZ_GC_UNREG ();
+  return result;
+} // loudbus_method_complete
+
+/**
+ * Find the methods of a proxy whose names contain some text, in
+ * alphabetical order.  Parameters are
+ *  0: The LouDBusProxy
+ *  1: The text (a string or symbol, in which dashes stand for
+ *     underscores)
+ */
+static Scheme_Object *
+loudbus_method_search (int argc, Scheme_Object **argv)
+{
+  Scheme_Object *result = NULL;         // The result we're building
+  Scheme_Object *sorted = NULL;         // The names, in order
+  LouDBusProxy *proxy;                  // The proxy
+  gchar *text;                          // The text
+  guint32 *matches;                     // The positions of the matches
+  int n;                                // The number of matches
+
+  proxy = scheme_object_to_proxy (argv[0]);
+  if (proxy == NULL)
+    scheme_wrong_type ("loudbus-method-search", "LouDBusProxy *", 
+                       0, argc, argv);
+  text = scheme_object_to_string (argv[1]);
+  if (text == NULL)
+    scheme_wrong_type ("loudbus-method-search", "string", 1, argc, argv);
+  text = g_strdup (text);
+  score_it_all (text);
+  matches = g_new (guint32, proxy->iface->nmethods + 1);
+  n = loudbus_interface_search (proxy->iface, text, matches);
+  g_free (text);
+
+  MZ_GC_DECL_REG (2);
+  MZ_GC_VAR_IN_REG (0, result);
+  MZ_GC_VAR_IN_REG (1, sorted);
+  MZ_GC_REG ();
+
+  sorted = SCHEME_VEC_ELS (loudbus_catalogue (proxy))[1];
+  result = scheme_null;
+  while (n-- > 0)
+    result = scheme_make_pair (SCHEME_VEC_ELS (sorted)[matches[n]], result);
+  g_free (matches);
+
+  MZ_GC_UNREG ();
+  return result;
+} // loudbus_method_search
+
+/**
+ * Get all of the methods from a louDBus Proxy.  The list comes from the
+ * catalogue of the interface, so every call returns the same list.
+ */
+static Scheme_Object *
+loudbus_methods (int argc, Scheme_Object **argv)
+{
+  LouDBusProxy *proxy;            // The proxy
 
   // Get the proxy
   proxy = scheme_object_to_proxy (argv[0]);
@@ -1319,22 +3298,58 @@ loudbus_methods (int argc, Scheme_Object **argv)
       scheme_wrong_type ("loudbus-methods", "LouDBusProxy *", 0, argc, argv);
     } // if proxy == NULL
 
+  // And we're done.
+  return SCHEME_VEC_ELS (loudbus_catalogue (proxy))[0];
+} // loudbus_methods
+
+/**
+ * Create a new proxy for every interface of an object.  Parameters are
+ *  0: The service
+ *  1: The object
+ */
+static Scheme_Object *
+loudbus_node_proxy (int argc, Scheme_Object **argv)
+{
+  gchar *service = NULL;        // A string giving the service
+  gchar *path = NULL;           // A string giving the path to the object
+  LouDBusProxy *proxy = NULL;   // The proxy we build
+  Scheme_Object *result = NULL; // The proxy wrapped as a Scheme object
+  GError *error = NULL;         // A place to hold errors
+
+  // Annotations for garbage collection
+  MZ_GC_DECL_REG (4);
+  MZ_GC_VAR_IN_REG (0, argv);
+  MZ_GC_VAR_IN_REG (1, service);
+  MZ_GC_VAR_IN_REG (2, path);
+  MZ_GC_VAR_IN_REG (3, result);
   MZ_GC_REG ();
 
-  // Build the list.  
-  result = scheme_null;
-  for (m = g_dbus_interface_info_num_methods (proxy->iinfo) - 1; m >= 0; m--)
+  // Extract and check parameters
+  service = scheme_object_to_string (argv[0]);
+  path = scheme_object_to_string (argv[1]);
+  if (service == NULL)
     {
-      method = proxy->iinfo->methods[m];
-      val = scheme_make_locale_string (method->name);
-      result = scheme_make_pair (val, result);
-    } // for each method
+      MZ_GC_UNREG ();
+      scheme_wrong_type ("loudbus-node-proxy", "string", 0, argc, argv);
+    }
+  if (path == NULL)
+    {
+      MZ_GC_UNREG ();
+      scheme_wrong_type ("loudbus-node-proxy", "string", 1, argc, argv);
+    }
 
-  MZ_GC_UNREG ();
+  proxy = loudbus_proxy_new_for_node (service, path, &error);
+  if (proxy == NULL)
+    {
+      MZ_GC_UNREG ();
+      loudbus_signal_gerror ("loudbus-node-proxy", "Could not create proxy",
+                             error);
+    } // if (proxy == NULL)
 
-  // And we're done.
+  result = scheme_make_proxy (proxy);
+  MZ_GC_UNREG ();
   return result;
-} // loudbus_methods
+} // loudbus_node_proxy
 
 /**
  * Get a list of available objects.
@@ -1392,6 +3407,33 @@ loudbus_objects (int argc, Scheme_Object **argv)
   return g_variant_to_scheme_object (result);
 } // loudbus_objects
 
+/**
+ * Watch where the time in synchronous calls goes.  One call in every
+ * few is sampled, and, as the call returns, the observer gets the
+ * name of the method, the time (in milliseconds) spent converting
+ * parameters, on the wire, and converting results, and when (on the
+ * clock of loudbus-trace-clock) each of those phases started, or 0
+ * if it didn't.  Parameters are
+ *  0: The observer, or #f to stop watching
+ *  1: How many calls to make per sampled call
+ */
+static Scheme_Object *
+loudbus_observe_calls (int argc, Scheme_Object **argv)
+{
+  if ((! SCHEME_FALSEP (argv[0])) && (! SCHEME_PROCP (argv[0])))
+    scheme_wrong_type ("loudbus-observe-calls!", "procedure or #f",
+                       0, argc, argv);
+  if ((! SCHEME_INTP (argv[1])) || (SCHEME_INT_VAL (argv[1]) < 1)
+      || (SCHEME_INT_VAL (argv[1]) > G_MAXINT))
+    scheme_wrong_type ("loudbus-observe-calls!", "positive integer",
+                       1, argc, argv);
+
+  loudbus_call_observer = argv[0];
+  loudbus_observe_every = SCHEME_INT_VAL (argv[1]);
+  loudbus_observe_countdown = loudbus_observe_every;
+  return scheme_void;
+} // loudbus_observe_calls
+
 /**
  * Create a new proxy.
  */
@@ -1442,39 +3484,290 @@ loudbus_proxy (int argc, Scheme_Object **argv)
   proxy = loudbus_proxy_new (service, path, interface, &error);
   if (proxy == NULL)
     {
-      if (error == NULL)
-        {
-          MZ_GC_UNREG ();
-          scheme_signal_error ("loudbus-proxy: "
-                               "Could not create proxy for an unknown reason.");
-        }
-      else
-        {
-          MZ_GC_UNREG ();
-          scheme_signal_error ("loudbus-proxy: "
-                               "Could not create proxy because %s", 
-                               error->message);
-        }
+      MZ_GC_UNREG ();
+      loudbus_signal_gerror ("loudbus-proxy", "Could not create proxy", error);
     } // if (proxy == NULL)
   
   // Wrap the proxy into a Scheme type
-  result = scheme_make_cptr (proxy, LOUDBUS_PROXY_TAG);
-
-  // Log info during development
-  LOG ("loudbus_proxy: Built proxy %p, Scheme object %p", proxy, result);
-
-  // Find out information on what we just built.
-  SCHEME_LOG ("result is", result);
-  SCHEME_LOG ("result type is", SCHEME_CPTR_TYPE (result));
-  
-  // Register the finalizer
-  scheme_register_finalizer (result, loudbus_proxy_finalize, NULL, NULL, NULL);
+  result = scheme_make_proxy (proxy);
 
   // And we're done
   MZ_GC_UNREG ();
   return result;
 } // loudbus_proxy
 
+/**
+ * Set the priority class of the calls that a proxy sends with
+ * loudbus-send.  Parameters are
+ *  0: The LouDBusProxy
+ *  1: The class ('interactive, 'normal, or 'bulk)
+ */
+static Scheme_Object *
+loudbus_proxy_priority (int argc, Scheme_Object **argv)
+{
+  LouDBusProxy *proxy;          // The proxy
+  int priority;                 // Its new priority class
+
+  proxy = scheme_object_to_proxy (argv[0]);
+  if (proxy == NULL)
+    scheme_wrong_type ("loudbus-proxy-priority!", "LouDBusProxy *", 
+                       0, argc, argv);
+  if ((! scheme_object_to_priority (argv[1], &priority)) || (priority < 0))
+    scheme_wrong_type ("loudbus-proxy-priority!", 
+                       "'interactive, 'normal, or 'bulk", 1, argc, argv);
+
+  proxy->priority = priority;
+  return scheme_void;
+} // loudbus_proxy_priority
+
+/**
+ * Create a new proxy from signatures supplied by the caller, without
+ * introspecting.  Parameters are
+ *  0: The service
+ *  1: The object path
+ *  2: The interface
+ *  3: Either XML that describes the interface (a full introspection
+ *     document or just the <interface> element) or a list of 
+ *     (method signature) lists, where each signature gives the types
+ *     of all of the parameters (e.g., '((gimp_image_new "iii"))).
+ */
+static Scheme_Object *
+loudbus_proxy_with_signatures (int argc, Scheme_Object **argv)
+{
+  gchar *service;               // A string giving the service
+  gchar *path;                  // A string giving the path to the object
+  gchar *interface;             // A string giving the interface
+  gchar *xml;                   // XML describing the interface
+  LouDBusInterface *iface;      // The interface information
+  LouDBusMethodSpec *specs;     // The methods in a table of signatures
+  Scheme_Object *lst;           // The remaining part of that table
+  Scheme_Object *entry;         // One entry in the table
+  LouDBusProxy *proxy;          // The proxy we build
+  GError *error = NULL;         // A place to hold errors
+  int n;                        // The number of methods in the table
+  int m;                        // Counter variable for methods
+
+  // We put all of the strings in the arena, and don't allocate Scheme
+  // memory until we build the result, so no GC annotations are needed.
+  loudbus_arena_reset (&loudbus_scratch);
+
+  // Extract and check parameters
+  service = scheme_object_to_arena_string (argv[0]);
+  if (service == NULL)
+    scheme_wrong_type ("loudbus-proxy-with-signatures", "string", 
+                       0, argc, argv);
+  path = scheme_object_to_arena_string (argv[1]);
+  if (path == NULL)
+    scheme_wrong_type ("loudbus-proxy-with-signatures", "string", 
+                       1, argc, argv);
+  interface = scheme_object_to_arena_string (argv[2]);
+  if (interface == NULL)
+    scheme_wrong_type ("loudbus-proxy-with-signatures", "string", 
+                       2, argc, argv);
+
+  // Build the interface information from XML ...
+  xml = scheme_object_to_arena_string (argv[3]);
+  if (xml != NULL)
+    {
+      iface = loudbus_interface_from_xml (xml, interface, &error);
+      if (iface == NULL)
+        {
+          loudbus_signal_gerror ("loudbus-proxy-with-signatures", 
+                                 "Could not read the XML", error);
+        } // if (iface == NULL)
+    } // if we have XML
+
+  // ... or from a table of signatures.
+  else
+    {
+      n = scheme_proper_list_length (argv[3]);
+      if (n < 0)
+        scheme_wrong_type ("loudbus-proxy-with-signatures", 
+                           "XML string or list of (method signature)",
+                           3, argc, argv);
+      specs = loudbus_arena_alloc (&loudbus_scratch, 
+                                   n * sizeof (LouDBusMethodSpec));
+      lst = argv[3];
+      for (m = 0; m < n; m++)
+        {
+          entry = SCHEME_CAR (lst);
+          lst = SCHEME_CDR (lst);
+          if (scheme_proper_list_length (entry) != 2)
+            scheme_wrong_type ("loudbus-proxy-with-signatures", 
+                               "XML string or list of (method signature)",
+                               3, argc, argv);
+          specs[m].name = scheme_object_to_arena_string (SCHEME_CAR (entry));
+          specs[m].signature = 
+            scheme_object_to_arena_string (SCHEME_CADR (entry));
+          specs[m].flags = 0;
+          if ((specs[m].name == NULL) || (specs[m].signature == NULL))
+            scheme_wrong_type ("loudbus-proxy-with-signatures", 
+                               "XML string or list of (method signature)",
+                               3, argc, argv);
+          if (! g_variant_is_signature (specs[m].signature))
+            scheme_signal_error ("loudbus-proxy-with-signatures: "
+                                 "invalid signature \"%s\" for %s",
+                                 specs[m].signature, specs[m].name);
+        } // for each method
+      iface = loudbus_interface_intern_specs (interface, n, specs);
+    } // if we have a table of signatures
+
+  // Build the proxy
+  proxy = loudbus_proxy_new_with_interface (service, path, iface, &error);
+  if (proxy == NULL)
+    {
+      loudbus_signal_gerror ("loudbus-proxy-with-signatures", 
+                             "Could not create proxy", error);
+    } // if (proxy == NULL)
+
+  return scheme_make_proxy (proxy);
+} // loudbus_proxy_with_signatures
+
+/**
+ * Give back a proxy's shared-memory ring, if it has one.  Parameters
+ * are
+ *  0: The LouDBusProxy
+ */
+static Scheme_Object *
+loudbus_ring_close (int argc, Scheme_Object **argv)
+{
+  LouDBusProxy *proxy;          // The proxy
+
+  proxy = scheme_object_to_proxy (argv[0]);
+  if (proxy == NULL)
+    scheme_wrong_type ("loudbus-ring-close!", "LouDBusProxy *", 
+                       0, argc, argv);
+
+  loudbus_proxy_ring_close (proxy);
+  return scheme_void;
+} // loudbus_ring_close
+
+/**
+ * Open a shared-memory ring between a proxy and its service, so that
+ * methods with the ring annotation send large byte arrays through
+ * shared memory.  Parameters are
+ *  0: The LouDBusProxy
+ *  1: (optional) The size of each direction of the ring, in bytes (a
+ *     power of two, at least 64K)
+ */
+static Scheme_Object *
+loudbus_ring_open (int argc, Scheme_Object **argv)
+{
+  LouDBusProxy *proxy;          // The proxy
+  uintptr_t capacity;           // The size of each lane
+  GError *error = NULL;         // A place to hold errors
+
+  proxy = scheme_object_to_proxy (argv[0]);
+  if (proxy == NULL)
+    scheme_wrong_type ("loudbus-ring-open!", "LouDBusProxy *", 
+                       0, argc, argv);
+  capacity = LOUDBUS_RING_CAPACITY;
+  if ((argc > 1) && (! scheme_get_unsigned_int_val (argv[1], &capacity)))
+    scheme_wrong_type ("loudbus-ring-open!", "power of two",
+                       1, argc, argv);
+
+  if (! loudbus_proxy_ring_open (proxy, capacity, &error))
+    loudbus_signal_gerror ("loudbus-ring-open!", "Could not open ring",
+                           error);
+  return scheme_void;
+} // loudbus_ring_open
+
+/**
+ * Configure the scheduler for asynchronous calls.  Parameters are
+ *  0: The number of calls to keep in flight (or #f to leave it alone)
+ *  1: A list of the priority classes that get their own connection
+ *     to the bus.  Other classes share the connection of the proxy.
+ */
+static Scheme_Object *
+loudbus_scheduler_config (int argc, Scheme_Object **argv)
+{
+  gboolean separate[LOUDBUS_PRIORITIES];
+                                // Which classes get their own connection
+  Scheme_Object *lst;           // The remaining classes
+  GError *error = NULL;         // A place to hold errors
+  int priority;                 // One class
+
+  if ((! SCHEME_FALSEP (argv[0])) 
+      && ((! SCHEME_INTP (argv[0])) || (SCHEME_INT_VAL (argv[0]) < 1)))
+    scheme_wrong_type ("loudbus-scheduler-config!", "positive integer or #f",
+                       0, argc, argv);
+  for (priority = 0; priority < LOUDBUS_PRIORITIES; priority++)
+    separate[priority] = FALSE;
+  for (lst = argv[1]; SCHEME_PAIRP (lst); lst = SCHEME_CDR (lst))
+    {
+      if ((! scheme_object_to_priority (SCHEME_CAR (lst), &priority)) 
+          || (priority < 0))
+        scheme_wrong_type ("loudbus-scheduler-config!", 
+                           "list of priority classes", 1, argc, argv);
+      separate[priority] = TRUE;
+    } // for each class
+  if (! SCHEME_NULLP (lst))
+    scheme_wrong_type ("loudbus-scheduler-config!", 
+                       "list of priority classes", 1, argc, argv);
+
+  if (! SCHEME_FALSEP (argv[0]))
+    loudbus_scheduler_set_window (SCHEME_INT_VAL (argv[0]));
+  for (priority = 0; priority < LOUDBUS_PRIORITIES; priority++)
+    {
+      if (! loudbus_scheduler_separate_lane (priority, separate[priority],
+                                             &error))
+        loudbus_signal_gerror ("loudbus-scheduler-config!", 
+                               "Could not connect", error);
+    } // for each class
+
+  return scheme_void;
+} // loudbus_scheduler_config
+
+/**
+ * Start an asynchronous call.  Parameters are
+ *  0: The LouDBusProxy
+ *  1: The method name (string)
+ *  2: The priority class, or #f for the proxy's class
+ *  3: The time limit for the call in milliseconds, or #f for none
+ *  others: Parameters to the method
+ * Returns a ticket for loudbus-wait.
+ */
+static Scheme_Object *
+loudbus_send (int argc, Scheme_Object **argv)
+{
+  LouDBusProxy *proxy;          // The proxy
+  gchar *name;                  // The name of the method
+  int priority;                 // The priority class of the call
+  int timeout;                  // The time limit
+  GVariant *actuals;            // The parameters
+  LouDBusTicket *ticket;        // The ticket for the call
+
+  // Start with a fresh scratch arena.
+  loudbus_arena_reset (&loudbus_scratch);
+
+  proxy = scheme_object_to_proxy (argv[0]);
+  if (proxy == NULL)
+    scheme_wrong_type ("loudbus-send", "LouDBusProxy *", 0, argc, argv);
+  name = scheme_object_to_arena_name (argv[1]);
+  if (name == NULL)
+    scheme_wrong_type ("loudbus-send", "string", 1, argc, argv);
+  if (! scheme_object_to_priority (argv[2], &priority))
+    scheme_wrong_type ("loudbus-send", "'interactive, 'normal, 'bulk, or #f",
+                       2, argc, argv);
+  if (SCHEME_FALSEP (argv[3]))
+    timeout = -1;
+  else if (SCHEME_INTP (argv[3]) && (SCHEME_INT_VAL (argv[3]) >= 0))
+    timeout = SCHEME_INT_VAL (argv[3]);
+  else
+    scheme_wrong_type ("loudbus-send", "non-negative integer or #f",
+                       3, argc, argv);
+
+  // Permit the use of dashes.
+  if (strchr (name, '-') != NULL)
+    score_it_all (name);
+
+  actuals = dbus_call_actuals (proxy, name, name, argc-4, argv+4, NULL);
+  ticket = loudbus_call_async (proxy, name, actuals, priority, timeout);
+  loudbus_arena_reset (&loudbus_scratch);
+
+  return scheme_make_ticket (ticket);
+} // loudbus_send
+
 /**
  * Create a list of available services.
  */
@@ -1538,6 +3831,126 @@ loudbus_services (int argc, Scheme_Object **argv)
   return g_variant_to_scheme_object (result);
 } // loudbus_services
 
+/**
+ * Set the size at which byte arrays in results are spilled to mapped
+ * files, and the largest reply to accept.  Parameters are
+ *  0: The size, in bytes (0 for never, #f to leave it alone)
+ *  1: The limit, in bytes (0 for no limit, #f to leave it alone)
+ */
+static Scheme_Object *
+loudbus_spill_config (int argc, Scheme_Object **argv)
+{
+  gssize settings[2];   // The new settings
+  uintptr_t value;      // One setting, as given
+  int i;                // Counter variable
+
+  for (i = 0; i < 2; i++)
+    {
+      if (SCHEME_FALSEP (argv[i]))
+        settings[i] = -1;
+      else if (scheme_get_unsigned_int_val (argv[i], &value)
+               && (value <= G_MAXSSIZE))
+        settings[i] = value;
+      else
+        scheme_wrong_type ("loudbus-spill-config!", 
+                           "non-negative integer or #f", i, argc, argv);
+    } // for each setting
+  loudbus_spill_configure (settings[0], settings[1]);
+
+  return scheme_void;
+} // loudbus_spill_config
+
+/**
+ * Determine whether an asynchronous call has finished.
+ */
+static Scheme_Object *
+loudbus_ticket_ready_p (int argc, Scheme_Object **argv)
+{
+  LouDBusTicket *ticket;        // The ticket for the call
+
+  ticket = scheme_object_to_ticket (argv[0]);
+  if (ticket == NULL)
+    scheme_wrong_type ("loudbus-ticket-ready?", "ticket", 0, argc, argv);
+
+  return loudbus_ticket_done (ticket) ? scheme_true : scheme_false;
+} // loudbus_ticket_ready_p
+
+/**
+ * Wait for an asynchronous call to finish, and get its result.  Other
+ * Racket threads keep running while we wait.  Parameters are
+ *  0: The ticket from loudbus-send
+ *  1: (optional) If true, return an error value, as loudbus-try-call
+ *     does, rather than signalling an error if the call failed.
+ */
+static Scheme_Object *
+loudbus_wait (int argc, Scheme_Object **argv)
+{
+  LouDBusTicket *ticket;        // The ticket for the call
+  GVariant *gresult;            // The result of the call
+  Scheme_Object *sresult;       // That result as a Scheme object
+  GError *error = NULL;         // The reason the call failed
+  int try = 0;                  // Should we return errors?
+
+  ticket = scheme_object_to_ticket (argv[0]);
+  if (ticket == NULL)
+    scheme_wrong_type ("loudbus-wait", "ticket", 0, argc, argv);
+  if (argc > 1)
+    try = SCHEME_TRUEP (argv[1]);
+  if (try && (LOUDBUS_ERROR_MAKER == NULL))
+    scheme_signal_error ("loudbus-wait: loudbus-init was not given "
+                         "a way to build errors");
+
+  // Wait, if we have to.
+  if (! loudbus_ticket_done (ticket))
+    scheme_block_until (loudbus_ticket_ready, loudbus_ticket_needs_wakeup,
+                        argv[0], 0.0);
+
+  gresult = loudbus_ticket_result (ticket, &error);
+  if (gresult == NULL)
+    {
+      if (try)
+        return scheme_make_loudbus_error (error);
+      loudbus_signal_gerror ("loudbus-wait", "call failed", error);
+    } // if (gresult == NULL)
+
+  sresult = g_variant_to_scheme_object (gresult);
+  g_variant_unref (gresult);
+  return sresult;
+} // loudbus_wait
+
+/**
+ * Choose how to encode the parameters of calls.  'off builds a
+ * GVariant for each parameter and puts them together with a builder;
+ * 'on writes numbers, strings, byte strings, and arrays of them
+ * straight into the serialized tuple; 'check does both and signals
+ * an error if they differ.  Parameters are
+ *  0: The mode ('off, 'on, or 'check)
+ */
+static Scheme_Object *
+loudbus_wire_config (int argc, Scheme_Object **argv)
+{
+  gchar *mode;          // The name of the mode
+
+  if (! SCHEME_SYMBOLP (argv[0]))
+    scheme_wrong_type ("loudbus-wire-config!", "'off, 'on, or 'check",
+                       0, argc, argv);
+  mode = SCHEME_SYM_VAL (argv[0]);
+  if (strcmp (mode, "off") == 0)
+    loudbus_wire_mode = LOUDBUS_WIRE_OFF;
+  else if (strcmp (mode, "on") == 0)
+    loudbus_wire_mode = LOUDBUS_WIRE_ON;
+  else if (strcmp (mode, "check") == 0)
+    loudbus_wire_mode = LOUDBUS_WIRE_CHECK;
+  else
+    scheme_wrong_type ("loudbus-wire-config!", "'off, 'on, or 'check",
+                       0, argc, argv);
+
+  if ((loudbus_wire_mode != LOUDBUS_WIRE_OFF) && (loudbus_wire == NULL))
+    loudbus_wire = loudbus_wire_new ();
+
+  return scheme_void;
+} // loudbus_wire_config
+
 
 // +-----------------------+------------------------------------------
 // | Standard Scheme Setup |
@@ -1560,13 +3973,70 @@ scheme_reload (Scheme_Env *env)
 
   // Build the procedures
   register_function (loudbus_call,        "loudbus-call",        2, -1, menv);
+  register_function (loudbus_connection_config,
+                     "loudbus-connection-config!", 4, 4, menv);
+  register_function (loudbus_decode_threads,
+                     "loudbus-decode-threads!", 1, 1, menv);
+  register_function (loudbus_health_start,
+                     "loudbus-health-start!", 3, 3, menv);
+  register_function (loudbus_health_stats,
+                     "loudbus-health-stats", 1, 1, menv);
+  register_function (loudbus_health_stop,
+                     "loudbus-health-stop!", 1, 1, menv);
   register_function (loudbus_import,      "loudbus-import",      3,  3, menv);
-  register_function (loudbus_init,        "loudbus-init",        1,  1, menv);
+  register_function (loudbus_init,        "loudbus-init",        1,  2, menv);
+  register_function (loudbus_mapped_bytes_p,
+                     "loudbus-mapped-bytes?", 1, 1, menv);
+  register_function (loudbus_mapped_bytes_length,
+                     "loudbus-mapped-bytes-length", 1, 1, menv);
+  register_function (loudbus_mapped_subbytes,
+                     "loudbus-mapped-subbytes", 2, 3, menv);
+  register_function (loudbus_memo_config,
+                     "loudbus-memo-config!", 2, 2, menv);
+  register_function (loudbus_method_complete,
+                     "loudbus-method-complete", 2, 2, menv);
   register_function (loudbus_method_info, "loudbus-method-info", 2,  2, menv);
+  register_function (loudbus_method_search,
+                     "loudbus-method-search", 2, 2, menv);
+  register_function (loudbus_negative_cache_clear,
+                     "loudbus-negative-cache-clear!", 0, 1, menv);
+  register_function (loudbus_negative_cache_ttl,
+                     "loudbus-negative-cache-ttl!", 1, 1, menv);
   register_function (loudbus_methods,     "loudbus-methods",     1,  1, menv);
+  register_function (loudbus_node_proxy,
+                     "loudbus-node-proxy", 2, 2, menv);
   register_function (loudbus_objects,     "loudbus-objects",     1,  1, menv);
+  register_function (loudbus_observe_calls,
+                     "loudbus-observe-calls!", 2, 2, menv);
   register_function (loudbus_proxy,       "loudbus-proxy",       3,  3, menv);
+  register_function (loudbus_proxy_priority,
+                     "loudbus-proxy-priority!", 2, 2, menv);
+  register_function (loudbus_proxy_with_signatures,
+                     "loudbus-proxy-with-signatures", 4, 4, menv);
+  register_function (loudbus_ring_close,
+                     "loudbus-ring-close!", 1, 1, menv);
+  register_function (loudbus_ring_open,
+                     "loudbus-ring-open!", 1, 2, menv);
+  register_function (loudbus_scheduler_config,
+                     "loudbus-scheduler-config!", 2, 2, menv);
+  register_function (loudbus_send,        "loudbus-send",        4, -1, menv);
   register_function (loudbus_services,    "loudbus-services",    0,  0, menv);
+  register_function (loudbus_spill_config,
+                     "loudbus-spill-config!", 2, 2, menv);
+  register_function (loudbus_ticket_ready_p,
+                     "loudbus-ticket-ready?", 1, 1, menv);
+  register_function (loudbus_timing,      "loudbus-timing",      0,  0, menv);
+  register_function (loudbus_timing_set,  "loudbus-timing!",     1,  1, menv);
+  register_function (loudbus_trace_clock,
+                     "loudbus-trace-clock", 0, 0, menv);
+  register_function (loudbus_trace_core,
+                     "loudbus-trace-core!", 1, 1, menv);
+  register_function (loudbus_trace_events,
+                     "loudbus-trace-events", 1, 1, menv);
+  register_function (loudbus_try_call,    "loudbus-try-call",    2, -1, menv);
+  register_function (loudbus_wait,        "loudbus-wait",        1,  2, menv);
+  register_function (loudbus_wire_config,
+                     "loudbus-wire-config!", 1, 1, menv);
 
   // And we're done.
   scheme_finish_primitive_module (menv);
@@ -1578,17 +4048,36 @@ scheme_reload (Scheme_Env *env)
 Scheme_Object *
 scheme_initialize (Scheme_Env *env)
 {
-  // Seed our random number generator (but only once)
-  srandom (time (NULL));      
+  // Set up the core (which is safe to do more than once)
+  loudbus_core_init ();
 
-  // Although g_type_init is deprecated since GLIB 2.36, it seems to be 
-  // needed in the version of GLib we have installed in MathLAN.
-  LOG ("GLIB %d.%d.%d", 
-       GLIB_MAJOR_VERSION, GLIB_MINOR_VERSION, GLIB_MICRO_VERSION);
-  if ((GLIB_MAJOR_VERSION == 2) && (GLIB_MINOR_VERSION < 36)) 
+  // Set up the tag for tickets (only once)
+  if (LOUDBUS_TICKET_TAG == NULL)
+    {
+      MZ_REGISTER_STATIC (LOUDBUS_TICKET_TAG);
+      LOUDBUS_TICKET_TAG = scheme_intern_symbol ("loudbus-ticket");
+    } // if (LOUDBUS_TICKET_TAG == NULL)
+  if (LOUDBUS_SPILL_TAG == NULL)
+    {
+      MZ_REGISTER_STATIC (LOUDBUS_SPILL_TAG);
+      LOUDBUS_SPILL_TAG = scheme_intern_symbol ("loudbus-mapped-bytes");
+    } // if (LOUDBUS_SPILL_TAG == NULL)
+  if (loudbus_catalogues == NULL)
+    {
+      MZ_REGISTER_STATIC (loudbus_catalogues);
+      loudbus_catalogues = scheme_make_hash_table (SCHEME_hash_ptr);
+    } // if (loudbus_catalogues == NULL)
+  if (loudbus_call_observer == NULL)
+    {
+      MZ_REGISTER_STATIC (loudbus_call_observer);
+      loudbus_call_observer = scheme_false;
+    } // if (loudbus_call_observer == NULL)
+  if (LOUDBUS_MEMO_TAG == NULL)
     {
-      g_type_init ();
-    } // if before 2.36
+      MZ_REGISTER_STATIC (LOUDBUS_MEMO_TAG);
+      MZ_REGISTER_STATIC (loudbus_memo);
+      LOUDBUS_MEMO_TAG = scheme_intern_symbol ("loudbus-memo");
+    } // if (LOUDBUS_MEMO_TAG == NULL)
 
   return scheme_reload (env);
 } // scheme_initialize